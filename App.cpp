@@ -3,31 +3,93 @@
 #include "GfxEngine.h"
 #include "InputManager.h"
 #include "ObjectProcessor.h"
+#include "JobSystem.h"
+#include "Clock.h"
+#include "Benchmark.h"
+#include "CpuProfiler.h"
 
 uint32_t const k_appVersion = 1;
 
-App::App(std::string const& appName)
+constexpr double k_simulationStepSeconds = 1.0 / 60.0;
+//Catch up at most this many steps per render frame, anything further behind is dropped
+constexpr uint32_t k_maxSimulationStepsPerAdvance = 5;
+
+App::App(std::string const& appName, AppSettings const& settings)
 	: m_appName(appName)
+	, m_settings(settings)
+	, m_framesRendered(0)
 	, m_pGfxEngine(nullptr)
 	, m_pInputManager(nullptr)
+	, m_pJobSystem(nullptr)
+	, m_pBenchmark(nullptr)
+	, m_simulationThread()
+	, m_stopSimulation(false)
+	, m_stepClock(k_simulationStepSeconds, k_maxSimulationStepsPerAdvance)
+	, m_lastAdvanceTime(0.0)
 {
 	Logger::InitLogger();
-	glfwInit();
+	CpuProfiler::SetEnabled(!m_settings.tracePath.empty());
+	CpuProfiler::SetThreadName("Render");
+	if (!m_settings.bHeadless)
+	{
+		glfwInit();
+	}
 }
 
 App::~App() {
-	glfwTerminate();
+	if (m_simulationThread.joinable())
+	{
+		m_stopSimulation = true;
+		m_pObjectProcessor->StopPublishing();
+		m_simulationThread.join();
+	}
+
+	if (!m_settings.bHeadless)
+	{
+		glfwTerminate();
+	}
 }
 
 void App::Start() {
 	//Topmost error handler
 	try
 	{
-		WindowDimensions size = { 800, 600 };
-		m_pWindow = std::make_shared<Window>(size, m_appName);
+		if (!m_settings.benchmarkCsvPath.empty() || !m_settings.benchmarkJsonPath.empty())
+		{
+			m_pBenchmark = std::make_shared<Benchmark>(m_settings);
+		}
+
+		m_pJobSystem = std::make_shared<JobSystem>();
+		if (m_settings.bHeadless)
+		{
+			SPDLOG_INFO("Running headless at {}x{}", std::get<0>(m_settings.renderSize), std::get<1>(m_settings.renderSize));
+			m_pObjectProcessor = std::make_shared<ObjectProcessor>(nullptr, m_pJobSystem);
+			m_pGfxEngine = std::make_shared<GfxEngine>(m_appName, k_appVersion, m_settings.renderSize, m_pObjectProcessor, m_pJobSystem, m_settings.scene, m_settings.gfx);
+			m_pObjectProcessor->SetCameraPath(m_settings.pCameraPath);
+			m_pGfxEngine->WaitForAssets();
+
+			//Every frame shows a whole step, real time plays no part in what gets drawn
+			m_pObjectProcessor->PublishSnapshot(k_simulationStepSeconds, 1.0);
+			return;
+		}
+
+		m_pWindow = std::make_shared<Window>(m_settings.renderSize, m_appName);
 		m_pInputManager = std::make_shared<InputManager>(*m_pWindow);
-		m_pObjectProcessor = std::make_shared<ObjectProcessor>(m_pInputManager);
-		m_pGfxEngine = std::make_shared<GfxEngine>(m_appName, k_appVersion, m_pWindow, m_pObjectProcessor);
+		m_pObjectProcessor = std::make_shared<ObjectProcessor>(m_pInputManager, m_pJobSystem);
+		m_pGfxEngine = std::make_shared<GfxEngine>(m_appName, k_appVersion, m_pWindow, m_pObjectProcessor, m_pJobSystem, m_settings.scene, m_settings.gfx);
+		m_pObjectProcessor->SetCameraPath(m_settings.pCameraPath);
+
+		if (m_settings.gfx.bLatencyMode)
+		{
+			//Nothing is published until the first frame has sampled input, see Process
+			SPDLOG_INFO("Latency mode, input and simulation run just in time on the render thread");
+			m_lastAdvanceTime = Clock::GetSeconds();
+			return;
+		}
+
+		//The scene is set up, from here on the simulation owns it and the renderer only sees snapshots
+		m_pObjectProcessor->PublishSnapshot(k_simulationStepSeconds, 0.0);
+		m_simulationThread = std::thread(&App::SimulationLoop, this);
 	}
 	catch (std::exception const& err)
 	{
@@ -42,16 +104,92 @@ void App::Start() {
 }
 
 bool App::ShouldQuit() noexcept{
-	return m_pWindow->ShouldClose();
+	bool const bFramesDone = m_settings.frameCount > 0 && m_framesRendered >= m_settings.warmupFrames + m_settings.frameCount;
+	return bFramesDone || (m_pWindow && m_pWindow->ShouldClose());
 }
 
 void App::Process() {
 	//Topmost error handler
 	try
 	{
-		glfwPollEvents();
-		m_pObjectProcessor->ProcessObjects(0.03f); //TODO actual deltatime getting
-		m_pGfxEngine->Render();
+		PROFILE_ZONE("Frame");
+		if (m_settings.bHeadless)
+		{
+			m_pGfxEngine->Render();
+			StepSimulation();
+		}
+		else if (m_settings.gfx.bLatencyMode)
+		{
+			//Input is sampled as late as the frame can start and still make the next refresh
+			m_pGfxEngine->WaitForFrameStart();
+			m_pInputManager->PollEvents();
+			AdvanceSimulation();
+			m_pGfxEngine->Render();
+		}
+		else
+		{
+			m_pInputManager->PollEvents();
+			m_pGfxEngine->Render();
+		}
+		m_framesRendered++;
+
+		if (m_pBenchmark && m_framesRendered > m_settings.warmupFrames)
+		{
+			m_pBenchmark->Record(m_pGfxEngine->GetLastFrameStats());
+		}
+
+		if (ShouldQuit())
+		{
+			FinishRun();
+		}
+	}
+	catch (std::exception& err)
+	{
+		SPDLOG_ERROR("Error: {}", err.what());
+		exit(-1);
+	}
+	catch (...)
+	{
+		SPDLOG_ERROR("An unknown error has occurred");
+		exit(-1);
+	}
+}
+
+void App::SimulationLoop() {
+	CpuProfiler::SetThreadName("Simulation");
+
+	//Topmost error handler for the simulation thread
+	try
+	{
+		FixedStepClock stepClock(k_simulationStepSeconds, k_maxSimulationStepsPerAdvance);
+		double lastTime = Clock::GetSeconds();
+		uint64_t reportedDroppedSteps = 0;
+
+		while (!m_stopSimulation)
+		{
+			double const now = Clock::GetSeconds();
+			uint32_t const steps = stepClock.Advance(now - lastTime);
+			lastTime = now;
+
+			if (steps == 0)
+			{
+				std::this_thread::sleep_for(std::chrono::duration<double>(stepClock.GetTimeToNextStep()));
+				continue;
+			}
+
+			for (uint32_t i = 0; i < steps; ++i)
+			{
+				m_pObjectProcessor->ProcessObjects(float(stepClock.GetStepSeconds()));
+			}
+
+			if (stepClock.GetDroppedStepCount() != reportedDroppedSteps)
+			{
+				SPDLOG_WARN("Simulation is behind real time, dropped {} steps", stepClock.GetDroppedStepCount() - reportedDroppedSteps);
+				reportedDroppedSteps = stepClock.GetDroppedStepCount();
+			}
+
+			m_pObjectProcessor->PublishSnapshot(stepClock.GetStepSeconds(), stepClock.GetAlpha());
+		}
 	}
 	catch (std::exception& err)
 	{
@@ -64,3 +202,41 @@ void App::Process() {
 		exit(-1);
 	}
 }
+
+void App::FinishRun() {
+	if (m_settings.bHeadless && !m_settings.capturePath.empty())
+	{
+		m_pGfxEngine->SaveFrame(m_settings.capturePath);
+	}
+
+	if (m_pBenchmark)
+	{
+		m_pBenchmark->WriteResults(m_pGfxEngine->GetGpuScopeStats());
+	}
+
+	if (!m_settings.tracePath.empty())
+	{
+		CpuProfiler::WriteChromeTrace(m_settings.tracePath);
+	}
+}
+
+void App::AdvanceSimulation() {
+	double const now = Clock::GetSeconds();
+	uint32_t const steps = m_stepClock.Advance(now - m_lastAdvanceTime);
+	m_lastAdvanceTime = now;
+
+	for (uint32_t i = 0; i < steps; ++i)
+	{
+		m_pObjectProcessor->ProcessObjects(float(m_stepClock.GetStepSeconds()));
+	}
+
+	//Published every frame, even without a step, so interpolation starts from the fresh alpha. The renderer picks up
+	// every snapshot straight after, so this never blocks
+	m_pObjectProcessor->PublishSnapshot(m_stepClock.GetStepSeconds(), m_stepClock.GetAlpha());
+}
+
+void App::StepSimulation() {
+	//The renderer has picked up the last snapshot by now, so publishing the next one never blocks
+	m_pObjectProcessor->ProcessObjects(float(k_simulationStepSeconds));
+	m_pObjectProcessor->PublishSnapshot(k_simulationStepSeconds, 1.0);
+}
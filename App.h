@@ -1,15 +1,43 @@
 #pragma once
 #include "Window.h"
 #include "GfxFwdDecl.h"
+#include "SceneSettings.h"
+#include "GfxSettings.h"
+#include "CameraPath.h"
+#include "Clock.h"
+
+#include <atomic>
+#include <thread>
 
 class InputManager;
 class ObjectProcessor;
+class JobSystem;
+class Benchmark;
+
+struct AppSettings
+{
+	//Renders offscreen without a window, the simulation steps once per frame so output is repeatable
+	bool bHeadless = false;
+	WindowDimensions renderSize = { 800, 600 };
+	GfxSettings gfx;
+	SceneSettings scene;
+	uint64_t warmupFrames = 0; //Rendered before frameCount starts counting and left out of benchmark results
+	uint64_t frameCount = 0; //Quit after this many frames, 0 runs until the window is closed
+	std::string capturePath; //Headless only, the last frame is written here as a PPM on quitting
+	CameraPathPtr_t pCameraPath; //Replaces input when set
+
+	//Benchmarking is on when either output is set, see Benchmark
+	std::string benchmarkCsvPath;
+	std::string benchmarkJsonPath;
+
+	std::string tracePath; //Cpu zones are recorded when set, and written here as a Chrome trace on quitting
+};
 
 //App is responsible for managing window lifetimes and the main event loop
 class App
 {
 public:
-	App(std::string const& appName);
+	App(std::string const& appName, AppSettings const& settings = {});
 	~App();
 
 	void Start();
@@ -18,10 +46,27 @@ public:
 	bool ShouldQuit() noexcept;
 
 private:
+	//Runs on its own thread, stepping objects and publishing snapshots for Process to render
+	void SimulationLoop();
+	//Headless replacement for SimulationLoop, runs on the render thread between frames
+	void StepSimulation();
+	//Latency mode replacement for SimulationLoop, steps in real time on the render thread straight after input is polled
+	void AdvanceSimulation();
+	//Writes out captures and benchmark results once the last frame is rendered
+	void FinishRun();
+
 	WindowPtr_t m_pWindow;
 	std::string const m_appName;
+	AppSettings const m_settings;
+	uint64_t m_framesRendered;
 	std::shared_ptr<GfxEngine> m_pGfxEngine;
 	std::shared_ptr<InputManager> m_pInputManager;
 	std::shared_ptr<ObjectProcessor> m_pObjectProcessor;
+	std::shared_ptr<JobSystem> m_pJobSystem;
+	std::shared_ptr<Benchmark> m_pBenchmark;
+	std::thread m_simulationThread;
+	std::atomic<bool> m_stopSimulation;
+	FixedStepClock m_stepClock; //Latency mode only, SimulationLoop keeps its own
+	double m_lastAdvanceTime;
 };
 
@@ -0,0 +1,228 @@
+#include "AssetManager.h"
+#include "GfxDevice.h"
+#include "ModelLoader.h"
+#include "ImageLoader.h"
+#include "Logger.h"
+#include "CpuProfiler.h"
+
+#include <algorithm>
+
+MeshData CreatePlaceholderMesh()
+{
+	//Single degenerate triangle, draws nothing but keeps the vertex and index buffers valid to bind
+	MeshPtr_t pMesh = std::make_shared<Mesh>();
+	pMesh->lods.push_back(MeshLod{ .indexOffset = 0, .indexCount = 3, .error = 0.0f });
+	pMesh->quantization = VertexQuantization{ .offset = { 0.0f, 0.0f, 0.0f, 0.0f }, .scale = { 1.0f, 1.0f, 1.0f, 1.0f } };
+
+	return MeshData{
+		.pMesh = pMesh,
+		.vertices = { PackedVertex{} },
+		.indices = { 0, 0, 0 }
+	};
+}
+
+ImageData CreatePlaceholderImage()
+{
+	return ImageData{
+		.pixels = { 255, 255, 255, 255 },
+		.levels = { ImageLevel{ .offset = 0, .size = 4, .width = 1, .height = 1 } },
+		.height = 1,
+		.width = 1,
+		.format = vk::Format::eR8G8B8A8Srgb
+	};
+}
+
+AssetManager::AssetManager(GfxDevicePtr_t pDevice, uint32_t workerCount)
+	: m_pDevice(pDevice)
+	, m_uploadCommandPool(pDevice->CreateGraphicsCommandPool())
+	, m_pPlaceholderMesh(nullptr)
+	, m_pPlaceholderTexture(nullptr)
+	, m_cacheMutex()
+	, m_meshes()
+	, m_textures()
+	, m_jobMutex()
+	, m_jobAvailable()
+	, m_jobs()
+	, m_stopping(false)
+	, m_workers()
+	, m_uploadMutex()
+	, m_uploads()
+	, m_pendingCount(0)
+{
+	MeshData const placeholderMesh = CreatePlaceholderMesh();
+	ModelLoader::UploadModel(*m_pDevice, placeholderMesh);
+	m_pPlaceholderMesh = placeholderMesh.pMesh;
+
+	m_pPlaceholderTexture = std::make_shared<GfxImage>(ImageLoader::UploadTexture(*m_pDevice, *m_uploadCommandPool, CreatePlaceholderImage()));
+
+	if (workerCount == 0)
+	{
+		//Leave room for the render thread and the job system
+		workerCount = std::max(1u, std::thread::hardware_concurrency() / 2);
+	}
+
+	for (uint32_t i = 0; i < workerCount; ++i)
+	{
+		m_workers.emplace_back(&AssetManager::WorkerLoop, this);
+	}
+	SPDLOG_INFO("Asset manager started with {} worker threads", workerCount);
+}
+
+AssetManager::~AssetManager()
+{
+	{
+		std::scoped_lock lock(m_jobMutex);
+		m_stopping = true;
+	}
+	m_jobAvailable.notify_all();
+
+	for (std::thread& worker : m_workers)
+	{
+		worker.join();
+	}
+}
+
+MeshHandle_t AssetManager::LoadMesh(std::string const& filePath)
+{
+	return Request<Mesh, MeshData>(
+		m_meshes,
+		m_pPlaceholderMesh,
+		filePath,
+		//Workers already load in parallel, splitting each file across every hardware thread as well would oversubscribe
+		[filePath]() { return ModelLoader::ParseModel(filePath, 1); },
+		[this](MeshData const& meshData)
+		{
+			ModelLoader::UploadModel(*m_pDevice, meshData);
+			return meshData.pMesh;
+		});
+}
+
+TextureHandle_t AssetManager::LoadTexture(std::string const& filePath, TextureCompression compression)
+{
+	//Devices without textureCompressionBC report no features for the BC formats, fall back to RGBA8 with blitted mips
+	if (compression != TextureCompression::eNone && !m_pDevice->SupportsSampledFormat(TextureCompressor::GetFormat(compression)))
+	{
+		SPDLOG_WARN("Device can't sample {}, loading {} uncompressed", TextureCompressor::GetName(compression), filePath);
+		compression = TextureCompression::eNone;
+	}
+
+	//The same image can be requested with different compression
+	return Request<GfxImage, ImageData>(
+		m_textures,
+		m_pPlaceholderTexture,
+		filePath + ":" + TextureCompressor::GetName(compression),
+		[filePath, compression]() { return ImageLoader::DecodeTexture(filePath, compression); },
+		[this](ImageData const& imageData)
+		{
+			return std::make_shared<GfxImage>(ImageLoader::UploadTexture(*m_pDevice, *m_uploadCommandPool, imageData));
+		});
+}
+
+template<typename T, typename Decoded>
+AssetHandle<T> AssetManager::Request(
+	AssetCache_t<T>& cache,
+	std::shared_ptr<T> const& pPlaceholder,
+	std::string const& key,
+	std::function<Decoded()> decode,
+	std::function<std::shared_ptr<T>(Decoded const&)> upload)
+{
+	std::shared_ptr<AssetSlot<T>> pSlot = nullptr;
+	{
+		std::scoped_lock lock(m_cacheMutex);
+		//Entries outlive their assets once every handle is gone, drop them so the cache doesn't grow with every path
+		// ever requested
+		std::erase_if(cache, [](auto const& entry) { return entry.second.expired(); });
+
+		std::weak_ptr<AssetSlot<T>>& cached = cache[key];
+		pSlot = cached.lock();
+		if (pSlot)
+		{
+			return AssetHandle<T>(pSlot, pPlaceholder);
+		}
+
+		pSlot = std::make_shared<AssetSlot<T>>(key);
+		cached = pSlot;
+	}
+
+	m_pendingCount++;
+	QueueJob([this, pSlot, decode, upload]()
+	{
+		std::shared_ptr<Decoded> pDecoded = nullptr;
+		try
+		{
+			pDecoded = std::make_shared<Decoded>(decode());
+		}
+		catch (std::exception const& e)
+		{
+			//Handles keep resolving to the placeholder
+			SPDLOG_ERROR("Failed to load {}: {}", pSlot->path, e.what());
+			m_pendingCount--;
+			return;
+		}
+
+		std::scoped_lock lock(m_uploadMutex);
+		m_uploads.push_back([pSlot, pDecoded, upload]()
+		{
+			pSlot->pAsset = upload(*pDecoded);
+			pSlot->ready.store(true, std::memory_order_release);
+			SPDLOG_DEBUG("Uploaded {}", pSlot->path);
+		});
+	});
+
+	return AssetHandle<T>(pSlot, pPlaceholder);
+}
+
+void AssetManager::ProcessUploads()
+{
+	PROFILE_ZONE("AssetManager::ProcessUploads");
+	std::vector<std::function<void()>> uploads;
+	{
+		std::scoped_lock lock(m_uploadMutex);
+		uploads.swap(m_uploads);
+	}
+
+	for (std::function<void()> const& upload : uploads)
+	{
+		try
+		{
+			upload();
+		}
+		catch (std::exception const& e)
+		{
+			SPDLOG_ERROR("Failed to upload asset: {}", e.what());
+		}
+		m_pendingCount--;
+	}
+}
+
+void AssetManager::QueueJob(std::function<void()> job)
+{
+	{
+		std::scoped_lock lock(m_jobMutex);
+		m_jobs.push_back(std::move(job));
+	}
+	m_jobAvailable.notify_one();
+}
+
+void AssetManager::WorkerLoop()
+{
+	CpuProfiler::SetThreadName("AssetWorker");
+
+	while (true)
+	{
+		std::function<void()> job;
+		{
+			std::unique_lock lock(m_jobMutex);
+			m_jobAvailable.wait(lock, [this]() { return m_stopping || !m_jobs.empty(); });
+			if (m_stopping)
+			{
+				return;
+			}
+
+			job = std::move(m_jobs.front());
+			m_jobs.pop_front();
+		}
+
+		job();
+	}
+}
\ No newline at end of file
@@ -0,0 +1,110 @@
+#pragma once
+#include "GfxFwdDecl.h"
+#include "GfxImage.h"
+#include "Mesh.h"
+#include "TextureCompressor.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+//Shared state of a single asset, kept alive by its handles and by any load still in flight
+template<typename T>
+struct AssetSlot
+{
+	AssetSlot(std::string const& filePath) : path(filePath), pAsset(nullptr), ready(false) {}
+
+	std::string path;
+	std::shared_ptr<T> pAsset; //Only written and read on the render thread once ready is set
+	std::atomic<bool> ready;
+};
+
+//Refcounted reference to an asset, resolves to a placeholder until the asset has finished loading
+template<typename T>
+class AssetHandle
+{
+public:
+	AssetHandle() = default;
+	AssetHandle(std::shared_ptr<AssetSlot<T>> pSlot, std::shared_ptr<T> pPlaceholder)
+		: m_pSlot(std::move(pSlot))
+		, m_pPlaceholder(std::move(pPlaceholder))
+	{}
+
+	bool IsReady() const noexcept { return m_pSlot && m_pSlot->ready.load(std::memory_order_acquire); }
+	T const& Get() const noexcept { return IsReady() ? *m_pSlot->pAsset : *m_pPlaceholder; }
+
+private:
+	std::shared_ptr<AssetSlot<T>> m_pSlot;
+	std::shared_ptr<T> m_pPlaceholder;
+};
+
+using MeshHandle_t = AssetHandle<Mesh>;
+using TextureHandle_t = AssetHandle<GfxImage>;
+
+//Loads meshes and textures on background threads. Decoding happens on the workers,
+//gpu resources are created when the render thread drains the upload queue in ProcessUploads
+class AssetManager
+{
+public:
+	AssetManager(GfxDevicePtr_t pDevice, uint32_t workerCount = 0);
+	~AssetManager();
+
+	AssetManager(AssetManager const&) = delete;
+	AssetManager(AssetManager&&) = delete;
+	AssetManager& operator=(AssetManager const&) = delete;
+	AssetManager& operator=(AssetManager&&) = delete;
+
+	//Requests for a path that is already loaded or loading share the same asset
+	MeshHandle_t LoadMesh(std::string const& filePath);
+	TextureHandle_t LoadTexture(std::string const& filePath, TextureCompression compression = TextureCompression::eBC7);
+
+	//Creates gpu resources for decoded assets and marks them ready, must be called from the render thread
+	void ProcessUploads();
+
+	//Number of requested assets that are not yet ready
+	size_t GetPendingCount() const noexcept { return m_pendingCount.load(); }
+
+private:
+	template<typename T>
+	using AssetCache_t = std::unordered_map<std::string, std::weak_ptr<AssetSlot<T>>>;
+
+	template<typename T, typename Decoded>
+	AssetHandle<T> Request(
+		AssetCache_t<T>& cache,
+		std::shared_ptr<T> const& pPlaceholder,
+		std::string const& key,
+		std::function<Decoded()> decode,
+		std::function<std::shared_ptr<T>(Decoded const&)> upload);
+
+	void QueueJob(std::function<void()> job);
+	void WorkerLoop();
+
+	GfxDevicePtr_t m_pDevice;
+	vk::raii::CommandPool m_uploadCommandPool;
+
+	std::shared_ptr<Mesh> m_pPlaceholderMesh;
+	std::shared_ptr<GfxImage> m_pPlaceholderTexture;
+
+	std::mutex m_cacheMutex;
+	AssetCache_t<Mesh> m_meshes;
+	AssetCache_t<GfxImage> m_textures;
+
+	std::mutex m_jobMutex;
+	std::condition_variable m_jobAvailable;
+	std::deque<std::function<void()>> m_jobs;
+	bool m_stopping;
+	std::vector<std::thread> m_workers;
+
+	//Decoded assets waiting on the render thread
+	std::mutex m_uploadMutex;
+	std::vector<std::function<void()>> m_uploads;
+
+	std::atomic<size_t> m_pendingCount;
+};
+
+using AssetManagerPtr_t = std::shared_ptr<AssetManager>;
\ No newline at end of file
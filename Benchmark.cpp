@@ -0,0 +1,302 @@
+#include "Benchmark.h"
+#include "Exceptions.h"
+#include "Logger.h"
+#include "GfxDevice.h"
+#include "TransformSimd.h"
+
+#include <algorithm>
+#include <cmath>
+#include <format>
+#include <fstream>
+#include <random>
+#include <sstream>
+
+constexpr double k_defaultCameraLoopSeconds = 10.0;
+
+struct Summary
+{
+	double min = 0.0;
+	double mean = 0.0;
+	double p50 = 0.0;
+	double p90 = 0.0;
+	double p95 = 0.0;
+	double p99 = 0.0;
+	double max = 0.0;
+};
+
+//Nearest rank percentile of sorted values
+double Percentile(std::vector<double> const& sorted, double percent)
+{
+	size_t const rank = size_t(std::ceil(percent / 100.0 * sorted.size()));
+	return sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1];
+}
+
+Summary Summarize(std::vector<double> values)
+{
+	Summary summary;
+	if (values.empty())
+	{
+		return summary;
+	}
+
+	std::sort(values.begin(), values.end());
+	double total = 0.0;
+	for (double const value : values)
+	{
+		total += value;
+	}
+
+	summary.min = values.front();
+	summary.mean = total / values.size();
+	summary.p50 = Percentile(values, 50.0);
+	summary.p90 = Percentile(values, 90.0);
+	summary.p95 = Percentile(values, 95.0);
+	summary.p99 = Percentile(values, 99.0);
+	summary.max = values.back();
+	return summary;
+}
+
+std::string ToJson(Summary const& summary)
+{
+	return std::format("{{ \"min\": {:.4f}, \"mean\": {:.4f}, \"p50\": {:.4f}, \"p90\": {:.4f}, \"p95\": {:.4f}, \"p99\": {:.4f}, \"max\": {:.4f} }}",
+		summary.min, summary.mean, summary.p50, summary.p90, summary.p95, summary.p99, summary.max);
+}
+
+template<typename T>
+T ParseValue(std::istringstream& stream, std::string const& key, std::string const& filePath, uint32_t lineNumber)
+{
+	T value{};
+	if (!(stream >> value))
+	{
+		throw InvalidStateException(std::format("Bad value for {} on line {} of benchmark config: {}", key, lineNumber, filePath));
+	}
+	return value;
+}
+
+AppSettings Benchmark::LoadSettings(std::string const& filePath)
+{
+	std::ifstream file(filePath);
+	if (!file.is_open())
+	{
+		throw InvalidStateException("Failed to open benchmark config: " + filePath);
+	}
+
+	//Benchmarks are mostly run on build machines, so default to no window
+	AppSettings settings;
+	settings.bHeadless = true;
+	double cameraLoopSeconds = k_defaultCameraLoopSeconds;
+	std::vector<CameraKey> cameraKeys;
+
+	std::string line;
+	uint32_t lineNumber = 0;
+	while (std::getline(file, line))
+	{
+		lineNumber++;
+		line = line.substr(0, line.find('#'));
+		size_t const separator = line.find('=');
+		if (separator == std::string::npos)
+		{
+			if (line.find_first_not_of(" \t\r") != std::string::npos)
+			{
+				throw InvalidStateException(std::format("Expected key = value on line {} of benchmark config: {}", lineNumber, filePath));
+			}
+			continue;
+		}
+
+		std::istringstream keyStream(line.substr(0, separator));
+		std::string key;
+		keyStream >> key;
+		std::istringstream valueStream(line.substr(separator + 1));
+
+		if (key == "headless") { settings.bHeadless = ParseValue<int>(valueStream, key, filePath, lineNumber) != 0; }
+		else if (key == "width") { std::get<0>(settings.renderSize) = ParseValue<uint32_t>(valueStream, key, filePath, lineNumber); }
+		else if (key == "height") { std::get<1>(settings.renderSize) = ParseValue<uint32_t>(valueStream, key, filePath, lineNumber); }
+		else if (key == "models") { settings.scene.modelCount = ParseValue<uint32_t>(valueStream, key, filePath, lineNumber); }
+		else if (key == "cubes") { settings.scene.cubeCount = ParseValue<uint32_t>(valueStream, key, filePath, lineNumber); }
+		else if (key == "terrainGridSize") { settings.scene.terrainGridSize = ParseValue<uint32_t>(valueStream, key, filePath, lineNumber); }
+		else if (key == "warmupFrames") { settings.warmupFrames = ParseValue<uint64_t>(valueStream, key, filePath, lineNumber); }
+		else if (key == "frames") { settings.frameCount = ParseValue<uint64_t>(valueStream, key, filePath, lineNumber); }
+		else if (key == "capture") { settings.capturePath = ParseValue<std::string>(valueStream, key, filePath, lineNumber); }
+		else if (key == "csv") { settings.benchmarkCsvPath = ParseValue<std::string>(valueStream, key, filePath, lineNumber); }
+		else if (key == "json") { settings.benchmarkJsonPath = ParseValue<std::string>(valueStream, key, filePath, lineNumber); }
+		else if (key == "trace") { settings.tracePath = ParseValue<std::string>(valueStream, key, filePath, lineNumber); }
+		else if (key == "present") { settings.gfx.presentMode = GfxDevice::ParsePresentMode(ParseValue<std::string>(valueStream, key, filePath, lineNumber)); }
+		else if (key == "framesInFlight") { settings.gfx.framesInFlight = ParseValue<uint32_t>(valueStream, key, filePath, lineNumber); }
+		else if (key == "latencyMode") { settings.gfx.bLatencyMode = ParseValue<int>(valueStream, key, filePath, lineNumber) != 0; }
+		else if (key == "dynamicRendering") { settings.gfx.bDynamicRendering = ParseValue<int>(valueStream, key, filePath, lineNumber) != 0; }
+		else if (key == "cameraLoopSeconds") { cameraLoopSeconds = ParseValue<double>(valueStream, key, filePath, lineNumber); }
+		else if (key == "cameraKey")
+		{
+			CameraKey cameraKey;
+			for (float* pComponent : { &cameraKey.position.x, &cameraKey.position.y, &cameraKey.position.z, &cameraKey.target.x, &cameraKey.target.y, &cameraKey.target.z })
+			{
+				*pComponent = ParseValue<float>(valueStream, key, filePath, lineNumber);
+			}
+			cameraKeys.push_back(cameraKey);
+		}
+		else
+		{
+			throw InvalidStateException(std::format("Unknown key {} on line {} of benchmark config: {}", key, lineNumber, filePath));
+		}
+	}
+
+	if (settings.frameCount == 0)
+	{
+		throw InvalidStateException("Benchmark config needs a frame count: " + filePath);
+	}
+
+	if (!cameraKeys.empty())
+	{
+		settings.pCameraPath = std::make_shared<CameraPath>(cameraKeys, cameraLoopSeconds);
+	}
+
+	return settings;
+}
+
+Benchmark::Benchmark(AppSettings const& settings)
+	: m_settings(settings)
+	, m_frames()
+{
+	m_frames.reserve(settings.frameCount);
+	CheckTransformParity();
+}
+
+void Benchmark::CheckTransformParity()
+{
+	//Not a multiple of 4 so the scalar tail is covered along with the SSE2 path
+	constexpr size_t k_transformCount = 103;
+	//Relative to the largest scale or translation involved
+	constexpr float k_parityTolerance = 1e-4f;
+
+	std::mt19937 random(1234);
+	std::uniform_real_distribution<float> positionRange(-1000.0f, 1000.0f);
+	std::uniform_real_distribution<float> scaleRange(-10.0f, 10.0f);
+	std::uniform_real_distribution<float> unitRange(-1.0f, 1.0f);
+
+	std::vector<glm::vec3> positions(k_transformCount);
+	std::vector<glm::quat> rotations(k_transformCount);
+	std::vector<glm::vec3> scales(k_transformCount);
+	for (size_t i = 0; i < k_transformCount; ++i)
+	{
+		positions[i] = glm::vec3(positionRange(random), positionRange(random), positionRange(random));
+		rotations[i] = glm::normalize(glm::quat(unitRange(random), unitRange(random), unitRange(random), unitRange(random)));
+		scales[i] = glm::vec3(scaleRange(random), scaleRange(random), scaleRange(random));
+	}
+	std::vector<uint8_t> dirty(k_transformCount, 1);
+	std::vector<glm::mat4> worldMatrices(k_transformCount);
+
+	TransformSimd::BuildWorldMatrices(positions, rotations, scales, dirty, worldMatrices);
+
+	for (size_t i = 0; i < k_transformCount; ++i)
+	{
+		glm::mat4 const reference = glm::translate(glm::identity<glm::mat4>(), positions[i]) * glm::mat4_cast(rotations[i]) * glm::scale(glm::identity<glm::mat4>(), scales[i]);
+		float const tolerance = k_parityTolerance * std::max({ 1.0f, std::abs(scales[i].x), std::abs(scales[i].y), std::abs(scales[i].z), glm::length(positions[i]) });
+		for (int column = 0; column < 4; ++column)
+		{
+			for (int row = 0; row < 4; ++row)
+			{
+				if (std::abs(worldMatrices[i][column][row] - reference[column][row]) > tolerance)
+				{
+					throw InvalidStateException(std::format("Simd world matrix {} differs from the glm reference at column {} row {}", i, column, row));
+				}
+			}
+		}
+	}
+}
+
+void Benchmark::Record(FrameStats const& stats)
+{
+	m_frames.push_back(stats);
+}
+
+void Benchmark::WriteResults(std::vector<GpuScopeStats> const& gpuScopes) const
+{
+	if (!m_settings.benchmarkCsvPath.empty())
+	{
+		WriteCsv(m_settings.benchmarkCsvPath);
+	}
+
+	if (!m_settings.benchmarkJsonPath.empty())
+	{
+		WriteJson(m_settings.benchmarkJsonPath, gpuScopes);
+	}
+}
+
+void Benchmark::WriteCsv(std::string const& filePath) const
+{
+	std::ofstream file(filePath, std::ios::trunc);
+	if (!file.is_open())
+	{
+		throw InvalidStateException("Failed to open benchmark csv for writing at: " + filePath);
+	}
+
+	file << "frame,cpu_ms,gpu_ms,draws,latency_ms\n";
+	for (size_t i = 0; i < m_frames.size(); ++i)
+	{
+		FrameStats const& frame = m_frames[i];
+		file << std::format("{},{:.4f},{:.4f},{},{:.4f}\n", i, frame.cpuMs, frame.gpuMs, frame.drawCount, frame.latencyMs);
+	}
+
+	SPDLOG_INFO("Wrote {} benchmark frames to {}", m_frames.size(), filePath);
+}
+
+void Benchmark::WriteJson(std::string const& filePath, std::vector<GpuScopeStats> const& gpuScopes) const
+{
+	std::vector<double> cpuMs;
+	std::vector<double> gpuMs;
+	std::vector<double> draws;
+	std::vector<double> latencyMs;
+	for (FrameStats const& frame : m_frames)
+	{
+		cpuMs.push_back(frame.cpuMs);
+		gpuMs.push_back(frame.gpuMs);
+		draws.push_back(frame.drawCount);
+		//Frames nothing drove, such as headless runs, have no latency to report
+		if (frame.latencyMs > 0.0)
+		{
+			latencyMs.push_back(frame.latencyMs);
+		}
+	}
+	Summary const cpuSummary = Summarize(cpuMs);
+	Summary const gpuSummary = Summarize(gpuMs);
+	Summary const drawSummary = Summarize(draws);
+	Summary const latencySummary = Summarize(latencyMs);
+
+	std::ofstream file(filePath, std::ios::trunc);
+	if (!file.is_open())
+	{
+		throw InvalidStateException("Failed to open benchmark json for writing at: " + filePath);
+	}
+
+	file << "{\n";
+	file << std::format("\t\"headless\": {},\n", m_settings.bHeadless);
+	file << std::format("\t\"width\": {},\n", std::get<0>(m_settings.renderSize));
+	file << std::format("\t\"height\": {},\n", std::get<1>(m_settings.renderSize));
+	file << std::format("\t\"latencyMode\": {},\n", m_settings.gfx.bLatencyMode);
+	file << std::format("\t\"dynamicRendering\": {},\n", m_settings.gfx.bDynamicRendering);
+	file << std::format("\t\"models\": {},\n", m_settings.scene.modelCount);
+	file << std::format("\t\"cubes\": {},\n", m_settings.scene.cubeCount);
+	file << std::format("\t\"terrainGridSize\": {},\n", m_settings.scene.terrainGridSize);
+	file << std::format("\t\"warmupFrames\": {},\n", m_settings.warmupFrames);
+	file << std::format("\t\"frames\": {},\n", m_frames.size());
+	file << std::format("\t\"cpuMs\": {},\n", ToJson(cpuSummary));
+	file << std::format("\t\"gpuMs\": {},\n", ToJson(gpuSummary));
+	file << std::format("\t\"draws\": {},\n", ToJson(drawSummary));
+	file << std::format("\t\"latencyMs\": {},\n", ToJson(latencySummary));
+	file << "\t\"gpuScopes\": {";
+	for (size_t i = 0; i < gpuScopes.size(); ++i)
+	{
+		GpuScopeStats const& scope = gpuScopes[i];
+		file << std::format("{}\n\t\t\"{}\": {{ \"averageMs\": {:.4f}, \"minMs\": {:.4f}, \"maxMs\": {:.4f} }}",
+			i == 0 ? "" : ",", scope.name, scope.averageMs, scope.minMs, scope.maxMs);
+	}
+	file << (gpuScopes.empty() ? "}\n" : "\n\t}\n");
+	file << "}\n";
+
+	SPDLOG_INFO("Benchmark cpu ms mean {:.3f} p95 {:.3f} p99 {:.3f}, gpu ms mean {:.3f} p95 {:.3f} p99 {:.3f}",
+		cpuSummary.mean, cpuSummary.p95, cpuSummary.p99, gpuSummary.mean, gpuSummary.p95, gpuSummary.p99);
+	if (!latencyMs.empty())
+	{
+		SPDLOG_INFO("Benchmark latency ms mean {:.3f} p95 {:.3f} p99 {:.3f}", latencySummary.mean, latencySummary.p95, latencySummary.p99);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,37 @@
+#pragma once
+#include "App.h"
+#include "FrameStats.h"
+#include "GfxGpuProfiler.h"
+
+#include <string>
+#include <vector>
+
+//Collects per frame timings after warm up and writes them out so runs can be compared between builds
+class Benchmark
+{
+public:
+	//Reads a benchmark config of "key = value" lines, # starts a comment. Keys:
+	// headless, width, height, present, framesInFlight, latencyMode, dynamicRendering, models, cubes, terrainGridSize,
+	// warmupFrames, frames, capture, csv, json, trace, cameraLoopSeconds, and cameraKey = px py pz tx ty tz repeated for
+	// each point the camera passes through
+	static AppSettings LoadSettings(std::string const& filePath);
+
+	explicit Benchmark(AppSettings const& settings);
+
+	void Record(FrameStats const& stats);
+
+	//Csv gets a row per recorded frame, json gets percentiles over the run along with the settings used
+	// and the gpu profiler's per scope timings
+	void WriteResults(std::vector<GpuScopeStats> const& gpuScopes) const;
+
+private:
+	//Builds world matrices for a fixed spread of transforms with TransformSimd and compares them against composing
+	// through glm, so a broken kernel throws before anything is timed rather than on the frame path
+	static void CheckTransformParity();
+
+	void WriteCsv(std::string const& filePath) const;
+	void WriteJson(std::string const& filePath, std::vector<GpuScopeStats> const& gpuScopes) const;
+
+	AppSettings m_settings;
+	std::vector<FrameStats> m_frames;
+};
\ No newline at end of file
@@ -4,6 +4,7 @@
 constexpr float k_cameraMoveSpeed = 1.0f;
 
 Camera::Camera(uint32_t screenWidth, uint32_t screenHeight)
+	: m_viewportHeight(static_cast<float>(screenHeight))
 {
     //hardcoded camera for now
 	m_position = { 2.0f, 4.0f, -6.0f };
@@ -41,6 +42,30 @@ void Camera::Process(ControllerInput const& inputState, float deltaTime)
 	m_cameraShaderData.viewProj = m_proj * glm::lookAt(m_position, m_target, m_up);
 }
 
+void Camera::LookAt(glm::vec3 const& position, glm::vec3 const& target)
+{
+	m_position = position;
+	m_target = target;
+	m_cameraShaderData.viewProj = m_proj * glm::lookAt(m_position, m_target, m_up);
+}
+
+void Camera::SetViewportSize(uint32_t screenWidth, uint32_t screenHeight)
+{
+	m_viewportHeight = static_cast<float>(screenHeight);
+	float const aspectRatio = (float)screenWidth / (float)screenHeight;
+	m_proj = glm::perspective(glm::radians(70.0f), aspectRatio, 0.1f, 100.0f);
+	m_cameraShaderData.viewProj = m_proj * glm::lookAt(m_position, m_target, m_up);
+}
+
+Camera Camera::Interpolate(Camera const& from, Camera const& to, float alpha)
+{
+	Camera result = to;
+	result.m_position = glm::mix(from.m_position, to.m_position, alpha);
+	result.m_target = glm::mix(from.m_target, to.m_target, alpha);
+	result.m_cameraShaderData.viewProj = result.m_proj * glm::lookAt(result.m_position, result.m_target, result.m_up);
+	return result;
+}
+
 glm::mat4 const& Camera::GetViewProj() const noexcept
 {
 	return m_cameraShaderData.viewProj;
@@ -50,3 +75,13 @@ glm::vec3 const& Camera::GetPosition() const noexcept
 {
 	return m_position;
 }
+
+glm::mat4 const& Camera::GetProjection() const noexcept
+{
+	return m_proj;
+}
+
+float Camera::GetViewportHeight() const noexcept
+{
+	return m_viewportHeight;
+}
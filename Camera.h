@@ -15,14 +15,23 @@ public:
 	Camera(uint32_t screenWidth, uint32_t screenHeight);
 
 	void Process(ControllerInput const& inputState, float deltaTime );
+	void LookAt(glm::vec3 const& position, glm::vec3 const& target);
+	//Rebuilds the projection for a new render target size
+	void SetViewportSize(uint32_t screenWidth, uint32_t screenHeight);
+
+	//Blends position and target, keeping the projection of to
+	static Camera Interpolate(Camera const& from, Camera const& to, float alpha);
 
 	glm::mat4 const& GetViewProj() const noexcept;
 	glm::vec3 const& GetPosition() const noexcept;
+	glm::mat4 const& GetProjection() const noexcept;
+	float GetViewportHeight() const noexcept;
 
 private:
 	glm::vec3 m_target;
 	glm::vec3 m_position;
 	glm::vec3 m_up;
 	glm::mat4 m_proj;
+	float m_viewportHeight;
 	CameraShaderData m_cameraShaderData;
 };
\ No newline at end of file
@@ -0,0 +1,44 @@
+#include "CameraPath.h"
+#include "Exceptions.h"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+glm::vec3 CatmullRom(glm::vec3 const& p0, glm::vec3 const& p1, glm::vec3 const& p2, glm::vec3 const& p3, float t)
+{
+	float const t2 = t * t;
+	float const t3 = t2 * t;
+	return 0.5f * ((2.0f * p1)
+		+ (p2 - p0) * t
+		+ (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * t2
+		+ (3.0f * p1 - p0 - 3.0f * p2 + p3) * t3);
+}
+
+CameraPath::CameraPath(std::vector<CameraKey> keys, double loopSeconds)
+	: m_keys(std::move(keys))
+	, m_loopSeconds(loopSeconds)
+{
+	if (m_keys.empty() || loopSeconds <= 0.0)
+	{
+		throw InitializationException("Camera path needs at least one key and a positive loop time, got " + std::to_string(m_keys.size()) + " keys");
+	}
+}
+
+CameraKey CameraPath::Sample(double seconds) const
+{
+	size_t const keyCount = m_keys.size();
+	double const loopPosition = std::fmod(std::max(seconds, 0.0), m_loopSeconds) / m_loopSeconds * keyCount;
+	size_t const segment = std::min(size_t(loopPosition), keyCount - 1);
+	float const t = float(loopPosition - double(segment));
+
+	CameraKey const& k0 = m_keys[(segment + keyCount - 1) % keyCount];
+	CameraKey const& k1 = m_keys[segment];
+	CameraKey const& k2 = m_keys[(segment + 1) % keyCount];
+	CameraKey const& k3 = m_keys[(segment + 2) % keyCount];
+
+	return CameraKey{
+		.position = CatmullRom(k0.position, k1.position, k2.position, k3.position, t),
+		.target = CatmullRom(k0.target, k1.target, k2.target, k3.target, t)
+	};
+}
\ No newline at end of file
@@ -0,0 +1,28 @@
+#pragma once
+#include "Math.h"
+
+#include <memory>
+#include <vector>
+
+struct CameraKey
+{
+	glm::vec3 position;
+	glm::vec3 target;
+};
+
+//Looping Catmull-Rom spline through camera keys, evenly spaced in time. Stands in for player input so benchmark runs
+// see the same views every time
+class CameraPath
+{
+public:
+	CameraPath(std::vector<CameraKey> keys, double loopSeconds);
+
+	//Wraps around once past loopSeconds
+	CameraKey Sample(double seconds) const;
+
+private:
+	std::vector<CameraKey> m_keys;
+	double m_loopSeconds;
+};
+
+using CameraPathPtr_t = std::shared_ptr<CameraPath const>;
\ No newline at end of file
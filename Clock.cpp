@@ -0,0 +1,55 @@
+#include "Clock.h"
+#include "Exceptions.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <string>
+
+double Clock::GetSeconds() noexcept
+{
+	static std::chrono::steady_clock::time_point const k_start = std::chrono::steady_clock::now();
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - k_start).count();
+}
+
+uint64_t Clock::GetNanoseconds() noexcept
+{
+	return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+FixedStepClock::FixedStepClock(double stepSeconds, uint32_t maxStepsPerAdvance)
+	: m_stepSeconds(stepSeconds)
+	, m_maxStepsPerAdvance(maxStepsPerAdvance)
+	, m_accumulator(0.0)
+	, m_stepCount(0)
+	, m_droppedStepCount(0)
+{
+	if (stepSeconds <= 0.0 || maxStepsPerAdvance == 0)
+	{
+		throw InitializationException("Fixed step clock needs a positive step and at least one step per advance, got step " + std::to_string(stepSeconds));
+	}
+}
+
+uint32_t FixedStepClock::Advance(double elapsedSeconds)
+{
+	m_accumulator += std::max(elapsedSeconds, 0.0);
+
+	double const dueSteps = std::floor(m_accumulator / m_stepSeconds);
+	uint32_t steps = m_maxStepsPerAdvance;
+	if (dueSteps <= m_maxStepsPerAdvance)
+	{
+		steps = uint32_t(dueSteps);
+		m_accumulator -= steps * m_stepSeconds;
+	}
+	else
+	{
+		//Keep the fraction so interpolation stays continuous, only whole steps are lost
+		m_droppedStepCount += uint64_t(dueSteps) - m_maxStepsPerAdvance;
+		m_accumulator -= dueSteps * m_stepSeconds;
+	}
+
+	//Rounding can leave a hair below zero
+	m_accumulator = std::max(m_accumulator, 0.0);
+	m_stepCount += steps;
+	return steps;
+}
\ No newline at end of file
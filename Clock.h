@@ -0,0 +1,39 @@
+#pragma once
+#include <cstdint>
+
+//Monotonic high resolution time, shared by every thread so timestamps taken on one can be compared on another
+class Clock
+{
+public:
+	//Seconds since the first call
+	static double GetSeconds() noexcept;
+	//Raw steady clock reading, cheaper than GetSeconds for hot paths that only need differences
+	static uint64_t GetNanoseconds() noexcept;
+};
+
+//Turns elapsed real time into a whole number of fixed simulation steps. Leftover time carries over to the next Advance
+// and is what the renderer interpolates across. Elapsed time is passed in rather than read so headless runs can
+// fast-forward by feeding in as much time as they like
+class FixedStepClock
+{
+public:
+	FixedStepClock(double stepSeconds, uint32_t maxStepsPerAdvance);
+
+	//Returns the number of steps due. Time needing more than maxStepsPerAdvance steps is dropped, so a simulation slower
+	// than real time falls behind instead of spiralling into ever longer catch up
+	uint32_t Advance(double elapsedSeconds);
+
+	double GetStepSeconds() const noexcept { return m_stepSeconds; }
+	//Fraction of a step accumulated but not yet simulated
+	double GetAlpha() const noexcept { return m_accumulator / m_stepSeconds; }
+	double GetTimeToNextStep() const noexcept { return m_stepSeconds - m_accumulator; }
+	uint64_t GetStepCount() const noexcept { return m_stepCount; }
+	uint64_t GetDroppedStepCount() const noexcept { return m_droppedStepCount; }
+
+private:
+	double m_stepSeconds;
+	uint32_t m_maxStepsPerAdvance;
+	double m_accumulator;
+	uint64_t m_stepCount;
+	uint64_t m_droppedStepCount;
+};
\ No newline at end of file
@@ -0,0 +1,159 @@
+#include "CpuProfiler.h"
+#include "Exceptions.h"
+#include "Logger.h"
+
+#include <algorithm>
+#include <atomic>
+#include <format>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+struct CpuZoneEvent
+{
+	char const* name;
+	uint64_t beginTicks;
+	uint64_t endTicks;
+};
+
+struct ThreadZones
+{
+	ThreadZones(uint32_t id) : events(std::make_unique<CpuZoneEvent[]>(k_cpuZonesPerThread)), written(0), threadId(id), name(nullptr) {}
+
+	std::unique_ptr<CpuZoneEvent[]> events;
+	std::atomic<uint64_t> written; //Total ever recorded, the ring holds the last k_cpuZonesPerThread of them
+	uint32_t threadId;
+	std::atomic<char const*> name;
+};
+
+std::atomic<bool> g_cpuProfilerEnabled = false;
+
+//Taken when recording is first enabled, paired with a reading at export to find the tick rate
+std::atomic<uint64_t> g_calibrationTicks = 0;
+std::atomic<uint64_t> g_calibrationNs = 0;
+
+//Rings outlive their threads so zones from workers that have already exited can still be exported
+std::mutex g_threadZonesMutex;
+std::vector<std::unique_ptr<ThreadZones>> g_threadZones;
+
+thread_local ThreadZones* t_pThreadZones = nullptr;
+
+ThreadZones& GetThreadZones()
+{
+	if (!t_pThreadZones)
+	{
+		std::scoped_lock lock(g_threadZonesMutex);
+		g_threadZones.push_back(std::make_unique<ThreadZones>(uint32_t(g_threadZones.size())));
+		t_pThreadZones = g_threadZones.back().get();
+	}
+	return *t_pThreadZones;
+}
+
+void CpuProfiler::SetEnabled(bool bEnabled) noexcept
+{
+	if (bEnabled && g_calibrationNs.load() == 0)
+	{
+		g_calibrationTicks = GetTicks();
+		g_calibrationNs = Clock::GetNanoseconds();
+	}
+	g_cpuProfilerEnabled.store(bEnabled, std::memory_order_relaxed);
+}
+
+bool CpuProfiler::IsEnabled() noexcept
+{
+	return g_cpuProfilerEnabled.load(std::memory_order_relaxed);
+}
+
+void CpuProfiler::SetThreadName(CpuZoneName name)
+{
+	GetThreadZones().name.store(name.Get(), std::memory_order_relaxed);
+}
+
+void CpuProfiler::RecordZone(CpuZoneName name, uint64_t beginTicks, uint64_t endTicks) noexcept
+{
+	ThreadZones& zones = GetThreadZones();
+	uint64_t const index = zones.written.load(std::memory_order_relaxed);
+	zones.events[index & (k_cpuZonesPerThread - 1)] = CpuZoneEvent{ .name = name.Get(), .beginTicks = beginTicks, .endTicks = endTicks };
+	zones.written.store(index + 1, std::memory_order_release);
+}
+
+void CpuProfiler::WriteChromeTrace(std::string const& filePath)
+{
+	struct ThreadCopy
+	{
+		uint32_t threadId;
+		char const* name;
+		std::vector<CpuZoneEvent> events;
+	};
+
+	std::vector<ThreadCopy> threads;
+	{
+		std::scoped_lock lock(g_threadZonesMutex);
+		for (std::unique_ptr<ThreadZones> const& pZones : g_threadZones)
+		{
+			uint64_t const written = pZones->written.load(std::memory_order_acquire);
+			uint64_t const first = written > k_cpuZonesPerThread ? written - k_cpuZonesPerThread : 0;
+
+			ThreadCopy copy{ .threadId = pZones->threadId, .name = pZones->name.load(std::memory_order_relaxed), .events = {} };
+			for (uint64_t i = first; i < written; ++i)
+			{
+				copy.events.push_back(pZones->events[i & (k_cpuZonesPerThread - 1)]);
+			}
+
+			//The owner kept recording while we copied, anything it could have written over is dropped.
+			//The slot after the last published one may also be mid write
+			uint64_t const writtenAfter = pZones->written.load(std::memory_order_acquire);
+			uint64_t const firstIntact = writtenAfter + 1 > k_cpuZonesPerThread ? writtenAfter + 1 - k_cpuZonesPerThread : 0;
+			if (firstIntact > first)
+			{
+				copy.events.erase(copy.events.begin(), copy.events.begin() + std::min<uint64_t>(firstIntact - first, copy.events.size()));
+			}
+			threads.push_back(std::move(copy));
+		}
+	}
+
+	uint64_t traceBeginTicks = UINT64_MAX;
+	size_t zoneCount = 0;
+	for (ThreadCopy const& thread : threads)
+	{
+		for (CpuZoneEvent const& event : thread.events)
+		{
+			traceBeginTicks = std::min(traceBeginTicks, event.beginTicks);
+		}
+		zoneCount += thread.events.size();
+	}
+
+	uint64_t const elapsedTicks = GetTicks() - g_calibrationTicks.load();
+	uint64_t const elapsedNs = Clock::GetNanoseconds() - g_calibrationNs.load();
+	double const usPerTick = elapsedTicks > 0 ? double(elapsedNs) / double(elapsedTicks) / 1000.0 : 0.0;
+
+	std::ofstream file(filePath, std::ios::trunc);
+	if (!file.is_open())
+	{
+		throw InvalidStateException("Failed to open trace file for writing at: " + filePath);
+	}
+
+	//Chrome trace times are in microseconds
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	bool bFirstEvent = true;
+	for (ThreadCopy const& thread : threads)
+	{
+		if (thread.name)
+		{
+			file << std::format("{}{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":{},\"args\":{{\"name\":\"{}\"}}}}",
+				bFirstEvent ? "" : ",\n", thread.threadId, thread.name);
+			bFirstEvent = false;
+		}
+
+		for (CpuZoneEvent const& event : thread.events)
+		{
+			file << std::format("{}{{\"name\":\"{}\",\"ph\":\"X\",\"pid\":1,\"tid\":{},\"ts\":{:.3f},\"dur\":{:.3f}}}",
+				bFirstEvent ? "" : ",\n", event.name, thread.threadId, double(event.beginTicks - traceBeginTicks) * usPerTick, double(event.endTicks - event.beginTicks) * usPerTick);
+			bFirstEvent = false;
+		}
+	}
+	file << "\n]}\n";
+
+	SPDLOG_INFO("Wrote {} cpu zones from {} threads to {}", zoneCount, threads.size(), filePath);
+}
\ No newline at end of file
@@ -0,0 +1,89 @@
+#pragma once
+#include "Clock.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#if defined(_M_X64)
+#include <intrin.h>
+#elif defined(__x86_64__)
+#include <x86intrin.h>
+#endif
+
+//Zones kept per thread, once a thread's ring is full its oldest zones are overwritten
+constexpr uint32_t k_cpuZonesPerThread = 1 << 15;
+static_assert((k_cpuZonesPerThread & (k_cpuZonesPerThread - 1)) == 0, "Ring size must be a power of two");
+
+//Zone names have to be string literals. Only the pointer is stored, so recording never copies or hashes a name
+class CpuZoneName
+{
+public:
+	template<size_t N>
+	consteval CpuZoneName(char const (&name)[N]) : m_name(name) {}
+
+	char const* Get() const noexcept { return m_name; }
+
+private:
+	char const* m_name;
+};
+
+//Records timed zones into a ring buffer per thread. Only the owning thread writes its ring so recording takes no locks,
+// exporting reads the rings from another thread and drops anything overwritten while it was being copied
+class CpuProfiler
+{
+public:
+	//Recording is off until enabled, disabled zones cost a flag check
+	static void SetEnabled(bool bEnabled) noexcept;
+	static bool IsEnabled() noexcept;
+
+	//Labels the calling thread in exported traces
+	static void SetThreadName(CpuZoneName name);
+
+	//Zone timestamps are raw cpu ticks as a steady clock read costs as much as the rest of a zone put together.
+	// They're converted to time on export, against steady clock readings taken on enabling and on exporting
+	static uint64_t GetTicks() noexcept
+	{
+#if defined(_M_X64) || defined(__x86_64__)
+		return __rdtsc();
+#else
+		return Clock::GetNanoseconds();
+#endif
+	}
+
+	static void RecordZone(CpuZoneName name, uint64_t beginTicks, uint64_t endTicks) noexcept;
+
+	//Writes every zone still held in the rings as Chrome trace event json, which Perfetto and chrome://tracing open.
+	//Nesting comes from the zones' times, so the hierarchy on each thread is rebuilt by the viewer
+	static void WriteChromeTrace(std::string const& filePath);
+};
+
+//Times its own lifetime, use through PROFILE_ZONE
+class CpuZone
+{
+public:
+	explicit CpuZone(CpuZoneName name) noexcept
+		: m_name(name)
+		, m_beginTicks(CpuProfiler::IsEnabled() ? CpuProfiler::GetTicks() : 0)
+	{}
+
+	~CpuZone()
+	{
+		if (m_beginTicks != 0)
+		{
+			CpuProfiler::RecordZone(m_name, m_beginTicks, CpuProfiler::GetTicks());
+		}
+	}
+
+	CpuZone(CpuZone const&) = delete;
+	CpuZone& operator=(CpuZone const&) = delete;
+
+private:
+	CpuZoneName m_name;
+	uint64_t m_beginTicks; //0 when the profiler was disabled at the start of the zone
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+//Times the rest of the enclosing scope
+#define PROFILE_ZONE(name) CpuZone PROFILE_CONCAT(cpuZone_, __LINE__)(name)
\ No newline at end of file
@@ -0,0 +1,52 @@
+#include "FramePacer.h"
+
+#include <algorithm>
+
+//Left between the gpu finishing and the refresh, covers the present itself and sleeps waking up late
+constexpr double k_pacingMarginSeconds = 0.001;
+//Longer gaps are hitches or the window being hidden rather than the display rate
+constexpr double k_maxRefreshSeconds = 0.1;
+//The refresh interval follows shorter samples quickly since a missed refresh only ever makes a sample longer. Work
+// time does the opposite, a spike pushes the start earlier straight away and is only forgotten slowly
+constexpr double k_refreshFallRate = 0.5;
+constexpr double k_refreshRiseRate = 0.02;
+constexpr double k_workFallRate = 0.05;
+
+FramePacer::FramePacer()
+	: m_lastDisplayTime(0.0)
+	, m_refreshSeconds(0.0)
+	, m_workSeconds(0.0)
+{
+}
+
+void FramePacer::FrameDisplayed(double startTime, double gpuDoneTime, double displayTime)
+{
+	if (m_lastDisplayTime > 0.0)
+	{
+		double const interval = std::min(displayTime - m_lastDisplayTime, k_maxRefreshSeconds);
+		if (m_refreshSeconds == 0.0)
+		{
+			m_refreshSeconds = interval;
+		}
+		else
+		{
+			double const rate = interval < m_refreshSeconds ? k_refreshFallRate : k_refreshRiseRate;
+			m_refreshSeconds += (interval - m_refreshSeconds) * rate;
+		}
+	}
+	m_lastDisplayTime = displayTime;
+
+	double const work = std::max(gpuDoneTime - startTime, 0.0);
+	m_workSeconds = work > m_workSeconds ? work : m_workSeconds + (work - m_workSeconds) * k_workFallRate;
+}
+
+double FramePacer::GetNextStartTime(double now) const noexcept
+{
+	if (m_refreshSeconds == 0.0)
+	{
+		return now;
+	}
+
+	double const startTime = m_lastDisplayTime + m_refreshSeconds - m_workSeconds - k_pacingMarginSeconds;
+	return std::clamp(startTime, now, now + m_refreshSeconds);
+}
\ No newline at end of file
@@ -0,0 +1,21 @@
+#pragma once
+
+//Estimates when a frame has to start so it finishes just before the display takes the next one. Sampling input at
+// that point rather than as soon as the previous frame is done keeps the gap between input and photons to about one
+// frame of work. Needs the time frames actually reached the display, see GfxDevice::SupportsPresentWait
+class FramePacer
+{
+public:
+	FramePacer();
+
+	//Times are clock seconds. startTime is when the frame sampled input, gpuDoneTime when its work finished and
+	// displayTime when its present completed
+	void FrameDisplayed(double startTime, double gpuDoneTime, double displayTime);
+	//Start time aiming for the refresh after the last displayed frame, now if there is no estimate yet or it's too late
+	double GetNextStartTime(double now) const noexcept;
+
+private:
+	double m_lastDisplayTime; //0 until the first frame is displayed
+	double m_refreshSeconds; //Smoothed interval between displayed frames, 0 until there is one
+	double m_workSeconds; //Start to gpu done, smoothed
+};
\ No newline at end of file
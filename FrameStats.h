@@ -0,0 +1,17 @@
+#pragma once
+#include <cstdint>
+
+struct FrameStats
+{
+	double cpuMs = 0.0; //Recording and submitting on the render thread
+	//Span of the profiled gpu work, 0 if the device can't write timestamps. Read back without waiting, so this is from
+	// the frame GfxSettings::framesInFlight behind
+	double gpuMs = 0.0;
+	uint32_t drawCount = 0;
+	uint64_t gpuMemoryBytes = 0; //In use on device local heaps, 0 if the driver doesn't report it
+	//Input sampled to the frame reaching the display, or to the gpu finishing it without VK_KHR_present_wait. 0 when
+	// nothing drove the simulation. In latency mode this is the frame before, its present is waited on before the next.
+	//Gpu completion is only seen when the frame's fence is waited on, outside latency mode that is when its slot comes
+	// round again, so it can overstate by up to GfxSettings::framesInFlight frames
+	double latencyMs = 0.0;
+};
\ No newline at end of file
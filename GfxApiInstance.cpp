@@ -59,7 +59,7 @@ std::vector<char const*> GetGlfwExtensions() {
 	return extensions;
 }
 
-GfxApiInstance::GfxApiInstance(std::string const& applicationName, uint32_t appVersion, std::string const& engineName, uint32_t const engineVersion, uint32_t const vulkanVersion )
+GfxApiInstance::GfxApiInstance(std::string const& applicationName, uint32_t appVersion, std::string const& engineName, uint32_t const engineVersion, uint32_t const vulkanVersion, bool bPresentation)
 	: m_pContext(std::make_shared<vk::raii::Context>())
 	, m_pInstance()
 	, m_debugMessenger(nullptr)
@@ -75,7 +75,7 @@ GfxApiInstance::GfxApiInstance(std::string const& applicationName, uint32_t appV
 		vulkanVersion);
 
 	std::vector<char const*> enabledLayers = k_instanceLayers;
-	std::vector<char const*> enabledExtensions = GetGlfwExtensions();
+	std::vector<char const*> enabledExtensions = bPresentation ? GetGlfwExtensions() : std::vector<char const*>();
 	enabledExtensions.insert(enabledExtensions.end(), k_instanceExtensions.begin(), k_instanceExtensions.end());
 
 	vk::InstanceCreateInfo instanceCreateInfo({}/*flags*/, &appInfo, enabledLayers, enabledExtensions);
@@ -10,7 +10,8 @@ public:
 		uint32_t appVersion,
 		std::string const& engineName,
 		uint32_t const engineVersion,
-		uint32_t const vulkanVersion);
+		uint32_t const vulkanVersion,
+		bool bPresentation = true); //Headless instances skip the window system extensions
 	~GfxApiInstance();
 
 	vk::raii::Instance const& GetInstance() const { return *m_pInstance.get();}
@@ -4,8 +4,9 @@
 
 #include <algorithm>
 
-GfxDescriptorManager::GfxDescriptorManager(GfxDevicePtr_t pDevice)
-	: m_descriptorPool(nullptr)
+GfxDescriptorManager::GfxDescriptorManager(GfxDevicePtr_t pDevice, uint32_t setCount)
+	: m_setCount(setCount)
+	, m_descriptorPool(nullptr)
 	, m_descriptorSlots()
 	, m_pGfxDevice(pDevice)
 {
@@ -29,7 +30,7 @@ GfxDescriptorManager::GfxDescriptorManager(GfxDevicePtr_t pDevice)
 
 	vk::DescriptorPoolCreateInfo poolCreateInfo(
 		{vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet},
-		usageFrequencies.size(),
+		uint32_t(usageFrequencies.size()) * m_setCount,
 		poolSizes
 	);
 
@@ -43,18 +44,24 @@ GfxDescriptorManager::GfxDescriptorManager(GfxDevicePtr_t pDevice)
 
 }
 
-void GfxDescriptorManager::AddBinding(uint32_t bindingId, vk::ShaderStageFlagBits bindToStage, DataUsageFrequency usageFrequency, vk::DescriptorType type)
+void GfxDescriptorManager::AddBinding(uint32_t bindingId, vk::ShaderStageFlagBits bindToStage, DataUsageFrequency usageFrequency, vk::DescriptorType type, SamplerPtr_t pImmutableSampler)
 {
+	//Points into the cached sampler object which stays put while pImmutableSampler is held
+	vk::Sampler const* pSamplerHandle = pImmutableSampler ? &**pImmutableSampler : nullptr;
 	vk::DescriptorSetLayoutBinding dslBinding(
 		bindingId,
 		type,
 		1 /*assuming 1 descriptor, no arrays*/,
 		bindToStage,
-		nullptr
+		pSamplerHandle
 	);
 
 	DescriptorInfo& info = m_descriptorSlots.at(usageFrequency);
 	info.bindings.push_back(dslBinding);
+	if (pImmutableSampler)
+	{
+		info.immutableSamplers.push_back(pImmutableSampler);
+	}
 
 	//Sort every time for now
 	std::sort(info.bindings.begin(), info.bindings.end(),
@@ -68,14 +75,20 @@ void GfxDescriptorManager::AddBinding(uint32_t bindingId, vk::ShaderStageFlagBit
 	vk::DescriptorSetLayoutCreateInfo dslCreateInfo({}, info.bindings);
 	info.layout = std::move(vk::raii::DescriptorSetLayout(m_pGfxDevice->GetDevice(), dslCreateInfo));
 
-	//One layout per set, but we can allocate multiple sets at once
-	vk::DescriptorSetAllocateInfo dsaInfo(*m_descriptorPool, *info.layout);
-	info.set = std::move(m_pGfxDevice->GetDevice().allocateDescriptorSets(dsaInfo).front());
+	//One layout per set, but we can allocate multiple sets at once. The old sets go back to the pool first so it
+	// never needs room for both
+	info.sets.clear();
+	std::vector<vk::DescriptorSetLayout> const setLayouts(m_setCount, *info.layout);
+	vk::DescriptorSetAllocateInfo dsaInfo(*m_descriptorPool, setLayouts);
+	for (vk::raii::DescriptorSet& set : m_pGfxDevice->GetDevice().allocateDescriptorSets(dsaInfo))
+	{
+		info.sets.push_back(std::move(set));
+	}
 }
 
-vk::DescriptorSet GfxDescriptorManager::GetDescriptor(DataUsageFrequency usageFrequency) const
+vk::DescriptorSet GfxDescriptorManager::GetDescriptor(DataUsageFrequency usageFrequency, uint32_t setIndex) const
 {
-	return *m_descriptorSlots.at(usageFrequency).set;
+	return *m_descriptorSlots.at(usageFrequency).sets.at(setIndex);
 }
 
 vk::DescriptorSetLayout GfxDescriptorManager::GetLayout(DataUsageFrequency usageFrequency) const
@@ -88,13 +101,13 @@ DescriptorInfo const*  GfxDescriptorManager::GetDescriptorInfo(DataUsageFrequenc
 	return &m_descriptorSlots.at(usageFrequency);
 }
 
-vk::WriteDescriptorSet GfxDescriptorManager::GetWriteDescriptor(DataUsageFrequency usageFrequency, uint32_t bindingId) const
+vk::WriteDescriptorSet GfxDescriptorManager::GetWriteDescriptor(DataUsageFrequency usageFrequency, uint32_t bindingId, uint32_t setIndex) const
 {
 	DescriptorInfo const& info = m_descriptorSlots.at(usageFrequency);
 	vk::DescriptorSetLayoutBinding const& binding = info.bindings.at(bindingId);
 
 	vk::WriteDescriptorSet writeDescriptor(
-		*info.set,
+		*info.sets.at(setIndex),
 		binding.binding,
 		0,
 		binding.descriptorType,
@@ -104,16 +117,15 @@ vk::WriteDescriptorSet GfxDescriptorManager::GetWriteDescriptor(DataUsageFrequen
 	return writeDescriptor;
 }
 
-std::vector<vk::DescriptorSet> GfxDescriptorManager::GetDescriptors() const
+std::vector<vk::DescriptorSet> GfxDescriptorManager::GetDescriptors(uint32_t setIndex) const
 {
 	std::vector<vk::DescriptorSet> descriptors;
 	//Copy only initialized descriptor sets out
 	for (auto const& descriptorPair : m_descriptorSlots)
 	{
-		vk::DescriptorSet set = *descriptorPair.second.set;
-		if (set)
+		if (!descriptorPair.second.sets.empty())
 		{
-			descriptors.push_back(set);
+			descriptors.push_back(*descriptorPair.second.sets.at(setIndex));
 		}
 	}
 	return descriptors;
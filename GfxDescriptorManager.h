@@ -11,14 +11,18 @@ enum class DataUsageFrequency {
 
 struct DescriptorInfo {
 	DescriptorInfo() noexcept
-		: set(nullptr)
+		: sets()
 		, layout(nullptr)
 		, bindings()
+		, immutableSamplers()
 	{}
-	vk::raii::DescriptorSet set;
+	//One per set index, so each frame in flight can write its own while the others are still being read
+	std::vector<vk::raii::DescriptorSet> sets;
 	vk::raii::DescriptorSetLayout layout;
 	//Assume compact vector where position in array matches binding id
 	std::vector<vk::DescriptorSetLayoutBinding> bindings;
+	//Keeps samplers referenced by bindings alive for as long as the layout
+	std::vector<SamplerPtr_t> immutableSamplers;
 };
 
 using DescriptorSlotMap = std::unordered_map<DataUsageFrequency, DescriptorInfo>;
@@ -26,22 +30,26 @@ using DescriptorSlotMap = std::unordered_map<DataUsageFrequency, DescriptorInfo>
 constexpr uint32_t k_MaxDescriptorsToAllocate = 100; /* arbitrary*/
 
 //Descriptor manager holds the descriptor pools for the engine as well as a set of pre-defined descriptorSets
-// which other components can specify they want to add things to
+// which other components can specify they want to add things to.
+//Every usage frequency gets setCount copies of its set sharing one layout, indexed by frame slot by the engine
 class GfxDescriptorManager
 {
 public:
-	GfxDescriptorManager(GfxDevicePtr_t pDevice);
+	GfxDescriptorManager(GfxDevicePtr_t pDevice, uint32_t setCount = 1);
 
-	void AddBinding(uint32_t bindingId, vk::ShaderStageFlagBits bindToStage, DataUsageFrequency usageFrequency, vk::DescriptorType type);
+	//A sampler bakes it into the layout as an immutable sampler, writes to the binding then only need to supply image views
+	void AddBinding(uint32_t bindingId, vk::ShaderStageFlagBits bindToStage, DataUsageFrequency usageFrequency, vk::DescriptorType type, SamplerPtr_t pImmutableSampler = nullptr);
 
-	vk::DescriptorSet GetDescriptor(DataUsageFrequency usageFrequency) const;
+	vk::DescriptorSet GetDescriptor(DataUsageFrequency usageFrequency, uint32_t setIndex = 0) const;
 	vk::DescriptorSetLayout GetLayout(DataUsageFrequency usageFrequency) const;
 	DescriptorInfo const* GetDescriptorInfo(DataUsageFrequency usageFrequency) const;
-	vk::WriteDescriptorSet GetWriteDescriptor(DataUsageFrequency usageFrequency, uint32_t bindingId) const;
+	vk::WriteDescriptorSet GetWriteDescriptor(DataUsageFrequency usageFrequency, uint32_t bindingId, uint32_t setIndex = 0) const;
 
-	std::vector<vk::DescriptorSet> GetDescriptors() const;
+	std::vector<vk::DescriptorSet> GetDescriptors(uint32_t setIndex = 0) const;
+	uint32_t GetSetCount() const noexcept { return m_setCount; }
 
 private:
+	uint32_t m_setCount;
 	vk::raii::DescriptorPool m_descriptorPool;
 	DescriptorSlotMap m_descriptorSlots;
 	GfxDevicePtr_t m_pGfxDevice;
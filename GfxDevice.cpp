@@ -6,6 +6,8 @@
 #include "Exceptions.h"
 #include "Logger.h"
 #include <bitset>
+#include <algorithm>
+#include <cctype>
 
 
 template<typename T>
@@ -156,8 +158,117 @@ uint32_t GetGraphicsQueueFamilyIndex(std::vector<vk::QueueFamilyProperties> cons
 	return static_cast<uint32_t>(std::distance(queueFamilyProperties.begin(), graphicsQueueFamilyProperty));
 }
 
+bool SupportsExtension(vk::raii::PhysicalDevice const& physicalDevice, char const* extensionName)
+{
+	for (auto const& extension : physicalDevice.enumerateDeviceExtensionProperties())
+	{
+		if (std::strcmp(extensionName, extension.extensionName) == 0)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+vk::PresentModeKHR ChoosePresentMode(std::vector<vk::PresentModeKHR> const& supportedModes, vk::PresentModeKHR desiredMode)
+{
+	//The uncapped modes stand in for each other before falling back to fifo, which every surface supports
+	std::vector<vk::PresentModeKHR> candidates = { desiredMode };
+	if (desiredMode == vk::PresentModeKHR::eMailbox)
+	{
+		candidates.push_back(vk::PresentModeKHR::eImmediate);
+	}
+	else if (desiredMode == vk::PresentModeKHR::eImmediate)
+	{
+		candidates.push_back(vk::PresentModeKHR::eMailbox);
+	}
+
+	for (vk::PresentModeKHR const candidate : candidates)
+	{
+		if (std::find(supportedModes.begin(), supportedModes.end(), candidate) != supportedModes.end())
+		{
+			return candidate;
+		}
+	}
+	return vk::PresentModeKHR::eFifo;
+}
+
+//Optional, only used for measuring latency. Waiting on presents needs a swapchain, so only considered when presenting
+bool SupportsPresentWait(vk::raii::PhysicalDevice const& physicalDevice, std::vector<char const*> const& enabledExtensions)
+{
+	bool const bPresenting = std::any_of(enabledExtensions.begin(), enabledExtensions.end(),
+		[](char const* extensionName) { return std::strcmp(extensionName, VK_KHR_SWAPCHAIN_EXTENSION_NAME) == 0; });
+	if (!bPresenting
+		|| !SupportsExtension(physicalDevice, VK_KHR_PRESENT_ID_EXTENSION_NAME)
+		|| !SupportsExtension(physicalDevice, VK_KHR_PRESENT_WAIT_EXTENSION_NAME))
+	{
+		return false;
+	}
+
+	auto const chain = physicalDevice.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDevicePresentIdFeaturesKHR, vk::PhysicalDevicePresentWaitFeaturesKHR>();
+	return chain.get<vk::PhysicalDevicePresentIdFeaturesKHR>().presentId && chain.get<vk::PhysicalDevicePresentWaitFeaturesKHR>().presentWait;
+}
+
+//Optional, render passes and framebuffers are used without it
+bool SupportsDynamicRendering(vk::raii::PhysicalDevice const& physicalDevice)
+{
+	if (!SupportsExtension(physicalDevice, VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME))
+	{
+		return false;
+	}
+
+	auto const chain = physicalDevice.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceDynamicRenderingFeaturesKHR>();
+	return chain.get<vk::PhysicalDeviceDynamicRenderingFeaturesKHR>().dynamicRendering;
+}
+
+//Optional, cull mode and depth state are baked into pipelines without it
+bool SupportsExtendedDynamicState(vk::raii::PhysicalDevice const& physicalDevice)
+{
+	if (!SupportsExtension(physicalDevice, VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME))
+	{
+		return false;
+	}
+
+	auto const chain = physicalDevice.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceExtendedDynamicStateFeaturesEXT>();
+	return chain.get<vk::PhysicalDeviceExtendedDynamicStateFeaturesEXT>().extendedDynamicState;
+}
+
 DevicePtr_t CreateLogicalDevice(vk::raii::PhysicalDevice const& physicalDevice, std::vector<char const*> enabledExtensions, std::vector<char const*> enabledLayers, vk::PhysicalDeviceFeatures2 features)
 {
+	//Optional, only used for reporting memory use
+	if (SupportsExtension(physicalDevice, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME))
+	{
+		enabledExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+	}
+
+	//Chained in front of whatever the caller asked for, only read during device creation
+	vk::PhysicalDevicePresentIdFeaturesKHR presentIdFeatures(VK_TRUE);
+	vk::PhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures(VK_TRUE);
+	if (SupportsPresentWait(physicalDevice, enabledExtensions))
+	{
+		enabledExtensions.push_back(VK_KHR_PRESENT_ID_EXTENSION_NAME);
+		enabledExtensions.push_back(VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+		presentIdFeatures.pNext = features.pNext;
+		presentWaitFeatures.pNext = &presentIdFeatures;
+		features.pNext = &presentWaitFeatures;
+	}
+
+	vk::PhysicalDeviceDynamicRenderingFeaturesKHR dynamicRenderingFeatures(VK_TRUE);
+	if (SupportsDynamicRendering(physicalDevice))
+	{
+		enabledExtensions.push_back(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
+		dynamicRenderingFeatures.pNext = features.pNext;
+		features.pNext = &dynamicRenderingFeatures;
+	}
+
+	vk::PhysicalDeviceExtendedDynamicStateFeaturesEXT extendedDynamicStateFeatures(VK_TRUE);
+	if (SupportsExtendedDynamicState(physicalDevice))
+	{
+		enabledExtensions.push_back(VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME);
+		extendedDynamicStateFeatures.pNext = features.pNext;
+		features.pNext = &extendedDynamicStateFeatures;
+	}
+
 	uint32_t graphicsQueueIndex = GetGraphicsQueueFamilyIndex(physicalDevice.getQueueFamilyProperties());
 	float queuePriority = 0.0f; //lowest priority for now
 	vk::DeviceQueueCreateInfo deviceQueueCreateInfo({} /*flags*/, graphicsQueueIndex, 1 /*queue count*/, &queuePriority);
@@ -182,6 +293,11 @@ GfxDevice::GfxDevice(
 	: m_physcialDevice(ChoosePhysicalDevice(pInstance, desiredFeatures, desiredProperties, enabledExtensions))
 	, m_pDevice(CreateLogicalDevice(m_physcialDevice, enabledExtensions, enabledLayers, desiredFeatures))
 	, m_graphcsQueueFamilyIndex(GetGraphicsQueueFamilyIndex(m_physcialDevice.getQueueFamilyProperties()))
+	, m_samplerCache(m_pDevice)
+	, m_bHasMemoryBudget(SupportsExtension(m_physcialDevice, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME))
+	, m_bHasPresentWait(SupportsPresentWait(m_physcialDevice, enabledExtensions))
+	, m_bHasDynamicRendering(SupportsDynamicRendering(m_physcialDevice))
+	, m_bHasExtendedDynamicState(SupportsExtendedDynamicState(m_physcialDevice))
 {
 }
 
@@ -191,7 +307,21 @@ GfxDevice::~GfxDevice()
 
 vk::Queue GfxDevice::GetGraphicsQueue() { return *m_pDevice->getQueue(m_graphcsQueueFamilyIndex, 0); }
 
-GfxSwapchain GfxDevice::CreateSwapChain(vk::SurfaceKHR const& surface, uint32_t desiredSwapchainSize)
+vk::PresentModeKHR GfxDevice::ParsePresentMode(std::string const& name)
+{
+	for (vk::PresentModeKHR const mode : { vk::PresentModeKHR::eFifo, vk::PresentModeKHR::eFifoRelaxed, vk::PresentModeKHR::eMailbox, vk::PresentModeKHR::eImmediate })
+	{
+		std::string modeName = vk::to_string(mode);
+		modeName[0] = char(std::tolower(modeName[0]));
+		if (name == modeName)
+		{
+			return mode;
+		}
+	}
+	throw InvalidStateException("Unknown present mode " + name + ", expected fifo, fifoRelaxed, mailbox or immediate");
+}
+
+GfxSwapchain GfxDevice::CreateSwapChain(vk::SurfaceKHR const& surface, uint32_t desiredImageCount, vk::PresentModeKHR desiredPresentMode, vk::Extent2D fallbackExtent, vk::SwapchainKHR oldSwapchain)
 {
 	//TODO handle separate graphics and present queues
 	uint32_t graphicsQueueFamilyIndex = GetGraphicsQueueFamilyIndex(m_physcialDevice.getQueueFamilyProperties());
@@ -206,23 +336,32 @@ GfxSwapchain GfxDevice::CreateSwapChain(vk::SurfaceKHR const& surface, uint32_t
 
 	vk::SurfaceCapabilitiesKHR surfaceCapabilities = m_physcialDevice.getSurfaceCapabilitiesKHR(surface);
 
-	//TODO handle surface not providing extents and us providing a default to fall back to
-	if (surfaceCapabilities.currentExtent.width == std::numeric_limits<uint32_t>::max() || surfaceCapabilities.currentExtent.height == std::numeric_limits<uint32_t>::max())
+	//Surfaces that leave the size up to the swapchain report the max extent
+	vk::Extent2D swapChainExtent = surfaceCapabilities.currentExtent;
+	if (swapChainExtent.width == std::numeric_limits<uint32_t>::max() || swapChainExtent.height == std::numeric_limits<uint32_t>::max())
 	{
-		throw InitializationException("Failed to create swapChain, surface did not provide valid extents");
+		swapChainExtent.width = std::clamp(fallbackExtent.width, surfaceCapabilities.minImageExtent.width, surfaceCapabilities.maxImageExtent.width);
+		swapChainExtent.height = std::clamp(fallbackExtent.height, surfaceCapabilities.minImageExtent.height, surfaceCapabilities.maxImageExtent.height);
 	}
 
-	if (surfaceCapabilities.minImageCount > desiredSwapchainSize || surfaceCapabilities.maxImageCount < desiredSwapchainSize)
+	if (swapChainExtent.width == 0 || swapChainExtent.height == 0)
 	{
-		throw InitializationException(
-			std::format("Surface capabilities do not match desired swapchin size. min {0} max {1} desired {2}",
-				surfaceCapabilities.minImageCount,
-				surfaceCapabilities.maxImageCount,
-				desiredSwapchainSize));
+		throw InvalidStateException("Failed to create swapChain, surface has no area");
 	}
 
-	vk::Extent2D swapChainExtent = surfaceCapabilities.currentExtent;
-	vk::PresentModeKHR swapChainPresentMode = vk::PresentModeKHR::eFifo;
+	//One over the minimum so acquiring doesn't wait on the presentation engine to release an image,
+	// which mailbox also needs to always have an image to replace. A max of 0 means there is no limit
+	uint32_t imageCount = std::max(desiredImageCount, surfaceCapabilities.minImageCount + 1);
+	if (surfaceCapabilities.maxImageCount > 0)
+	{
+		imageCount = std::min(imageCount, surfaceCapabilities.maxImageCount);
+	}
+
+	vk::PresentModeKHR const swapChainPresentMode = ChoosePresentMode(m_physcialDevice.getSurfacePresentModesKHR(surface), desiredPresentMode);
+	if (swapChainPresentMode != desiredPresentMode)
+	{
+		SPDLOG_WARN("Present mode {} is not supported, using {}", vk::to_string(desiredPresentMode), vk::to_string(swapChainPresentMode));
+	}
 
 	vk::SurfaceTransformFlagBitsKHR preTransform = (surfaceCapabilities.supportedTransforms & vk::SurfaceTransformFlagBitsKHR::eIdentity)
 		? vk::SurfaceTransformFlagBitsKHR::eIdentity
@@ -234,7 +373,7 @@ GfxSwapchain GfxDevice::CreateSwapChain(vk::SurfaceKHR const& surface, uint32_t
 	vk::SwapchainCreateInfoKHR createInfo(
 		{}/*flags*/,
 		surface,
-		desiredSwapchainSize,
+		imageCount,
 		format,
 		vk::ColorSpaceKHR::eSrgbNonlinear, //TODO attributes of different color spaces?
 		swapChainExtent,
@@ -246,7 +385,7 @@ GfxSwapchain GfxDevice::CreateSwapChain(vk::SurfaceKHR const& surface, uint32_t
 		compositeAlpha,
 		swapChainPresentMode,
 		true, /*clipped*/
-		nullptr); /*oldSwapchain*/ //TODO delete old swap chain and associated image views on re-create
+		oldSwapchain); //Retired by the new swapchain, the caller destroys it once nothing is using its images
 
 	vk::raii::SwapchainKHR swapChain(*m_pDevice.get(), createInfo, nullptr /*allocator*/);
 
@@ -256,7 +395,10 @@ GfxSwapchain GfxDevice::CreateSwapChain(vk::SurfaceKHR const& surface, uint32_t
 	gfxSwapchain.m_format = format;
 	gfxSwapchain.m_swapchain = std::move(swapChain);
 	gfxSwapchain.m_extent = swapChainExtent;
+	gfxSwapchain.m_presentMode = swapChainPresentMode;
+	gfxSwapchain.m_swapchainImages = swapChainImages;
 	gfxSwapchain.m_imageViews.reserve(swapChainImages.size());
+	SPDLOG_INFO("Created {}x{} swapchain with {} images presenting with {}", swapChainExtent.width, swapChainExtent.height, swapChainImages.size(), vk::to_string(swapChainPresentMode));
 
 	vk::ImageViewCreateInfo imageViewCreateInfo(
 		{}/*flags*/,
@@ -307,6 +449,61 @@ GfxSwapchain GfxDevice::CreateSwapChain(vk::SurfaceKHR const& surface, uint32_t
 	return gfxSwapchain;
 }
 
+GfxSwapchain GfxDevice::CreateOffscreenSwapChain(uint32_t width, uint32_t height, vk::Format format, uint32_t imageCount)
+{
+	vk::ImageCreateInfo const imageCreateInfo{
+		{} /*flags*/,
+		vk::ImageType::e2D,
+		format,
+		vk::Extent3D{width, height, 1/*depth*/},
+		1 /*mip level*/,
+		1 /*array layers*/,
+		vk::SampleCountFlagBits::e1,
+		vk::ImageTiling::eOptimal,
+		vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferSrc
+	};
+
+	GfxSwapchain gfxSwapchain;
+	gfxSwapchain.m_format = format;
+	gfxSwapchain.m_extent = vk::Extent2D(width, height);
+	gfxSwapchain.m_images.reserve(imageCount);
+
+	vk::raii::CommandPool commandPool = CreateGraphicsCommandPool();
+	vk::raii::CommandBuffer transitionBuffer = std::move(CreatePrimaryCommandBuffers(*commandPool, 1).front());
+	vk::CommandBufferBeginInfo beginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
+	transitionBuffer.begin(beginInfo);
+
+	for (uint32_t i = 0; i < imageCount; ++i)
+	{
+		gfxSwapchain.m_images.push_back(CreateImage(imageCreateInfo, vk::ImageAspectFlagBits::eColor, vk::MemoryPropertyFlagBits::eDeviceLocal));
+
+		//Render passes targeting offscreen images start and end in transfer source, ready to be read back
+		vk::ImageMemoryBarrier transitionBarrier = CreateImageTransition(
+			vk::AccessFlagBits::eNone,
+			vk::AccessFlagBits::eTransferRead,
+			vk::ImageLayout::eUndefined,
+			vk::ImageLayout::eTransferSrcOptimal,
+			*gfxSwapchain.m_images.back().image
+		);
+		transitionBuffer.pipelineBarrier(
+			vk::PipelineStageFlagBits::eTopOfPipe,
+			vk::PipelineStageFlagBits::eTransfer,
+			{},
+			nullptr, nullptr,
+			transitionBarrier
+		);
+	}
+	transitionBuffer.end();
+
+	vk::SubmitInfo submitInfo(nullptr, nullptr, *transitionBuffer, nullptr);
+	GetGraphicsQueue().submit(submitInfo);
+	m_pDevice->waitIdle();
+
+	SPDLOG_INFO("Created {} offscreen render targets with dimensions x:{}, y:{}", imageCount, width, height);
+
+	return gfxSwapchain;
+}
+
 GfxImage GfxDevice::CreateDepthStencil(uint32_t width, uint32_t height, vk::Format depthFormat)
 {
 	vk::ImageAspectFlags const aspect = vk::ImageAspectFlagBits::eDepth;
@@ -350,22 +547,23 @@ GfxImage GfxDevice::CreateImage(vk::ImageCreateInfo createInfo, vk::ImageAspectF
 		vk::ImageSubresourceRange{
 			aspect,
 			0 /*base mip level*/,
-			1 /*level count*/,
+			createInfo.mipLevels /*level count*/,
 			0 /*base array layer*/,
 			1 /*layer count*/
 		}
 	);
 	image.view = vk::raii::ImageView(*m_pDevice.get(), imageViewCreateInfo);
 	image.extent = createInfo.extent;
+	image.mipLevels = createInfo.mipLevels;
 
 	SPDLOG_DEBUG("Created image resource with dimensions x:{0}, y:{1}", createInfo.extent.width, createInfo.extent.height);
 
 	return image;
 }
 
-vk::ImageMemoryBarrier GfxDevice::CreateImageTransition(vk::AccessFlagBits sourceAccess, vk::AccessFlagBits destinationAccess, vk::ImageLayout oldLayout, vk::ImageLayout newLayout, vk::Image image)
+vk::ImageMemoryBarrier GfxDevice::CreateImageTransition(vk::AccessFlagBits sourceAccess, vk::AccessFlagBits destinationAccess, vk::ImageLayout oldLayout, vk::ImageLayout newLayout, vk::Image image, uint32_t baseMipLevel, uint32_t levelCount)
 {
-	vk::ImageSubresourceRange range(vk::ImageAspectFlagBits::eColor, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS);
+	vk::ImageSubresourceRange range(vk::ImageAspectFlagBits::eColor, baseMipLevel, levelCount, 0, VK_REMAINING_ARRAY_LAYERS);
 	vk::ImageMemoryBarrier barrier(
 		sourceAccess,
 		destinationAccess,
@@ -379,6 +577,41 @@ vk::ImageMemoryBarrier GfxDevice::CreateImageTransition(vk::AccessFlagBits sourc
 	return barrier;
 }
 
+bool GfxDevice::SupportsLinearBlit(vk::Format format) const
+{
+	vk::FormatFeatureFlags const required = vk::FormatFeatureFlagBits::eBlitSrc | vk::FormatFeatureFlagBits::eBlitDst | vk::FormatFeatureFlagBits::eSampledImageFilterLinear;
+	return (m_physcialDevice.getFormatProperties(format).optimalTilingFeatures & required) == required;
+}
+
+bool GfxDevice::SupportsSampledFormat(vk::Format format) const
+{
+	vk::FormatFeatureFlags const required = vk::FormatFeatureFlagBits::eSampledImage | vk::FormatFeatureFlagBits::eSampledImageFilterLinear | vk::FormatFeatureFlagBits::eTransferDst;
+	return (m_physcialDevice.getFormatProperties(format).optimalTilingFeatures & required) == required;
+}
+
+GfxMemoryUsage GfxDevice::GetMemoryUsage() const
+{
+	if (!m_bHasMemoryBudget)
+	{
+		return {};
+	}
+
+	auto const chain = m_physcialDevice.getMemoryProperties2<vk::PhysicalDeviceMemoryProperties2, vk::PhysicalDeviceMemoryBudgetPropertiesEXT>();
+	vk::PhysicalDeviceMemoryProperties const& properties = chain.get<vk::PhysicalDeviceMemoryProperties2>().memoryProperties;
+	vk::PhysicalDeviceMemoryBudgetPropertiesEXT const& budget = chain.get<vk::PhysicalDeviceMemoryBudgetPropertiesEXT>();
+
+	GfxMemoryUsage usage;
+	for (uint32_t i = 0; i < properties.memoryHeapCount; ++i)
+	{
+		if (properties.memoryHeaps[i].flags & vk::MemoryHeapFlagBits::eDeviceLocal)
+		{
+			usage.usedBytes += budget.heapUsage[i];
+			usage.budgetBytes += budget.heapBudget[i];
+		}
+	}
+	return usage;
+}
+
 vk::raii::Semaphore GfxDevice::CreateVkSemaphore()
 {
 	vk::SemaphoreCreateInfo createInfo({});
@@ -437,27 +670,9 @@ vk::raii::QueryPool GfxDevice::CreateQueryPool(uint32_t queryCount)
 	return std::move(pool);
 }
 
-vk::raii::Sampler GfxDevice::CreateTextureSampler()
+SamplerPtr_t GfxDevice::GetSampler(vk::SamplerCreateInfo const& createInfo)
 {
-	vk::SamplerCreateInfo createInfo(
-		{},
-		vk::Filter::eLinear /*mag filter*/,
-		vk::Filter::eLinear /*min filter*/,
-		vk::SamplerMipmapMode::eLinear /*mipmap mode*/,
-		/* U,V,W respectively*/
-		vk::SamplerAddressMode::eRepeat,
-		vk::SamplerAddressMode::eRepeat,
-		vk::SamplerAddressMode::eRepeat,
-		0.0f /*mip LOD bias*/,
-		VK_FALSE /*anisotropy enable*/,
-		0.0f /* max anisotropy*/,
-		VK_FALSE /* compare enable*/,
-		vk::CompareOp::eNever,
-		0.0f /*min LOD*/,
-		1.0f /*max LOD*/,
-		vk::BorderColor::eFloatOpaqueWhite
-	);
-	return std::move(vk::raii::Sampler(*m_pDevice, createInfo));
+	return m_samplerCache.GetSampler(createInfo);
 }
 
 vk::raii::CommandPool GfxDevice::CreateGraphicsCommandPool()
@@ -488,6 +703,25 @@ void GfxDevice::UploadBufferData(size_t bytesToUpload, size_t bufferOffset, vk::
 }
 
 void GfxDevice::UploadImageData(vk::CommandPool commandPool, vk::Queue submitQueue, GfxImage const& image, GfxBuffer const& imageData)
+{
+	vk::BufferImageCopy copyRegion(
+		0 /*offset*/,
+		0 /*buffer row length*/,
+		0 /*buffer image height*/,
+		vk::ImageSubresourceLayers(
+			vk::ImageAspectFlagBits::eColor,
+			0/* mip level*/,
+			0/* base array layer*/,
+			1/* layer count*/
+		),
+		vk::Offset3D(0, 0, 0),
+		image.extent
+	);
+
+	UploadImageData(commandPool, submitQueue, image, imageData, { &copyRegion, 1 });
+}
+
+void GfxDevice::UploadImageData(vk::CommandPool commandPool, vk::Queue submitQueue, GfxImage const& image, GfxBuffer const& imageData, std::span<vk::BufferImageCopy const> regions)
 {
 	vk::raii::CommandBuffer copyCommands = std::move(CreatePrimaryCommandBuffers(commandPool, 1).front());
 	vk::CommandBufferBeginInfo beginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
@@ -511,34 +745,66 @@ void GfxDevice::UploadImageData(vk::CommandPool commandPool, vk::Queue submitQue
 	);
 
 	//Do actual upload
-	vk::BufferImageCopy copyRegion(
-		0 /*offset*/,
-		0 /*buffer row length*/,
-		0 /*buffer image height*/,
-		vk::ImageSubresourceLayers(
-			vk::ImageAspectFlagBits::eColor,
-			0/* mip level*/,
-			0/* base array layer*/,
-			1/* layer count*/
-		),
-		vk::Offset3D(0, 0, 0),
-		image.extent
-	);
-
 	copyCommands.copyBufferToImage(
 		*imageData.m_buffer,
 		*image.image,
 		vk::ImageLayout::eTransferDstOptimal,
-		copyRegion
+		regions
 	);
 
+	uint32_t copiedLevels = 0;
+	for (vk::BufferImageCopy const& region : regions)
+	{
+		copiedLevels = std::max(copiedLevels, region.imageSubresource.mipLevel + 1);
+	}
+
+	//Each generated level reads the one above it, so that level moves to transfer source and is finished once blitted from
+	for (uint32_t level = copiedLevels; level < image.mipLevels; ++level)
+	{
+		vk::ImageMemoryBarrier const toSource = CreateImageTransition(
+			vk::AccessFlagBits::eTransferWrite,
+			vk::AccessFlagBits::eTransferRead,
+			vk::ImageLayout::eTransferDstOptimal,
+			vk::ImageLayout::eTransferSrcOptimal,
+			*image.image,
+			level - 1,
+			1
+		);
+		copyCommands.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eTransfer, {}, nullptr, nullptr, toSource);
+
+		int32_t const sourceWidth = std::max(1, int32_t(image.extent.width >> (level - 1)));
+		int32_t const sourceHeight = std::max(1, int32_t(image.extent.height >> (level - 1)));
+		vk::ImageBlit const blit(
+			vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, level - 1, 0, 1),
+			{ vk::Offset3D(0, 0, 0), vk::Offset3D(sourceWidth, sourceHeight, 1) },
+			vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, level, 0, 1),
+			{ vk::Offset3D(0, 0, 0), vk::Offset3D(std::max(1, sourceWidth / 2), std::max(1, sourceHeight / 2), 1) }
+		);
+		copyCommands.blitImage(*image.image, vk::ImageLayout::eTransferSrcOptimal, *image.image, vk::ImageLayout::eTransferDstOptimal, blit, vk::Filter::eLinear);
+
+		vk::ImageMemoryBarrier const sourceToRead = CreateImageTransition(
+			vk::AccessFlagBits::eTransferRead,
+			vk::AccessFlagBits::eShaderRead,
+			vk::ImageLayout::eTransferSrcOptimal,
+			vk::ImageLayout::eShaderReadOnlyOptimal,
+			*image.image,
+			level - 1,
+			1
+		);
+		copyCommands.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eFragmentShader, {}, nullptr, nullptr, sourceToRead);
+	}
+
+	//Whatever is left in transfer destination, all copied levels when nothing was generated, otherwise only the smallest level
+	uint32_t const firstUnfinished = copiedLevels < image.mipLevels ? image.mipLevels - 1 : 0;
 	vk::ImageMemoryBarrier postCopyMemoryBarrier = CreateImageTransition(
 		vk::AccessFlagBits::eTransferWrite,
 		vk::AccessFlagBits::eShaderRead,
 		//Transfer layout to shader read only
 		vk::ImageLayout::eTransferDstOptimal,
 		vk::ImageLayout::eShaderReadOnlyOptimal,
-		*image.image
+		*image.image,
+		firstUnfinished,
+		image.mipLevels - firstUnfinished
 	);
 
 	copyCommands.pipelineBarrier(
@@ -552,9 +818,86 @@ void GfxDevice::UploadImageData(vk::CommandPool commandPool, vk::Queue submitQue
 
 	copyCommands.end();
 
-	vk::SubmitInfo submitInfo(nullptr, nullptr, *copyCommands, nullptr);
-	submitQueue.submit(submitInfo);
+	SubmitAndWait(submitQueue, *copyCommands);
+}
+
+void GfxDevice::DownloadImageData(vk::CommandPool commandPool, vk::Queue submitQueue, GfxImage const& image, vk::ImageLayout imageLayout, GfxBuffer const& imageData)
+{
+	vk::raii::CommandBuffer copyCommands = std::move(CreatePrimaryCommandBuffers(commandPool, 1).front());
+	vk::CommandBufferBeginInfo beginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
+	copyCommands.begin(beginInfo);
+
+	//Make previous rendering visible to the copy, moving to transfer source if the image isn't already there
+	vk::ImageMemoryBarrier preCopyBarrier = CreateImageTransition(
+		vk::AccessFlagBits::eColorAttachmentWrite,
+		vk::AccessFlagBits::eTransferRead,
+		imageLayout,
+		vk::ImageLayout::eTransferSrcOptimal,
+		*image.image,
+		0,
+		1
+	);
+	copyCommands.pipelineBarrier(
+		vk::PipelineStageFlagBits::eColorAttachmentOutput,
+		vk::PipelineStageFlagBits::eTransfer,
+		{},
+		nullptr,
+		nullptr,
+		preCopyBarrier
+	);
 
-	//TODO better synchronization rather than waiting idle
-	submitQueue.waitIdle();
+	vk::BufferImageCopy copyRegion(
+		0 /*offset*/,
+		0 /*buffer row length*/,
+		0 /*buffer image height*/,
+		vk::ImageSubresourceLayers(
+			vk::ImageAspectFlagBits::eColor,
+			0/* mip level*/,
+			0/* base array layer*/,
+			1/* layer count*/
+		),
+		vk::Offset3D(0, 0, 0),
+		image.extent
+	);
+	copyCommands.copyImageToBuffer(*image.image, vk::ImageLayout::eTransferSrcOptimal, *imageData.m_buffer, copyRegion);
+
+	//Host reads through the mapped pointer once the queue is idle
+	vk::BufferMemoryBarrier postCopyBarrier(
+		vk::AccessFlagBits::eTransferWrite,
+		vk::AccessFlagBits::eHostRead,
+		VK_QUEUE_FAMILY_IGNORED,
+		VK_QUEUE_FAMILY_IGNORED,
+		*imageData.m_buffer,
+		0,
+		VK_WHOLE_SIZE
+	);
+	vk::ImageMemoryBarrier restoreBarrier = CreateImageTransition(
+		vk::AccessFlagBits::eTransferRead,
+		vk::AccessFlagBits::eNone,
+		vk::ImageLayout::eTransferSrcOptimal,
+		imageLayout,
+		*image.image,
+		0,
+		1
+	);
+	copyCommands.pipelineBarrier(
+		vk::PipelineStageFlagBits::eTransfer,
+		vk::PipelineStageFlagBits::eHost | vk::PipelineStageFlagBits::eBottomOfPipe,
+		{},
+		nullptr,
+		postCopyBarrier,
+		restoreBarrier
+	);
+
+	copyCommands.end();
+
+	SubmitAndWait(submitQueue, *copyCommands);
+}
+
+void GfxDevice::SubmitAndWait(vk::Queue submitQueue, vk::CommandBuffer commandBuffer)
+{
+	vk::raii::Fence const fence(*m_pDevice, vk::FenceCreateInfo());
+	vk::SubmitInfo submitInfo(nullptr, nullptr, commandBuffer, nullptr);
+	submitQueue.submit(submitInfo, *fence);
+	m_pDevice->waitForFences(*fence, VK_TRUE /*wait all*/, UINT64_MAX);
 }
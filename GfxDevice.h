@@ -1,5 +1,13 @@
 #pragma once
+#include <span>
 #include "GfxFwdDecl.h"
+#include "GfxSamplerCache.h"
+
+struct GfxMemoryUsage
+{
+	uint64_t usedBytes = 0;
+	uint64_t budgetBytes = 0;
+};
 
 class GfxDevice
 {
@@ -16,7 +24,15 @@ public:
 	vk::raii::CommandBuffers CreateSecondaryCommandBuffers(vk::CommandPool commandPool, uint32_t numBuffers);
 	void UploadBufferData(size_t bytesToUpload, size_t bufferOffset, vk::Buffer copyFromBuffer, vk::WriteDescriptorSet writeDescriptor);
 	void UploadImageData(vk::CommandPool commandPool, vk::Queue submitQueue, GfxImage const& image, GfxBuffer const& imageData);
-	GfxSwapchain CreateSwapChain(vk::SurfaceKHR const& surface, uint32_t desiredSwapchainSize);
+	//Levels of image past the last one written by regions are generated by blitting down from the level above
+	void UploadImageData(vk::CommandPool commandPool, vk::Queue submitQueue, GfxImage const& image, GfxBuffer const& imageData, std::span<vk::BufferImageCopy const> regions);
+	//Image count and present mode fall back to what the surface supports, fallbackExtent is only used when the surface
+	// leaves the size to the swapchain. Passing oldSwapchain lets the driver hand its resources over to the new one
+	GfxSwapchain CreateSwapChain(vk::SurfaceKHR const& surface, uint32_t desiredImageCount, vk::PresentModeKHR desiredPresentMode, vk::Extent2D fallbackExtent, vk::SwapchainKHR oldSwapchain = nullptr);
+	//Device local images standing in for a swapchain when rendering without a window, left in transfer source layout
+	GfxSwapchain CreateOffscreenSwapChain(uint32_t width, uint32_t height, vk::Format format, uint32_t imageCount);
+	//Copies the first level of image into imageData and waits for the copy to finish, image is left in imageLayout
+	void DownloadImageData(vk::CommandPool commandPool, vk::Queue submitQueue, GfxImage const& image, vk::ImageLayout imageLayout, GfxBuffer const& imageData);
 	GfxImage CreateDepthStencil(uint32_t width, uint32_t height, vk::Format depthFormat);
 	vk::raii::Semaphore CreateVkSemaphore();
 	vk::raii::Fence CreateFence();
@@ -27,18 +43,44 @@ public:
 		vk::AccessFlagBits destinationAccess,
 		vk::ImageLayout oldLayout,
 		vk::ImageLayout newLayout,
-		vk::Image image);
+		vk::Image image,
+		uint32_t baseMipLevel = 0,
+		uint32_t levelCount = VK_REMAINING_MIP_LEVELS);
+	bool SupportsLinearBlit(vk::Format format) const;
+	//Optimal tiling images of the format can be sampled with linear filtering, false for block compressed formats the device lacks
+	bool SupportsSampledFormat(vk::Format format) const;
+	//Accepts fifo, fifoRelaxed, mailbox or immediate
+	static vk::PresentModeKHR ParsePresentMode(std::string const& name);
 	vk::raii::QueryPool CreateQueryPool(uint32_t queryCount);
-	vk::raii::Sampler CreateTextureSampler();
+	//Shared between all callers asking for the same settings, see GfxSamplerCache
+	SamplerPtr_t GetSampler(vk::SamplerCreateInfo const& createInfo);
 	
 	vk::Queue GetGraphicsQueue();
 	vk::raii::Device const& GetDevice() const noexcept { return *m_pDevice.get(); }
 
 	vk::PhysicalDeviceProperties GetProperties() const { return m_physcialDevice.getProperties(); }
+	//0 when the graphics queue can't write timestamps
+	uint32_t GetTimestampValidBits() const { return m_physcialDevice.getQueueFamilyProperties().at(m_graphcsQueueFamilyIndex).timestampValidBits; }
+	//Summed over device local heaps, all zero when the driver doesn't report a memory budget
+	GfxMemoryUsage GetMemoryUsage() const;
+	//Whether present ids can be attached to presents and waited on, never for devices created without a swapchain
+	bool SupportsPresentWait() const noexcept { return m_bHasPresentWait; }
+	//Whether passes can begin straight on image views, without render pass or framebuffer objects
+	bool SupportsDynamicRendering() const noexcept { return m_bHasDynamicRendering; }
+	//Whether cull mode, front face and depth state can be set while recording, see GfxPipelineBuilder::_extendedDynamicState
+	bool SupportsExtendedDynamicState() const noexcept { return m_bHasExtendedDynamicState; }
 
 private:
+	//Waits on a fence of its own rather than the queue, so work already submitted by frames in flight isn't drained
+	void SubmitAndWait(vk::Queue submitQueue, vk::CommandBuffer commandBuffer);
+
 	vk::raii::PhysicalDevice m_physcialDevice;
 	DevicePtr_t m_pDevice;
 	uint32_t m_graphcsQueueFamilyIndex;
+	GfxSamplerCache m_samplerCache;
+	bool m_bHasMemoryBudget;
+	bool m_bHasPresentWait;
+	bool m_bHasDynamicRendering;
+	bool m_bHasExtendedDynamicState;
 };
 
@@ -10,19 +10,32 @@
 #include "Exceptions.h"
 
 #include "StaticModel.h"
-#include "ImageLoader.h"
 
 #include "ShaderLoader.h"
+#include "TransformSimd.h"
+#include "Clock.h"
+#include "PpmFile.h"
+#include "CpuProfiler.h"
 
 //TODO move out once rendering and terrain generation are separated
 #include "TerrainGenerator.h"
 
+#include <algorithm>
+#include <array>
+#include <numeric>
+#include <thread>
+
 //TODO wrap extensions and layers into configurable features?
 std::vector<const char*> const k_deviceExtensions{
 	VK_KHR_SWAPCHAIN_EXTENSION_NAME,
 	VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME
 };
 
+//Software drivers may not expose presentation at all
+std::vector<const char*> const k_headlessDeviceExtensions{
+	VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME
+};
+
 std::vector<const char*> const k_deviceLayers{
 	//Deprecated, but might be needed for backwards compatibility if we ever want it
 };
@@ -38,38 +51,70 @@ constexpr uint32_t k_lightBindingId = 0;
 constexpr uint32_t k_objectDataBindingId = 0;
 constexpr uint32_t k_textureBindingId = 0;
 
-constexpr uint32_t k_modelCount = 8;
-constexpr uint32_t k_cubeCount = 12;
+//Gooch and phong models are recorded as separate batches
+constexpr uint32_t k_modelBatchCount = 2;
+constexpr size_t k_modelsPerLodJob = 256;
+constexpr size_t k_transformsPerInterpolationJob = 1024;
+
+//TODO detect depth surface formats
+vk::Format const k_depthSurfaceFormat = vk::Format::eD16Unorm;
+
+GfxEngine::GfxEngine(std::string const& applicationName, uint32_t appVersion, WindowPtr_t pWindow, std::shared_ptr<ObjectProcessor> pObjectProcessor, JobSystemPtr_t pJobSystem, SceneSettings const& scene, GfxSettings const& gfx)
+	: GfxEngine(applicationName, appVersion, pWindow, pWindow->GetWindowSize(), pObjectProcessor, pJobSystem, scene, gfx)
+{
+}
+
+GfxEngine::GfxEngine(std::string const& applicationName, uint32_t appVersion, WindowDimensions renderSize, std::shared_ptr<ObjectProcessor> pObjectProcessor, JobSystemPtr_t pJobSystem, SceneSettings const& scene, GfxSettings const& gfx)
+	: GfxEngine(applicationName, appVersion, nullptr, renderSize, pObjectProcessor, pJobSystem, scene, gfx)
+{
+}
 
-GfxEngine::GfxEngine(std::string const& applicationName, uint32_t appVersion, WindowPtr_t pWindow, std::shared_ptr<ObjectProcessor> pObjectProcessor)
+GfxEngine::GfxEngine(std::string const& applicationName, uint32_t appVersion, WindowPtr_t pWindow, WindowDimensions renderSize, std::shared_ptr<ObjectProcessor> pObjectProcessor, JobSystemPtr_t pJobSystem, SceneSettings const& scene, GfxSettings const& gfx)
 	: m_pInstance(nullptr)
 	, m_pWindow(pWindow)
 	, m_pDevice(nullptr)
 	, m_surface(nullptr)
 	, m_swapChain()
+	, m_gfxSettings(gfx)
+	, m_bSwapchainStale(false)
+	, m_bDynamicRendering(false)
+	, m_attachmentFormats()
 	, m_renderPass(nullptr)
+	, m_swapchainFramebuffers()
+	, m_presentSemaphores()
+	, m_imageFences()
 	, m_frames()
 	, m_depthBuffer()
 	, m_pipeline()
 	, m_goochPipeline()
 	, m_textOverlay()
-	, m_pMeshPool(std::make_shared<MeshPool>())
+	, m_pAssetManager(nullptr)
+	, m_sceneSettings(scene)
 	, m_models()
-	, m_textureImage()
-	, m_textureSampler(nullptr)
-	, m_pCamera(std::make_shared<Camera>(pWindow->GetWindowWidth(), pWindow->GetWindowHeight()))
+	, m_interpolatedTransforms()
+	, m_texture()
+	, m_pCamera(std::make_shared<Camera>(std::get<0>(renderSize), std::get<1>(renderSize)))
 	, m_numFramesRendered(0)
-	, m_frameDataBuffer()
-	, m_objectDataBuffer()
 	, m_pDescriptorManager(nullptr)
-	, m_goochObjectDataBuffer()
-	, m_goochFrameDataBuffer()
 	, m_pGoochDescriptorManager(nullptr)
-	, m_timingQueryPool(nullptr)
+	, m_pGpuProfiler(nullptr)
+	, m_lastFrameStats()
+	, m_framePacer()
+	, m_nextPresentId(1)
+	, m_frameStartTime(0.0)
 	, m_pObjectProcessor(pObjectProcessor)
+	, m_pJobSystem(pJobSystem)
 	, m_pTerrain(nullptr)
+	, m_readbackCommandPool(nullptr)
+	, m_readbackBuffer()
 {
-	m_pInstance = std::make_shared<GfxApiInstance>(applicationName, appVersion, k_engineName, k_engineVersion, k_vulkanVersion);
+	if (m_gfxSettings.framesInFlight == 0 || m_gfxSettings.framesInFlight > k_maxFramesInFlight)
+	{
+		throw InitializationException(std::format("Frames in flight must be between 1 and {}, got {}", k_maxFramesInFlight, m_gfxSettings.framesInFlight));
+	}
+
+	bool const bHeadless = IsHeadless();
+	m_pInstance = std::make_shared<GfxApiInstance>(applicationName, appVersion, k_engineName, k_engineVersion, k_vulkanVersion, !bHeadless);
 
 	//Create device
 	vk::PhysicalDeviceFeatures2 desiredFeatures;
@@ -77,12 +122,17 @@ GfxEngine::GfxEngine(std::string const& applicationName, uint32_t appVersion, Wi
 	desiredFeatures.setPNext(&shaderDrawParamsFeatures);
 
 	vk::PhysicalDeviceProperties desiredProperties;
-	desiredProperties.deviceType = vk::PhysicalDeviceType::eDiscreteGpu;
-	//desiredProperties.deviceType = vk::PhysicalDeviceType::eIntegratedGpu;
+	//Headless runs take whatever device is available, CI machines often only have a cpu implementation
+	if (!bHeadless)
+	{
+		desiredProperties.deviceType = vk::PhysicalDeviceType::eDiscreteGpu;
+		//desiredProperties.deviceType = vk::PhysicalDeviceType::eIntegratedGpu;
+	}
 	desiredProperties.apiVersion = k_vulkanVersion;
 
-	m_pDevice = std::make_shared<GfxDevice>(m_pInstance->GetInstance(), desiredFeatures, desiredProperties, k_deviceExtensions, k_deviceLayers);
-	m_pDescriptorManager = std::make_unique<GfxDescriptorManager>(m_pDevice);
+	m_pDevice = std::make_shared<GfxDevice>(m_pInstance->GetInstance(), desiredFeatures, desiredProperties, bHeadless ? k_headlessDeviceExtensions : k_deviceExtensions, k_deviceLayers);
+	m_pDescriptorManager = std::make_unique<GfxDescriptorManager>(m_pDevice, m_gfxSettings.framesInFlight);
+	m_pAssetManager = std::make_shared<AssetManager>(m_pDevice);
 
 	//Load shaders
 	// TODO manage pipelines for different shader needs
@@ -91,108 +141,124 @@ GfxEngine::GfxEngine(std::string const& applicationName, uint32_t appVersion, Wi
 	vk::raii::ShaderModule phongFragmentShader = ShaderLoader::LoadModule("blinnPhong.frag.spv", m_pDevice);
 	vk::raii::ShaderModule phongVertexShader = ShaderLoader::LoadModule("blinnPhong.vert.spv", m_pDevice);
 
-	VkSurfaceKHR _surface;
-	glfwCreateWindowSurface(*m_pInstance->GetInstance(), pWindow->Get(), nullptr, &_surface);
-	m_surface = std::move(vk::raii::SurfaceKHR(m_pInstance->GetInstance(), _surface));
-	m_swapChain = m_pDevice->CreateSwapChain(*m_surface, k_numFramesBuffered);
-
-	//TODO detect depth surface formats
-	vk::Format depthSurfaceFormat = vk::Format::eD16Unorm;
-	auto [width, height] = pWindow->GetWindowSize();
-	m_depthBuffer = m_pDevice->CreateDepthStencil(width, height, depthSurfaceFormat);
-
-	//Create attachments
-	//Attachments describe what image formats/target formats we want write to / read from
 	//TODO detect render surface formats
 	vk::Format renderSurfaceFormat = vk::Format::eB8G8R8A8Unorm;
+	if (bHeadless)
+	{
+		m_swapChain = m_pDevice->CreateOffscreenSwapChain(std::get<0>(renderSize), std::get<1>(renderSize), renderSurfaceFormat, m_gfxSettings.framesInFlight);
+		m_readbackCommandPool = m_pDevice->CreateGraphicsCommandPool();
+	}
+	else
+	{
+		VkSurfaceKHR _surface;
+		glfwCreateWindowSurface(*m_pInstance->GetInstance(), pWindow->Get(), nullptr, &_surface);
+		m_surface = std::move(vk::raii::SurfaceKHR(m_pInstance->GetInstance(), _surface));
+		m_swapChain = m_pDevice->CreateSwapChain(*m_surface, m_gfxSettings.framesInFlight, m_gfxSettings.presentMode, vk::Extent2D(std::get<0>(renderSize), std::get<1>(renderSize)));
+	}
 
-	std::array<vk::AttachmentDescription, 2> renderPassAttachments;
-	// Color output attachment
-	renderPassAttachments[0] = vk::AttachmentDescription(
-		{} /*flags*/,
-		renderSurfaceFormat,
-		vk::SampleCountFlagBits::e1,
-		/*main surface ops*/
-		vk::AttachmentLoadOp::eClear,
-		vk::AttachmentStoreOp::eStore,
-		/*stencil ops*/
-		vk::AttachmentLoadOp::eDontCare,
-		vk::AttachmentStoreOp::eDontCare,
-		/*layout transition*/
-		vk::ImageLayout::ePresentSrcKHR, //initial
-		vk::ImageLayout::ePresentSrcKHR //final
-	);
+	//Windowed swapchains take the surface's size, which can differ from the size asked for
+	uint32_t const width = m_swapChain.m_extent.width;
+	uint32_t const height = m_swapChain.m_extent.height;
 
-	//Depth test attachment
-	renderPassAttachments[1] = vk::AttachmentDescription(
-		{},
-		depthSurfaceFormat,
-		vk::SampleCountFlagBits::e1,
-		vk::AttachmentLoadOp::eClear,
-		vk::AttachmentStoreOp::eStore,
-		vk::AttachmentLoadOp::eDontCare,
-		vk::AttachmentStoreOp::eDontCare,
-		vk::ImageLayout::eUndefined,
-		vk::ImageLayout::eDepthStencilAttachmentOptimal
-	);
+	//Offscreen images sit ready to be copied out between frames rather than waiting to be presented
+	vk::ImageLayout const targetLayout = m_swapChain.IsOffscreen() ? vk::ImageLayout::eTransferSrcOptimal : vk::ImageLayout::ePresentSrcKHR;
 
-	std::array<vk::SubpassDependency, 2> renderPassDependencies = {
-		//Transition swapchain image from final to initial
-		vk::SubpassDependency(
-			VK_SUBPASS_EXTERNAL,
-			0,
-			vk::PipelineStageFlagBits::eBottomOfPipe,
-			vk::PipelineStageFlagBits::eColorAttachmentOutput,
-			vk::AccessFlagBits::eMemoryRead,
-			vk::AccessFlagBits::eColorAttachmentRead | vk::AccessFlagBits::eColorAttachmentWrite,
-			vk::DependencyFlagBits::eByRegion
-		),
-		//Transition swapchain image from initial to final
-		vk::SubpassDependency(
-			0,
-			VK_SUBPASS_EXTERNAL,
-			vk::PipelineStageFlagBits::eColorAttachmentOutput,
-			vk::PipelineStageFlagBits::eBottomOfPipe,
-			vk::AccessFlagBits::eColorAttachmentRead | vk::AccessFlagBits::eColorAttachmentWrite,
-			vk::AccessFlagBits::eMemoryRead,
-			vk::DependencyFlagBits::eByRegion
-		)
-	};
-
-	//Add to renderpass
-	m_renderPass = GfxPipelineBuilder::CreateRenderPass(
-		m_pDevice->GetDevice(),
-		renderPassAttachments,
-		renderPassDependencies);
-
-	//Now we have a renderpass defined we need to connect actual image resources to it
-	m_frames = std::vector<GfxFrame>(m_swapChain.Size());
+	m_depthBuffer = m_pDevice->CreateDepthStencil(width, height, k_depthSurfaceFormat);
 
-	for (uint32_t i = 0; i < m_swapChain.Size(); ++i)
+	m_bDynamicRendering = m_gfxSettings.bDynamicRendering && m_pDevice->SupportsDynamicRendering();
+	m_attachmentFormats.colorFormat = renderSurfaceFormat;
+	m_attachmentFormats.depthFormat = k_depthSurfaceFormat;
+	if (!m_bDynamicRendering)
 	{
-		std::array<vk::ImageView, 2> colorNDepth;
-		colorNDepth[0] = m_swapChain.GetImageView(i);
-		colorNDepth[1] = *m_depthBuffer.view;
+		//Create attachments
+		//Attachments describe what image formats/target formats we want write to / read from
+
+		std::array<vk::AttachmentDescription, 2> renderPassAttachments;
+		// Color output attachment
+		renderPassAttachments[0] = vk::AttachmentDescription(
+			{} /*flags*/,
+			renderSurfaceFormat,
+			vk::SampleCountFlagBits::e1,
+			/*main surface ops*/
+			vk::AttachmentLoadOp::eClear,
+			vk::AttachmentStoreOp::eStore,
+			/*stencil ops*/
+			vk::AttachmentLoadOp::eDontCare,
+			vk::AttachmentStoreOp::eDontCare,
+			/*layout transition*/
+			targetLayout, //initial
+			targetLayout //final
+		);
 
-		vk::FramebufferCreateInfo frameBufferCreateInfo(
+		//Depth test attachment
+		renderPassAttachments[1] = vk::AttachmentDescription(
 			{},
-			*m_renderPass,
-			colorNDepth,
-			width,
-			height,
-			1
+			k_depthSurfaceFormat,
+			vk::SampleCountFlagBits::e1,
+			vk::AttachmentLoadOp::eClear,
+			vk::AttachmentStoreOp::eStore,
+			vk::AttachmentLoadOp::eDontCare,
+			vk::AttachmentStoreOp::eDontCare,
+			vk::ImageLayout::eUndefined,
+			vk::ImageLayout::eDepthStencilAttachmentOptimal
 		);
 
-		m_frames[i].frameBuffer = vk::raii::Framebuffer(m_pDevice->GetDevice(), frameBufferCreateInfo);
+		std::array<vk::SubpassDependency, 2> renderPassDependencies = {
+			//Transition swapchain image from final to initial
+			vk::SubpassDependency(
+				VK_SUBPASS_EXTERNAL,
+				0,
+				vk::PipelineStageFlagBits::eBottomOfPipe | vk::PipelineStageFlagBits::eLateFragmentTests,
+				vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eEarlyFragmentTests,
+				//Depth is shared by every frame in flight, so the previous frame's depth writes finish before this one clears it
+				vk::AccessFlagBits::eMemoryRead | vk::AccessFlagBits::eDepthStencilAttachmentWrite,
+				vk::AccessFlagBits::eColorAttachmentRead | vk::AccessFlagBits::eColorAttachmentWrite | vk::AccessFlagBits::eDepthStencilAttachmentWrite,
+				vk::DependencyFlagBits::eByRegion
+			),
+			//Transition swapchain image from initial to final
+			vk::SubpassDependency(
+				0,
+				VK_SUBPASS_EXTERNAL,
+				vk::PipelineStageFlagBits::eColorAttachmentOutput,
+				vk::PipelineStageFlagBits::eBottomOfPipe,
+				vk::AccessFlagBits::eColorAttachmentRead | vk::AccessFlagBits::eColorAttachmentWrite,
+				vk::AccessFlagBits::eMemoryRead,
+				vk::DependencyFlagBits::eByRegion
+			)
+		};
+
+		//Add to renderpass
+		m_renderPass = GfxPipelineBuilder::CreateRenderPass(
+			m_pDevice->GetDevice(),
+			renderPassAttachments,
+			renderPassDependencies);
+		m_attachmentFormats.renderPass = *m_renderPass;
+	}
+	SPDLOG_INFO("Rendering with {}", m_bDynamicRendering ? "dynamic rendering" : "a render pass and framebuffers");
+
+	//Connects the swapchain images to the render pass, when there is one
+	CreateSwapchainResources();
+
+	m_frames = std::vector<GfxFrame>(m_gfxSettings.framesInFlight);
+	for (uint32_t i = 0; i < m_frames.size(); ++i)
+	{
 		m_frames[i].aquireImageSemaphore = m_pDevice->CreateVkSemaphore();
-		m_frames[i].readyToPresentSemaphore = m_pDevice->CreateVkSemaphore();
 		m_frames[i].commandPool = m_pDevice->CreateGraphicsCommandPool();
 		m_frames[i].commandBuffers = std::move(m_pDevice->CreatePrimaryCommandBuffers(*m_frames[i].commandPool, 1/*num buffers*/));
-		m_frames[i].secondaryCommandBuffers = std::move(m_pDevice->CreateSecondaryCommandBuffers(*m_frames[i].commandPool, 1));
+		for (uint32_t batch = 0; batch < k_modelBatchCount; ++batch)
+		{
+			m_frames[i].secondaryCommandPools.push_back(m_pDevice->CreateGraphicsCommandPool());
+			m_frames[i].secondaryCommandBuffers.push_back(std::move(m_pDevice->CreateSecondaryCommandBuffers(*m_frames[i].secondaryCommandPools.back(), 1).front()));
+		}
 		m_frames[i].renderCompleteFence = m_pDevice->CreateFence();
 	}
 
-	//Model variables
+	if (m_gfxSettings.bLatencyMode && !bHeadless && !m_pDevice->SupportsPresentWait())
+	{
+		SPDLOG_WARN("Latency mode without VK_KHR_present_wait, frames are not paced to the display and latency is measured to gpu completion");
+	}
+
+	//Model variables, meshes and textures stream in on the asset manager's threads
 	SPDLOG_INFO("Loading Scene");
 
 	//TODO remove eventually when we have a scene loader
@@ -200,9 +266,9 @@ GfxEngine::GfxEngine(std::string const& applicationName, uint32_t appVersion, Wi
 
 	//Todo move scene loading somewhere else
 	// good rust candidate?
-	for (uint32_t i = 0; i < k_modelCount; ++i)
+	for (uint32_t i = 0; i < m_sceneSettings.modelCount; ++i)
 	{
-		auto pModel = std::make_shared<StaticModel>(m_pDevice, m_pMeshPool, "C:/Users/Jarryd/Projects/vulkan-gpugems/assets/pirate.obj", m_pObjectProcessor);
+		auto pModel = std::make_shared<StaticModel>(m_pAssetManager, "C:/Users/Jarryd/Projects/vulkan-gpugems/assets/pirate.obj", m_pObjectProcessor);
 		m_models.emplace_back(pModel);
 	
 		//place meshes in a gently rising grid
@@ -211,9 +277,9 @@ GfxEngine::GfxEngine(std::string const& applicationName, uint32_t appVersion, Wi
 		pModel->SetPosition(position);
 	}
 
-	for (uint32_t i = 0; i < k_cubeCount; ++i)
+	for (uint32_t i = 0; i < m_sceneSettings.cubeCount; ++i)
 	{
-		auto pCube = std::make_shared<StaticModel>(m_pDevice, m_pMeshPool, "C:/Users/Jarryd/Projects/vulkan-gpugems/assets/cube.obj", m_pObjectProcessor);
+		auto pCube = std::make_shared<StaticModel>(m_pAssetManager, "C:/Users/Jarryd/Projects/vulkan-gpugems/assets/cube.obj", m_pObjectProcessor);
 		m_models.emplace_back(pCube);
 
 		//place cubes in an offset grid
@@ -224,97 +290,63 @@ GfxEngine::GfxEngine(std::string const& applicationName, uint32_t appVersion, Wi
 
 	SPDLOG_INFO("Constructing descriptor sets");
 
-	//Per object data
+	//Per object data, shared by both pipelines and grown on upload if the scene outgrows it
 	m_pDescriptorManager->AddBinding(k_objectDataBindingId, vk::ShaderStageFlagBits::eVertex, DataUsageFrequency::ePerModel, vk::DescriptorType::eStorageBuffer);
-	constexpr size_t k_objectDataBufferSize = sizeof(ObjectData) * k_maxModelTransforms + sizeof(CameraShaderData);//Only taking one camera into account
-	m_objectDataBuffer = m_pDevice->CreateBuffer(k_objectDataBufferSize, vk::BufferUsageFlagBits::eStorageBuffer);
+	size_t const objectDataBufferSize = sizeof(CameraShaderData) + sizeof(glm::mat4) * m_models.size();//Only taking one camera into account
 
 	//Per frame data
 	m_pDescriptorManager->AddBinding(k_lightBindingId, vk::ShaderStageFlagBits::eFragment, DataUsageFrequency::ePerFrame, vk::DescriptorType::eUniformBuffer);
-	m_frameDataBuffer = m_pDevice->CreateBuffer(sizeof(FrameData), vk::BufferUsageFlagBits::eUniformBuffer);
-
-	//Per material data
-	m_pDescriptorManager->AddBinding(k_textureBindingId, vk::ShaderStageFlagBits::eFragment, DataUsageFrequency::ePerMaterial, vk::DescriptorType::eCombinedImageSampler);
-	//Load Texture image
-	ImagePtr_t pImage = ImageLoader::LoadTexture(*m_pDevice, "C:/Users/Jarryd/Projects/vulkan-gpugems/assets/fish.png");
 
-	vk::ImageCreateInfo textureCreateInfo(
-		{},
-		vk::ImageType::e2D,
-		pImage->format,
-		vk::Extent3D{
-			pImage->width,
-			pImage->height,
-			1
-		},
-		1 /*Mip levels*/,
-		1 /*array levels*/,
-		vk::SampleCountFlagBits::e1,
-		vk::ImageTiling::eOptimal,
-		vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled,
-		vk::SharingMode::eExclusive
-	);
-	m_textureImage = m_pDevice->CreateImage(textureCreateInfo, vk::ImageAspectFlagBits::eColor, vk::MemoryPropertyFlagBits::eDeviceLocal);
-	m_pDevice->UploadImageData(*m_frames[0].commandPool, m_pDevice->GetGraphicsQueue(), m_textureImage, pImage->data);
+	//Each frame slot writes its own copy while earlier frames may still be reading theirs
+	for (GfxFrame& frame : m_frames)
+	{
+		frame.objectDataBuffer = m_pDevice->CreateBuffer(objectDataBufferSize, vk::BufferUsageFlagBits::eStorageBuffer);
+		frame.frameDataBuffer = m_pDevice->CreateBuffer(sizeof(FrameData), vk::BufferUsageFlagBits::eUniformBuffer);
+		frame.goochFrameDataBuffer = m_pDevice->CreateBuffer(sizeof(FrameData), vk::BufferUsageFlagBits::eUniformBuffer);
+	}
 
-	//Create Texture Sampler and bind it
-	vk::SamplerCreateInfo samplerCreateInfo(
-		{},
-		vk::Filter::eLinear,
-		vk::Filter::eLinear,
-		vk::SamplerMipmapMode::eLinear,
-		/*address modes for U,V,W respectively*/
-		vk::SamplerAddressMode::eMirroredRepeat,
-		vk::SamplerAddressMode::eMirroredRepeat,
-		vk::SamplerAddressMode::eMirroredRepeat,
-		0.0f /*mip LOD bias*/,
-		VK_FALSE /*Anisotropy enable*/,
-		0.0f /*max anisotrophy*/,
-		VK_FALSE /*compare enable*/,
-		vk::CompareOp::eNever,
-		0.0f /*min LOD*/,
-		1.0f /*max LOD*/,
-		vk::BorderColor::eFloatOpaqueWhite
-	);
-	m_textureSampler = vk::raii::Sampler(m_pDevice->GetDevice(), samplerCreateInfo);
-	vk::DescriptorImageInfo textureDescriptor(*m_textureSampler, *m_textureImage.view, vk::ImageLayout::eShaderReadOnlyOptimal);
-	vk::WriteDescriptorSet samplerWrite = m_pDescriptorManager->GetWriteDescriptor(DataUsageFrequency::ePerMaterial, k_textureBindingId);
-	samplerWrite.setPImageInfo(&textureDescriptor);
-	samplerWrite.setDescriptorCount(1);
-	m_pDevice->GetDevice().updateDescriptorSets(samplerWrite, nullptr);
+	//Per material data, the sampler is baked into the layout so only the image view is written per texture
+	SamplerPtr_t pTextureSampler = m_pDevice->GetSampler(GfxSamplerCache::LinearSamplerInfo(vk::SamplerAddressMode::eMirroredRepeat));
+	m_pDescriptorManager->AddBinding(k_textureBindingId, vk::ShaderStageFlagBits::eFragment, DataUsageFrequency::ePerMaterial, vk::DescriptorType::eCombinedImageSampler, pTextureSampler);
+	//Load Texture image
+	m_texture = m_pAssetManager->LoadTexture("C:/Users/Jarryd/Projects/vulkan-gpugems/assets/fish.png");
 
-	vk::Viewport viewport(0.0f, (float)height, (float)width, -(float)height, 0.0f, 1.0f);
+	//Binds the placeholder until the texture has streamed in
+	for (uint32_t i = 0; i < m_frames.size(); ++i)
+	{
+		BindTexture(m_texture.Get(), i);
+	}
 
 	SPDLOG_INFO("Constructing Gooch Pipeline");
-	m_pGoochDescriptorManager = std::make_unique<GfxDescriptorManager>(m_pDevice);
+	m_pGoochDescriptorManager = std::make_unique<GfxDescriptorManager>(m_pDevice, m_gfxSettings.framesInFlight);
 
 	m_pGoochDescriptorManager->AddBinding(k_objectDataBindingId, vk::ShaderStageFlagBits::eVertex, DataUsageFrequency::ePerModel, vk::DescriptorType::eStorageBuffer);
-	m_goochObjectDataBuffer = m_pDevice->CreateBuffer(k_objectDataBufferSize, vk::BufferUsageFlagBits::eStorageBuffer);
 	
 	m_pGoochDescriptorManager->AddBinding(k_lightBindingId, vk::ShaderStageFlagBits::eFragment, DataUsageFrequency::ePerFrame, vk::DescriptorType::eUniformBuffer);
-	m_goochFrameDataBuffer = m_pDevice->CreateBuffer(sizeof(FrameData), vk::BufferUsageFlagBits::eUniformBuffer);
 
 	vk::DescriptorSetLayout goochFrameLayout = m_pGoochDescriptorManager->GetLayout(DataUsageFrequency::ePerFrame);
 	vk::DescriptorSetLayout goochModelLayout = m_pGoochDescriptorManager->GetLayout(DataUsageFrequency::ePerModel);
 	std::vector<vk::DescriptorSetLayout> goochlayouts = { goochFrameLayout, goochModelLayout };
 
-	m_goochPipeline.layout = GfxPipelineBuilder::CreatePipelineLayout(m_pDevice->GetDevice(), nullptr, goochlayouts);
+	//Packed vertex positions are dequantized with per mesh bounds
+	vk::PushConstantRange quantizationPush(vk::ShaderStageFlagBits::eVertex, 0/*offset*/, sizeof(VertexQuantization));
+
+	m_goochPipeline.layout = GfxPipelineBuilder::CreatePipelineLayout(m_pDevice->GetDevice(), quantizationPush, goochlayouts);
 
 	GfxPipelineBuilder goochBuilder;
 	goochBuilder._shaderStages.push_back(GfxPipelineBuilder::CreateShaderStageInfo(vk::ShaderStageFlagBits::eVertex, *goochVertexShader));
 	goochBuilder._shaderStages.push_back(GfxPipelineBuilder::CreateShaderStageInfo(vk::ShaderStageFlagBits::eFragment, *goochFragmentShader));
 	goochBuilder._inputAssembly = GfxPipelineBuilder::CreateInputAssemblyInfo(vk::PrimitiveTopology::eTriangleList);
-	goochBuilder._viewport = viewport;
-	goochBuilder._scissor.setOffset({ 0,0 });
-	goochBuilder._scissor.setExtent({ width, height });
 	goochBuilder._rasterizer = GfxPipelineBuilder::CreateRasterizationStateInfo(vk::PolygonMode::eFill, vk::CullModeFlagBits::eNone);
 	goochBuilder._depthStencil = GfxPipelineBuilder::CreateDepthStencilStateInfo(VK_TRUE, VK_TRUE, vk::CompareOp::eLess);
 	goochBuilder._multisampling = GfxPipelineBuilder::CreateMultisampleStateInfo();
 	goochBuilder._colorBlendAttachment = GfxPipelineBuilder::CreateColorBlendAttachmentState();
 	goochBuilder._pipelineLayout = *m_goochPipeline.layout;
-	goochBuilder._vertexDescription = Vertex::GetDescription();
+	goochBuilder._vertexDescription = PackedVertex::GetDescription();
+	goochBuilder._extendedDynamicState = m_pDevice->SupportsExtendedDynamicState();
 
-	m_goochPipeline.pipeline = goochBuilder.BuildPipeline(m_pDevice->GetDevice(), *m_renderPass);
+	m_goochPipeline.pipeline = goochBuilder.BuildPipeline(m_pDevice->GetDevice(), m_attachmentFormats);
+	m_goochPipeline.dynamicState = goochBuilder.GetDynamicState();
 
 	SPDLOG_INFO("Constructing Phong Pipeline");
 
@@ -322,7 +354,7 @@ GfxEngine::GfxEngine(std::string const& applicationName, uint32_t appVersion, Wi
 	vk::DescriptorSetLayout transformLayout = m_pDescriptorManager->GetLayout(DataUsageFrequency::ePerModel);
 	vk::DescriptorSetLayout textureLayout = m_pDescriptorManager->GetLayout(DataUsageFrequency::ePerMaterial);
 	std::vector<vk::DescriptorSetLayout> layouts = { lightLayout, transformLayout, textureLayout };
-	m_pipeline.layout = GfxPipelineBuilder::CreatePipelineLayout(m_pDevice->GetDevice(), nullptr, layouts);
+	m_pipeline.layout = GfxPipelineBuilder::CreatePipelineLayout(m_pDevice->GetDevice(), quantizationPush, layouts);
 
 	GfxPipelineBuilder builder;
 	builder._shaderStages.push_back(
@@ -333,26 +365,23 @@ GfxEngine::GfxEngine(std::string const& applicationName, uint32_t appVersion, Wi
 	);
 
 	builder._inputAssembly = GfxPipelineBuilder::CreateInputAssemblyInfo(vk::PrimitiveTopology::eTriangleList);
-	builder._viewport = viewport;
-
-	builder._scissor.setOffset({ 0, 0 });
-	builder._scissor.setExtent({ width, height });
-
 	builder._rasterizer = GfxPipelineBuilder::CreateRasterizationStateInfo(vk::PolygonMode::eFill, vk::CullModeFlagBits::eNone);
 	builder._depthStencil = GfxPipelineBuilder::CreateDepthStencilStateInfo(VK_TRUE, VK_TRUE, vk::CompareOp::eLess);
 	builder._multisampling = GfxPipelineBuilder::CreateMultisampleStateInfo();
 	builder._colorBlendAttachment = GfxPipelineBuilder::CreateColorBlendAttachmentState();
 	builder._pipelineLayout = *m_pipeline.layout;
-	builder._vertexDescription = Vertex::GetDescription();
+	builder._vertexDescription = PackedVertex::GetDescription();
+	builder._extendedDynamicState = m_pDevice->SupportsExtendedDynamicState();
 
-	m_pipeline.pipeline = builder.BuildPipeline(m_pDevice->GetDevice(), *m_renderPass);
+	m_pipeline.pipeline = builder.BuildPipeline(m_pDevice->GetDevice(), m_attachmentFormats);
+	m_pipeline.dynamicState = builder.GetDynamicState();
 
 	//TODO move out
-	m_timingQueryPool = m_pDevice->CreateQueryPool(k_queryPoolCount);
+	m_pGpuProfiler = std::make_shared<GfxGpuProfiler>(m_pDevice, k_queryPoolCount, m_gfxSettings.framesInFlight);
 
-	m_textOverlay = GfxTextOverlay(m_pDevice, *m_frames[0].commandPool, builder._viewport, builder._scissor);
+	m_textOverlay = GfxTextOverlay(m_pDevice, *m_frames[0].commandPool, m_attachmentFormats, m_gfxSettings.framesInFlight, *m_pJobSystem);
 
-	m_pTerrain = std::make_shared<TerrainGenerator>(m_pDevice, viewport, builder._scissor, *m_renderPass);
+	m_pTerrain = std::make_shared<TerrainGenerator>(m_pDevice, m_attachmentFormats, m_sceneSettings.terrainGridSize, m_gfxSettings.framesInFlight);
 }
 
 GfxEngine::~GfxEngine()
@@ -362,130 +391,583 @@ GfxEngine::~GfxEngine()
 
 void GfxEngine::Render()
 {
-	double frameCpuBeginTime = glfwGetTime() * 1000;
+	PROFILE_ZONE("GfxEngine::Render");
+	double frameCpuBeginTime = Clock::GetSeconds() * 1000;
 
 	uint64_t const k_aquireTimeout_ns = 100000000; //0.1 seconds
 	uint64_t const k_renderCompleteTimeout_ns = 1000000000; //1 second
+
+	//Not every platform reports resizes as out of date, so the window size is checked as well
+	if (!m_swapChain.IsOffscreen() && (m_bSwapchainStale || m_pWindow->GetFramebufferSize() != WindowDimensions(m_swapChain.m_extent.width, m_swapChain.m_extent.height)))
+	{
+		if (!RecreateSwapchain())
+		{
+			//Skipped frames still take the snapshot, latency mode publishes the next one on this thread
+			m_pObjectProcessor->AcquireSnapshot();
+			return;
+		}
+	}
+
+	//Waits for the frame that last used this slot, which with more frames in flight is further behind
+	uint32_t const frameSlot = GetFrameSlot();
 	GfxFrame& frame = GetCurrentFrame();
 	m_pDevice->GetDevice().waitForFences(*frame.renderCompleteFence, VK_TRUE /*wait all*/, k_renderCompleteTimeout_ns);
-	m_pDevice->GetDevice().resetFences(*frame.renderCompleteFence);
+	CompleteFrame(frame);
 
-	auto [acquireResult, imageIndex] = m_swapChain.m_swapchain.acquireNextImage(k_aquireTimeout_ns, *frame.aquireImageSemaphore);//TODO: check and handle failed aquisition
+	uint32_t imageIndex = m_numFramesRendered % m_swapChain.Size();
+	if (!m_swapChain.IsOffscreen())
+	{
+		vk::Result acquireResult = vk::Result::eSuccess;
+		try
+		{
+			std::tie(acquireResult, imageIndex) = m_swapChain.m_swapchain.acquireNextImage(k_aquireTimeout_ns, *frame.aquireImageSemaphore);
+		}
+		catch (vk::OutOfDateKHRError const&)
+		{
+			acquireResult = vk::Result::eErrorOutOfDateKHR;
+		}
+
+		//Nothing was acquired so the semaphore won't signal, skip the frame and try again with a fresh swapchain
+		if (acquireResult != vk::Result::eSuccess && acquireResult != vk::Result::eSuboptimalKHR)
+		{
+			m_bSwapchainStale = acquireResult == vk::Result::eErrorOutOfDateKHR;
+			m_pObjectProcessor->AcquireSnapshot();
+			return;
+		}
+
+		//Suboptimal images can still be presented, the swapchain is replaced before the next frame
+		m_bSwapchainStale = acquireResult == vk::Result::eSuboptimalKHR;
+
+		//Images can come back out of order, or there may be more frames in flight than images, so the frame that
+		// last rendered to this image can be a different slot that is still running
+		vk::Fence const imageFence = m_imageFences[imageIndex];
+		if (imageFence && imageFence != *frame.renderCompleteFence)
+		{
+			m_pDevice->GetDevice().waitForFences(imageFence, VK_TRUE /*wait all*/, k_renderCompleteTimeout_ns);
+		}
+		m_imageFences[imageIndex] = *frame.renderCompleteFence;
+	}
 
-	//TODO remove after finished prototyping bindless
-	m_pDevice->GetDevice().waitIdle();
+	//Only reset once the frame is certain to submit, otherwise the next wait on it would never return
+	m_pDevice->GetDevice().resetFences(*frame.renderCompleteFence);
 
 	frame.commandPool.reset();
+	for (vk::raii::CommandPool& pool : frame.secondaryCommandPools)
+	{
+		pool.reset();
+	}
+
+	//Uploads wait on their own copies and only add resources, so they don't disturb frames still in flight. Only this
+	// slot's descriptor set is rebound, the others pick the texture up when their fences come round
+	m_pAssetManager->ProcessUploads();
+	if (!frame.textureBound && m_texture.IsReady())
+	{
+		BindTexture(m_texture.Get(), frameSlot);
+		frame.textureBound = true;
+	}
 
+	//The frame's fence has signalled so its previous timestamps and terrain densities can be read without stalling.
+	// The terrain is built from the densities this slot generated last time round, a slot late
 	std::vector<vk::CommandBuffer> submitted;
-	submitted.push_back(m_pTerrain->Render(m_pDevice));
+	submitted.push_back(m_pGpuProfiler->BeginFrame(frameSlot));
+	m_pTerrain->GenerateVertexBuffer(m_pTerrain->GetDensityOutput(frameSlot));
+	submitted.push_back(m_pTerrain->Render(m_pDevice, frameSlot, *m_pGpuProfiler));
 
 	vk::ClearColorValue const k_clearColor(std::array<float, 4>{48.0f / 2550.f, 10.0f / 255.0f, 36.0f / 255.0f, 1.0f});
 	vk::ClearDepthStencilValue const k_depthClear(1.0f, 0); //1.0 is max depth
 	std::array<vk::ClearValue, 2> clearValues = { k_clearColor, k_depthClear };
 
 	vk::Rect2D const renderArea({ 0,0 }, m_swapChain.m_extent);
-	vk::RenderPassBeginInfo passBeginInfo(*m_renderPass, *frame.frameBuffer, renderArea, clearValues);
 
-	//Copy data to gpu before binding descriptor set
-	UploadFrameDataToGpu(m_pDescriptorManager, m_frameDataBuffer);
-	UploadObjectDataToGpu(m_pDescriptorManager, {m_models.begin(), m_models.begin() + k_modelCount}, m_objectDataBuffer);
+	//Latest simulation state, the simulation carries on with the next step while this frame is recorded
+	SceneSnapshot const& snapshot = m_pObjectProcessor->AcquireSnapshot();
+
+	//Drawn between the last two steps by how far real time has moved on since the snapshot was published
+	float const alpha = snapshot.GetInterpolationAlpha(Clock::GetSeconds());
+	Camera camera = Camera::Interpolate(snapshot.previousCamera, snapshot.camera, alpha);
+	camera.SetViewportSize(renderArea.extent.width, renderArea.extent.height);
+	InterpolateTransforms(snapshot, alpha);
+
+	m_pJobSystem->ParallelFor(m_models.size(), k_modelsPerLodJob, [this, &snapshot](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; ++i)
+		{
+			m_models[i]->SelectLod(snapshot);
+		}
+	});
 
-	UploadFrameDataToGpu(m_pGoochDescriptorManager, m_goochFrameDataBuffer);
-	UploadObjectDataToGpu(m_pGoochDescriptorManager, {m_models.begin() + k_modelCount, m_models.end()}, m_goochObjectDataBuffer);
+	//Copy data to gpu before binding descriptor set
+	UploadFrameDataToGpu(m_pDescriptorManager, frame.frameDataBuffer, frameSlot, camera);
+	UploadFrameDataToGpu(m_pGoochDescriptorManager, frame.goochFrameDataBuffer, frameSlot, camera);
+	UploadObjectDataToGpu(frame.objectDataBuffer, frameSlot, camera);
 
 	vk::CommandBufferBeginInfo const beginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
 	frame.commandBuffers[0].begin(beginInfo);
 
-	frame.commandBuffers[0].beginRenderPass(passBeginInfo, vk::SubpassContents::eSecondaryCommandBuffers);
-	
-	//Gather secondary command buffers to execute
-	vk::CommandBufferInheritanceInfo const inheritInfo(*m_renderPass, 0 /*subpass*/, *frame.frameBuffer);
-	vk::CommandBuffer modelCommandBuffer = *frame.secondaryCommandBuffers[0];
-	modelCommandBuffer.begin({vk::CommandBufferUsageFlagBits::eOneTimeSubmit | vk::CommandBufferUsageFlagBits::eRenderPassContinue, &inheritInfo});
-	GfxStaticModelDrawer::DrawObjects({ m_models.begin(), m_models.begin() + k_modelCount }, m_goochPipeline, modelCommandBuffer, m_pGoochDescriptorManager);
-	GfxStaticModelDrawer::DrawObjects({ m_models.begin() + k_modelCount, m_models.end() }, m_pipeline, modelCommandBuffer, m_pDescriptorManager);
-	modelCommandBuffer.end();
-
-	frame.commandBuffers[0].executeCommands(modelCommandBuffer);
+	//Spans the parallel recording below, so begun and ended by hand rather than with a GpuScope
+	uint32_t const mainPassScope = m_pGpuProfiler->BeginScope(*frame.commandBuffers[0], "MainPass");
+
+	//Secondary buffers inherit the attachment formats under dynamic rendering, the render pass and framebuffer otherwise
+	vk::CommandBufferInheritanceRenderingInfoKHR const inheritRenderingInfo(
+		{} /*flags*/,
+		0 /*view mask*/,
+		m_attachmentFormats.colorFormat,
+		m_attachmentFormats.depthFormat,
+		vk::Format::eUndefined /*stencil format*/,
+		vk::SampleCountFlagBits::e1);
+	vk::CommandBufferInheritanceInfo inheritInfo(m_attachmentFormats.renderPass, 0 /*subpass*/, nullptr);
+	if (m_bDynamicRendering)
+	{
+		TransitionAttachments(*frame.commandBuffers[0], imageIndex, true);
+
+		//Everything, overlay included, draws in this one pass so depth is never needed after it
+		vk::RenderingAttachmentInfoKHR const colorAttachment(
+			m_swapChain.GetImageView(imageIndex),
+			vk::ImageLayout::eColorAttachmentOptimal,
+			vk::ResolveModeFlagBits::eNone,
+			nullptr /*resolve view*/,
+			vk::ImageLayout::eUndefined /*resolve layout*/,
+			vk::AttachmentLoadOp::eClear,
+			vk::AttachmentStoreOp::eStore,
+			k_clearColor);
+		vk::RenderingAttachmentInfoKHR const depthAttachment(
+			*m_depthBuffer.view,
+			vk::ImageLayout::eDepthStencilAttachmentOptimal,
+			vk::ResolveModeFlagBits::eNone,
+			nullptr,
+			vk::ImageLayout::eUndefined,
+			vk::AttachmentLoadOp::eClear,
+			vk::AttachmentStoreOp::eDontCare,
+			k_depthClear);
+		vk::RenderingInfoKHR const renderingInfo(
+			vk::RenderingFlagBitsKHR::eContentsSecondaryCommandBuffers,
+			renderArea,
+			1 /*layer count*/,
+			0 /*view mask*/,
+			colorAttachment,
+			&depthAttachment);
+
+		frame.commandBuffers[0].beginRenderingKHR(renderingInfo);
+		inheritInfo.setPNext(&inheritRenderingInfo);
+	}
+	else
+	{
+		vk::Framebuffer const frameBuffer = *m_swapchainFramebuffers[imageIndex];
+		vk::RenderPassBeginInfo const passBeginInfo(*m_renderPass, frameBuffer, renderArea, clearValues);
+		frame.commandBuffers[0].beginRenderPass(passBeginInfo, vk::SubpassContents::eSecondaryCommandBuffers);
+		inheritInfo.setFramebuffer(frameBuffer);
+	}
+
+	//Record secondary command buffers in parallel, each batch on its own command pool
+	std::array<std::span<StaticModelPtr_t const>, k_modelBatchCount> const batchModels = {
+		std::span<StaticModelPtr_t const>(m_models.begin(), m_models.begin() + m_sceneSettings.modelCount),
+		std::span<StaticModelPtr_t const>(m_models.begin() + m_sceneSettings.modelCount, m_models.end()) };
+	std::array<GfxPipeline const*, k_modelBatchCount> const batchPipelines = { &m_goochPipeline, &m_pipeline };
+	std::array<GfxDescriptorManagerPtr_t, k_modelBatchCount> const batchDescriptors = { m_pGoochDescriptorManager, m_pDescriptorManager };
+	std::array<char const*, k_modelBatchCount> const batchScopeNames = { "GoochModels", "PhongModels" };
+
+	std::array<uint32_t, k_modelBatchCount> batchDrawCounts = {};
+	JobCounter recording;
+	for (uint32_t batch = 0; batch < k_modelBatchCount; ++batch)
+	{
+		m_pJobSystem->Run([&, batch]()
+		{
+			vk::CommandBuffer modelCommandBuffer = *frame.secondaryCommandBuffers[batch];
+			modelCommandBuffer.begin({vk::CommandBufferUsageFlagBits::eOneTimeSubmit | vk::CommandBufferUsageFlagBits::eRenderPassContinue, &inheritInfo});
+			{
+				GpuScope scope(*m_pGpuProfiler, modelCommandBuffer, batchScopeNames[batch]);
+				batchDrawCounts[batch] = GfxStaticModelDrawer::DrawObjects(batchModels[batch], *batchPipelines[batch], modelCommandBuffer, batchDescriptors[batch], frameSlot, snapshot, renderArea.extent);
+			}
+			modelCommandBuffer.end();
+		}, recording);
+	}
+
+	vk::CommandBuffer terrainCommandBuffer = nullptr;
 	if (m_pTerrain->ReadyToRender())
 	{
-		frame.commandBuffers[0].executeCommands(m_pTerrain->RenderTerrain(&inheritInfo, m_pDevice, *m_pCamera));
+		m_pJobSystem->Run([&]() { terrainCommandBuffer = m_pTerrain->RenderTerrain(&inheritInfo, frameSlot, renderArea.extent, m_pDevice, camera, *m_pGpuProfiler); }, recording);
 	}
+
+	//Shows the previous frame's stats, this frame's aren't complete until after submission
+	vk::CommandBuffer overlayCommandBuffer = nullptr;
+	m_pJobSystem->Run([&]()
+	{
+		overlayCommandBuffer = m_textOverlay.RenderTextOverlay(&inheritInfo, frameSlot, renderArea.extent, m_lastFrameStats, *m_pGpuProfiler);
+	}, recording);
+	m_pJobSystem->Wait(recording);
+
+	for (vk::raii::CommandBuffer const& modelCommandBuffer : frame.secondaryCommandBuffers)
+	{
+		frame.commandBuffers[0].executeCommands(*modelCommandBuffer);
+	}
+	if (terrainCommandBuffer)
+	{
+		frame.commandBuffers[0].executeCommands(terrainCommandBuffer);
+	}
+	//Last so it draws over everything
+	frame.commandBuffers[0].executeCommands(overlayCommandBuffer);
 		
-	frame.commandBuffers[0].endRenderPass();
+	if (m_bDynamicRendering)
+	{
+		frame.commandBuffers[0].endRenderingKHR();
+		TransitionAttachments(*frame.commandBuffers[0], imageIndex, false);
+	}
+	else
+	{
+		frame.commandBuffers[0].endRenderPass();
+	}
+	m_pGpuProfiler->EndScope(*frame.commandBuffers[0], mainPassScope);
 	frame.commandBuffers[0].end();
 
 	submitted.push_back(*frame.commandBuffers[0]);
-	submitted.push_back(m_textOverlay.RenderTextOverlay(frame, renderArea));
 
 	vk::PipelineStageFlags const submitStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput;
 
-	vk::Queue const queue = m_pDevice->GetGraphicsQueue();
-	vk::SubmitInfo renderSubmitInfo(*frame.aquireImageSemaphore, submitStageMask, submitted, *frame.readyToPresentSemaphore);
-	queue.submit(renderSubmitInfo, *frame.renderCompleteFence);
+	//Completion is picked up by CompleteFrame once something waits on the fence
+	frame.inputTime = snapshot.inputTime;
+	frame.startTime = m_gfxSettings.bLatencyMode ? m_frameStartTime : frameCpuBeginTime / 1000;
+	frame.gpuPending = true;
 
-	vk::PresentInfoKHR presentInfo(*frame.readyToPresentSemaphore, *m_swapChain.m_swapchain, imageIndex);
-	queue.presentKHR(presentInfo);//TODO handle different Success results
+	vk::Queue const queue = m_pDevice->GetGraphicsQueue();
+	if (m_swapChain.IsOffscreen())
+	{
+		//Nothing to wait on or hand over to, the image is read back after the fence
+		vk::SubmitInfo renderSubmitInfo(nullptr, nullptr, submitted, nullptr);
+		queue.submit(renderSubmitInfo, *frame.renderCompleteFence);
+	}
+	else
+	{
+		vk::Semaphore const readyToPresentSemaphore = *m_presentSemaphores[imageIndex];
+		vk::SubmitInfo renderSubmitInfo(*frame.aquireImageSemaphore, submitStageMask, submitted, readyToPresentSemaphore);
+		queue.submit(renderSubmitInfo, *frame.renderCompleteFence);
+
+		vk::PresentInfoKHR presentInfo(readyToPresentSemaphore, *m_swapChain.m_swapchain, imageIndex);
+		//Only tagged when something will wait on it, see WaitForFrameStart
+		frame.presentId = 0;
+		vk::PresentIdKHR presentIdInfo;
+		if (m_gfxSettings.bLatencyMode && m_pDevice->SupportsPresentWait())
+		{
+			frame.presentId = m_nextPresentId++;
+			presentIdInfo.setPresentIds(frame.presentId);
+			presentInfo.setPNext(&presentIdInfo);
+		}
+
+		vk::Result presentResult = vk::Result::eSuccess;
+		try
+		{
+			presentResult = queue.presentKHR(presentInfo);
+		}
+		catch (vk::OutOfDateKHRError const&)
+		{
+			presentResult = vk::Result::eErrorOutOfDateKHR;
+		}
+		m_bSwapchainStale = m_bSwapchainStale || presentResult != vk::Result::eSuccess;
+
+		//An out of date present may never complete
+		if (presentResult != vk::Result::eSuccess && presentResult != vk::Result::eSuboptimalKHR)
+		{
+			frame.presentId = 0;
+		}
+	}
 
-	//Temp for density checking
-	queue.waitIdle();
-	std::vector<float> densityResult = m_pTerrain->GetDensityOutput();
-	m_pTerrain->GenerateVertexBuffer(densityResult);
+	//Cpu time stops at submission, the gpu's share is timed by the profiler when this slot comes round again
+	double frameCpuEndTime = Clock::GetSeconds() * 1000;
 
 	//Perf updates
-	double frameCpuEndTime = glfwGetTime() * 1000;
+	m_lastFrameStats.cpuMs = frameCpuEndTime - frameCpuBeginTime;
+	m_lastFrameStats.drawCount = std::accumulate(batchDrawCounts.begin(), batchDrawCounts.end(), 0u) + (terrainCommandBuffer ? 1 : 0) + m_textOverlay.GetDrawCount();
+	m_lastFrameStats.gpuMs = m_pGpuProfiler->GetLastFrameMs();
+	m_lastFrameStats.gpuMemoryBytes = m_pDevice->GetMemoryUsage().usedBytes;
 
-	m_pWindow->SetTitle(std::format("cpu: {0:.3f}ms", frameCpuEndTime - frameCpuBeginTime));
+	if (m_pWindow)
+	{
+		m_pWindow->SetTitle(std::format("cpu: {0:.3f}ms gpu: {1:.3f}ms", m_lastFrameStats.cpuMs, m_lastFrameStats.gpuMs));
+	}
 
 	m_numFramesRendered++;
 }
 
-GfxFrame& GfxEngine::GetCurrentFrame()
+void GfxEngine::WaitForAssets()
 {
-	return m_frames[m_numFramesRendered % k_numFramesBuffered];
+	//Uploads are normally drained once a frame, nothing is in flight yet when this is called
+	m_pDevice->GetDevice().waitIdle();
+	while (m_pAssetManager->GetPendingCount() > 0)
+	{
+		m_pAssetManager->ProcessUploads();
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	m_pAssetManager->ProcessUploads();
 }
 
-size_t GfxEngine::PrepModelData(std::span<StaticModelPtr_t> models, size_t writeOffset, GfxBuffer& buffer)
+void GfxEngine::SaveFrame(std::string const& filePath)
 {
-	for (auto const& model : models)
+	if (!m_swapChain.IsOffscreen())
+	{
+		throw InvalidStateException("Frames can only be saved when rendering offscreen");
+	}
+
+	if (m_numFramesRendered == 0)
+	{
+		throw InvalidStateException("No frame has been rendered to save");
+	}
+
+	//Frames aren't waited on after submission, so the last one may still be rendering
+	GfxFrame& lastFrame = m_frames[(m_numFramesRendered - 1) % m_frames.size()];
+	m_pDevice->GetDevice().waitForFences(*lastFrame.renderCompleteFence, VK_TRUE /*wait all*/, UINT64_MAX);
+	CompleteFrame(lastFrame);
+
+	GfxImage const& image = m_swapChain.m_images[(m_numFramesRendered - 1) % m_swapChain.Size()];
+	size_t const imageBytes = size_t(image.extent.width) * image.extent.height * 4;
+	if (m_readbackBuffer.m_dataSize < imageBytes)
 	{
-		writeOffset = buffer.CopyToBuffer(&model->GetTransform(), sizeof(ObjectData), writeOffset);
+		m_readbackBuffer = m_pDevice->CreateBuffer(imageBytes, vk::BufferUsageFlagBits::eTransferDst);
 	}
 
-	return writeOffset;
+	m_pDevice->DownloadImageData(*m_readbackCommandPool, m_pDevice->GetGraphicsQueue(), image, vk::ImageLayout::eTransferSrcOptimal, m_readbackBuffer);
+	m_readbackCommandPool.reset();
+
+	PpmFile::WriteBgra(filePath, image.extent.width, image.extent.height, { static_cast<uint8_t const*>(m_readbackBuffer.m_pData), imageBytes });
+	SPDLOG_INFO("Saved frame {} to {}", m_numFramesRendered, filePath);
 }
 
-size_t GfxEngine::PrepObjectDataForUpload(std::span<StaticModelPtr_t> const& objects, GfxBuffer& buffer)
+void GfxEngine::CreateSwapchainResources()
 {
-	//First upload Camera data
-	size_t writeOffset = buffer.CopyToBuffer(&m_pCamera->GetViewProj(), sizeof(CameraShaderData), 0);
+	m_swapchainFramebuffers.clear();
+	m_presentSemaphores.clear();
+	m_imageFences.assign(m_swapChain.Size(), nullptr);
+	for (uint32_t i = 0; i < m_swapChain.Size(); ++i)
+	{
+		//Dynamic rendering begins straight on the views
+		if (!m_bDynamicRendering)
+		{
+			std::array<vk::ImageView, 2> colorNDepth;
+			colorNDepth[0] = m_swapChain.GetImageView(i);
+			colorNDepth[1] = *m_depthBuffer.view;
+
+			vk::FramebufferCreateInfo frameBufferCreateInfo(
+				{},
+				*m_renderPass,
+				colorNDepth,
+				m_swapChain.m_extent.width,
+				m_swapChain.m_extent.height,
+				1
+			);
+
+			m_swapchainFramebuffers.emplace_back(m_pDevice->GetDevice(), frameBufferCreateInfo);
+		}
+
+		if (!m_swapChain.IsOffscreen())
+		{
+			m_presentSemaphores.push_back(m_pDevice->CreateVkSemaphore());
+		}
+	}
+}
 
-	//Upload Model transforms at the start of every frame
-	writeOffset = PrepModelData({ objects.begin(), objects.end() }, writeOffset, buffer);
+void GfxEngine::TransitionAttachments(vk::CommandBuffer commandBuffer, uint32_t imageIndex, bool bForRendering)
+{
+	vk::Image const colorImage = m_swapChain.GetImage(imageIndex);
+	if (bForRendering)
+	{
+		//Both are cleared so their old contents are discarded. Depth was last written by the previous frame and color
+		// is chained to the acquire, which waits at color output
+		vk::ImageMemoryBarrier const colorBarrier = m_pDevice->CreateImageTransition(
+			vk::AccessFlagBits::eNone,
+			vk::AccessFlagBits::eColorAttachmentWrite,
+			vk::ImageLayout::eUndefined,
+			vk::ImageLayout::eColorAttachmentOptimal,
+			colorImage);
+		vk::ImageMemoryBarrier const depthBarrier(
+			vk::AccessFlagBits::eDepthStencilAttachmentWrite,
+			vk::AccessFlagBits::eDepthStencilAttachmentRead | vk::AccessFlagBits::eDepthStencilAttachmentWrite,
+			vk::ImageLayout::eUndefined,
+			vk::ImageLayout::eDepthStencilAttachmentOptimal,
+			VK_QUEUE_FAMILY_IGNORED,
+			VK_QUEUE_FAMILY_IGNORED,
+			*m_depthBuffer.image,
+			vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eDepth, 0, 1, 0, 1));
+		commandBuffer.pipelineBarrier(
+			vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eLateFragmentTests,
+			vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eEarlyFragmentTests,
+			{},
+			nullptr, nullptr,
+			{ colorBarrier, depthBarrier });
+		return;
+	}
 
-	//TODO Currently have no way of knowing where the starting offset of copyToBuffer is
-	// which will be needed once this buffer copy gets shared between more than just this function
-	return writeOffset;
+	//Back to where a render pass would have left it, presented or copied out after the fence
+	bool const bOffscreen = m_swapChain.IsOffscreen();
+	vk::ImageMemoryBarrier const colorBarrier = m_pDevice->CreateImageTransition(
+		vk::AccessFlagBits::eColorAttachmentWrite,
+		bOffscreen ? vk::AccessFlagBits::eTransferRead : vk::AccessFlagBits::eNone,
+		vk::ImageLayout::eColorAttachmentOptimal,
+		bOffscreen ? vk::ImageLayout::eTransferSrcOptimal : vk::ImageLayout::ePresentSrcKHR,
+		colorImage);
+	commandBuffer.pipelineBarrier(
+		vk::PipelineStageFlagBits::eColorAttachmentOutput,
+		bOffscreen ? vk::PipelineStageFlagBits::eTransfer : vk::PipelineStageFlagBits::eBottomOfPipe,
+		{},
+		nullptr, nullptr,
+		colorBarrier);
 }
 
-void GfxEngine::UploadObjectDataToGpu(
-	GfxDescriptorManagerPtr_t const& pDescriptorManager,
-	std::span<StaticModelPtr_t> const& objects,
-	GfxBuffer& buffer)
+void GfxEngine::WaitForFrameStart()
 {
-	size_t totalObjectDataBytesToUpload = PrepObjectDataForUpload(objects, buffer);
-	vk::WriteDescriptorSet writeDescriptor = pDescriptorManager->GetWriteDescriptor(DataUsageFrequency::ePerModel, k_objectDataBindingId);
-	m_pDevice->UploadBufferData(totalObjectDataBytesToUpload, 0, *buffer.m_buffer, writeDescriptor);
+	PROFILE_ZONE("GfxEngine::WaitForFrameStart");
+	uint64_t const k_presentTimeout_ns = 100000000; //0.1 seconds
+	uint64_t const k_renderCompleteTimeout_ns = 1000000000; //1 second
+
+	//Every frame starts only once the last has finished, so latency mode never has more than one in flight. Its fence
+	// times when the gpu finished it for the pacer. Without a present id there is no display timing to pace against and
+	// the pacer keeps starting frames straight away
+	if (m_numFramesRendered > 0)
+	{
+		GfxFrame& previousFrame = m_frames[(m_numFramesRendered - 1) % m_frames.size()];
+		m_pDevice->GetDevice().waitForFences(*previousFrame.renderCompleteFence, VK_TRUE /*wait all*/, k_renderCompleteTimeout_ns);
+		CompleteFrame(previousFrame);
+		if (previousFrame.presentId != 0)
+		{
+			vk::Result waitResult = vk::Result::eErrorOutOfDateKHR;
+			try
+			{
+				waitResult = m_swapChain.m_swapchain.waitForPresent(previousFrame.presentId, k_presentTimeout_ns);
+			}
+			catch (vk::OutOfDateKHRError const&)
+			{
+				m_bSwapchainStale = true;
+			}
+
+			//Timed out presents are left out rather than skewing the estimates
+			if (waitResult == vk::Result::eSuccess || waitResult == vk::Result::eSuboptimalKHR)
+			{
+				double const displayTime = Clock::GetSeconds();
+				m_framePacer.FrameDisplayed(previousFrame.startTime, previousFrame.gpuReadyTime, displayTime);
+				m_lastFrameStats.latencyMs = previousFrame.inputTime > 0.0 ? (displayTime - previousFrame.inputTime) * 1000 : 0.0;
+			}
+			previousFrame.presentId = 0;
+		}
+	}
+
+	double const now = Clock::GetSeconds();
+	double const startTime = m_framePacer.GetNextStartTime(now);
+	if (startTime > now)
+	{
+		PROFILE_ZONE("FramePacingSleep");
+		std::this_thread::sleep_for(std::chrono::duration<double>(startTime - now));
+	}
+	m_frameStartTime = Clock::GetSeconds();
 }
 
-void GfxEngine::UploadFrameDataToGpu(GfxDescriptorManagerPtr_t const& pDescriptorManager, GfxBuffer& buffer)
+void GfxEngine::CompleteFrame(GfxFrame& frame)
+{
+	if (!frame.gpuPending)
+	{
+		return;
+	}
+	frame.gpuPending = false;
+	frame.gpuReadyTime = Clock::GetSeconds();
+
+	//Frames with a present id get their latency once the present is waited on
+	if (frame.presentId == 0)
+	{
+		m_lastFrameStats.latencyMs = frame.inputTime > 0.0 ? (frame.gpuReadyTime - frame.inputTime) * 1000 : 0.0;
+	}
+}
+
+bool GfxEngine::RecreateSwapchain()
+{
+	auto const [width, height] = m_pWindow->GetFramebufferSize();
+	if (width == 0 || height == 0)
+	{
+		//Minimised, keep the old swapchain until there is something to draw to again
+		return false;
+	}
+
+	//Frames in flight may still be using the old images and depth buffer
+	m_pDevice->GetDevice().waitIdle();
+	m_swapchainFramebuffers.clear();
+
+	//Presents to the old swapchain can't be waited on once it's gone
+	for (GfxFrame& frame : m_frames)
+	{
+		frame.presentId = 0;
+	}
+
+	GfxSwapchain const oldSwapChain = std::move(m_swapChain);
+	m_swapChain = m_pDevice->CreateSwapChain(*m_surface, m_gfxSettings.framesInFlight, m_gfxSettings.presentMode, vk::Extent2D(width, height), *oldSwapChain.m_swapchain);
+	m_depthBuffer = m_pDevice->CreateDepthStencil(m_swapChain.m_extent.width, m_swapChain.m_extent.height, k_depthSurfaceFormat);
+	CreateSwapchainResources();
+
+	m_bSwapchainStale = false;
+	return true;
+}
+
+uint32_t GfxEngine::GetFrameSlot() const noexcept
+{
+	return uint32_t(m_numFramesRendered % m_frames.size());
+}
+
+GfxFrame& GfxEngine::GetCurrentFrame()
+{
+	return m_frames[GetFrameSlot()];
+}
+
+void GfxEngine::InterpolateTransforms(SceneSnapshot const& snapshot, float alpha)
+{
+	PROFILE_ZONE("GfxEngine::InterpolateTransforms");
+	m_interpolatedTransforms.resize(snapshot.worldMatrices.size());
+	m_pJobSystem->ParallelFor(m_interpolatedTransforms.size(), k_transformsPerInterpolationJob, [this, &snapshot, alpha](size_t begin, size_t end)
+	{
+		size_t const count = end - begin;
+		TransformSimd::InterpolateWorldMatrices(
+			std::span(snapshot.previousPositions).subspan(begin, count),
+			std::span(snapshot.previousRotations).subspan(begin, count),
+			std::span(snapshot.previousScales).subspan(begin, count),
+			std::span(snapshot.positions).subspan(begin, count),
+			std::span(snapshot.rotations).subspan(begin, count),
+			std::span(snapshot.scales).subspan(begin, count),
+			alpha,
+			std::span(m_interpolatedTransforms).subspan(begin, count));
+	});
+}
+
+void GfxEngine::UploadObjectDataToGpu(GfxBuffer& buffer, uint32_t frameSlot, Camera const& camera)
+{
+	PROFILE_ZONE("GfxEngine::UploadObjectDataToGpu");
+	//Every model's world matrix sits at its dense transform index, so the whole array goes up in one copy
+	std::span<glm::mat4 const> const transforms = m_interpolatedTransforms;
+	size_t const requiredBytes = sizeof(CameraShaderData) + transforms.size_bytes();
+	if (requiredBytes > buffer.m_dataSize)
+	{
+		//Only this slot's finished frame used the old buffer, so it can be released straight away
+		buffer = m_pDevice->CreateBuffer(std::max(requiredBytes, buffer.m_dataSize * 2), vk::BufferUsageFlagBits::eStorageBuffer);
+	}
+
+	size_t writeOffset = buffer.CopyToBuffer(&camera.GetViewProj(), sizeof(CameraShaderData), 0);
+	writeOffset = buffer.CopyToBuffer(transforms.data(), transforms.size_bytes(), writeOffset);
+
+	for (GfxDescriptorManagerPtr_t const& pDescriptorManager : { m_pDescriptorManager, m_pGoochDescriptorManager })
+	{
+		vk::WriteDescriptorSet writeDescriptor = pDescriptorManager->GetWriteDescriptor(DataUsageFrequency::ePerModel, k_objectDataBindingId, frameSlot);
+		m_pDevice->UploadBufferData(writeOffset, 0, *buffer.m_buffer, writeDescriptor);
+	}
+}
+
+void GfxEngine::UploadFrameDataToGpu(GfxDescriptorManagerPtr_t const& pDescriptorManager, GfxBuffer& buffer, uint32_t frameSlot, Camera const& camera)
 {
 	FrameData data;
 	data.directionalLight = glm::vec4(k_light, 1.0f);
-	data.cameraPosition = glm::vec4(m_pCamera->GetPosition(), 1.0f);
+	data.cameraPosition = glm::vec4(camera.GetPosition(), 1.0f);
 	buffer.CopyToBuffer(&data, sizeof(FrameData), 0);
 
-	vk::WriteDescriptorSet writeDescriptor = pDescriptorManager->GetWriteDescriptor(DataUsageFrequency::ePerFrame, k_objectDataBindingId);
+	vk::WriteDescriptorSet writeDescriptor = pDescriptorManager->GetWriteDescriptor(DataUsageFrequency::ePerFrame, k_objectDataBindingId, frameSlot);
 	m_pDevice->UploadBufferData(sizeof(FrameData), 0, *buffer.m_buffer, writeDescriptor);
+}
+
+void GfxEngine::BindTexture(GfxImage const& texture, uint32_t frameSlot)
+{
+	vk::DescriptorImageInfo textureDescriptor(nullptr /*immutable sampler*/, *texture.view, vk::ImageLayout::eShaderReadOnlyOptimal);
+	vk::WriteDescriptorSet samplerWrite = m_pDescriptorManager->GetWriteDescriptor(DataUsageFrequency::ePerMaterial, k_textureBindingId, frameSlot);
+	samplerWrite.setPImageInfo(&textureDescriptor);
+	samplerWrite.setDescriptorCount(1);
+	m_pDevice->GetDevice().updateDescriptorSets(samplerWrite, nullptr);
 }
\ No newline at end of file
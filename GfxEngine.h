@@ -10,6 +10,13 @@
 #include "GfxTextOverlay.h"
 #include "GfxDescriptorManager.h"
 #include "Camera.h"
+#include "AssetManager.h"
+#include "JobSystem.h"
+#include "SceneSettings.h"
+#include "GfxSettings.h"
+#include "FrameStats.h"
+#include "GfxGpuProfiler.h"
+#include "FramePacer.h"
 
 //TODO move out once generation and rendering are split up
 #include "TerrainGenerator.h"
@@ -20,13 +27,14 @@
 std::string const k_engineName = "Vulkan?";
 uint32_t const k_engineVersion = 1;
 uint32_t const k_vulkanVersion = VK_API_VERSION_1_2;
-uint32_t const k_numFramesBuffered = 2; //Double buffering
 uint32_t const k_queryPoolCount = 64;
 
 class GfxEngine
 {
 public:
-	GfxEngine(std::string const& applicationName, uint32_t appVersion, WindowPtr_t pWindow, std::shared_ptr<ObjectProcessor> objectProcessor);
+	GfxEngine(std::string const& applicationName, uint32_t appVersion, WindowPtr_t pWindow, std::shared_ptr<ObjectProcessor> objectProcessor, JobSystemPtr_t pJobSystem, SceneSettings const& scene = {}, GfxSettings const& gfx = {});
+	//Headless, renders into offscreen images without a window, surface or swapchain so it runs on software drivers like lavapipe
+	GfxEngine(std::string const& applicationName, uint32_t appVersion, WindowDimensions renderSize, std::shared_ptr<ObjectProcessor> objectProcessor, JobSystemPtr_t pJobSystem, SceneSettings const& scene = {}, GfxSettings const& gfx = {});
 	~GfxEngine();
 
 	GfxEngine(GfxEngine const&) = delete;
@@ -35,14 +43,46 @@ public:
 	GfxEngine& operator=(GfxEngine&&) = delete;
 
 	void Render();
+	//Latency mode only, called before sampling input. Waits for the last frame to be shown, then sleeps until the next
+	// one has to start to make the refresh after it
+	void WaitForFrameStart();
+
+	//Blocks until every requested asset has been uploaded, so headless captures don't contain placeholders
+	void WaitForAssets();
+	//Reads back the most recently rendered frame and writes it out as a PPM, offscreen rendering only
+	void SaveFrame(std::string const& filePath);
+
+	bool IsHeadless() const noexcept { return !m_pWindow; }
+	FrameStats const& GetLastFrameStats() const noexcept { return m_lastFrameStats; }
+	std::vector<GpuScopeStats> GetGpuScopeStats() const { return m_pGpuProfiler->GetScopeStats(); }
 
 protected:
+	GfxEngine(std::string const& applicationName, uint32_t appVersion, WindowPtr_t pWindow, WindowDimensions renderSize, std::shared_ptr<ObjectProcessor> objectProcessor, JobSystemPtr_t pJobSystem, SceneSettings const& scene, GfxSettings const& gfx);
+
+
+	//Slot in the ring of frames in flight that the next frame records into
+	uint32_t GetFrameSlot() const noexcept;
 	GfxFrame& GetCurrentFrame();
 
-	size_t PrepModelData(std::span<StaticModelPtr_t> models, size_t writeOffset, GfxBuffer& buffer);
-	size_t PrepObjectDataForUpload(std::span<StaticModelPtr_t> const& objects, GfxBuffer& buffer);
-	void UploadObjectDataToGpu(GfxDescriptorManagerPtr_t const& pDescriptorManager, std::span<StaticModelPtr_t> const& objects, GfxBuffer& buffer);
-	void UploadFrameDataToGpu(GfxDescriptorManagerPtr_t const& pDescriptorManager, GfxBuffer& buffer);
+	//Present semaphores, and framebuffers without dynamic rendering, one per swapchain image and rebuilt whenever the
+	// swapchain is
+	void CreateSwapchainResources();
+	//Replaces the swapchain and everything sized to it after a resize or an out of date present.
+	// Returns false if the window is minimised and there is nothing to render to
+	bool RecreateSwapchain();
+	//Dynamic rendering only, render passes make these transitions themselves. Moves the image's color and the depth
+	// buffer into attachment layouts for rendering, or the color back to present or transfer source after
+	void TransitionAttachments(vk::CommandBuffer commandBuffer, uint32_t imageIndex, bool bForRendering);
+
+	//Fills m_interpolatedTransforms with the snapshot's transforms alpha of the way through its latest step
+	void InterpolateTransforms(SceneSnapshot const& snapshot, float alpha);
+	//Buffers and descriptor sets are the frame slot's own, so its previous frame must have finished with them
+	void UploadObjectDataToGpu(GfxBuffer& buffer, uint32_t frameSlot, Camera const& camera);
+	void UploadFrameDataToGpu(GfxDescriptorManagerPtr_t const& pDescriptorManager, GfxBuffer& buffer, uint32_t frameSlot, Camera const& camera);
+	void BindTexture(GfxImage const& texture, uint32_t frameSlot);
+	//Call once the frame's fence has been waited on. Records when the gpu was seen to finish it and reports latency for
+	// frames that can't wait on their present, does nothing if it already has
+	void CompleteFrame(GfxFrame& frame);
 
 
 
@@ -55,7 +95,14 @@ private:
 	//TODO find a home
 	vk::raii::SurfaceKHR m_surface;
 	GfxSwapchain m_swapChain;
+	GfxSettings m_gfxSettings;
+	bool m_bSwapchainStale; //Out of date or suboptimal, recreated before the next frame
+	bool m_bDynamicRendering; //Requested and supported, m_renderPass and m_swapchainFramebuffers are left empty
+	GfxAttachmentFormats m_attachmentFormats;
 	vk::raii::RenderPass m_renderPass;
+	std::vector<vk::raii::Framebuffer> m_swapchainFramebuffers;
+	std::vector<vk::raii::Semaphore> m_presentSemaphores; //By swapchain image, a present may still be waiting on one after its frame slot comes round again
+	std::vector<vk::Fence> m_imageFences; //By swapchain image, fence of the frame that last rendered to it or null
 	std::vector<GfxFrame> m_frames;
 	GfxImage m_depthBuffer;
 	GfxPipeline m_pipeline;
@@ -65,30 +112,40 @@ private:
 	//Text
 	GfxTextOverlay m_textOverlay;
 
+	//Assets
+	AssetManagerPtr_t m_pAssetManager;
+
 	//Meshes
-	MeshPoolPtr_t m_pMeshPool;
+	SceneSettings m_sceneSettings;
 	std::vector<StaticModelPtr_t> m_models;
+	std::vector<glm::mat4> m_interpolatedTransforms; //By dense transform index
 
 	//Texture
-	GfxImage m_textureImage;
-	vk::raii::Sampler m_textureSampler;
+	TextureHandle_t m_texture;
 
 	uint64_t m_numFramesRendered;
 
 	//TODO move out scene info
-	std::shared_ptr<Camera> m_pCamera;
+	std::shared_ptr<Camera> m_pCamera; //Handed to the simulation, rendering interpolates the snapshot's copies
 	GfxDescriptorManagerPtr_t m_pDescriptorManager;
-	GfxDescriptorManagerPtr_t m_pGoochDescriptorManager;
-	GfxBuffer m_goochObjectDataBuffer;
-	GfxBuffer m_goochFrameDataBuffer;
-	GfxBuffer m_frameDataBuffer;
-	GfxBuffer m_objectDataBuffer;
+	GfxDescriptorManagerPtr_t m_pGoochDescriptorManager; //Both hold a set per frame slot, the buffers behind them live in GfxFrame
 	std::shared_ptr<ObjectProcessor> m_pObjectProcessor;
+	JobSystemPtr_t m_pJobSystem;
 
 	//Terrain
 	std::shared_ptr<TerrainGenerator> m_pTerrain;
 
 	//Perf timers
-	vk::raii::QueryPool m_timingQueryPool;
+	GfxGpuProfilerPtr_t m_pGpuProfiler;
+	FrameStats m_lastFrameStats;
+
+	//Latency mode
+	FramePacer m_framePacer;
+	uint64_t m_nextPresentId; //Present ids only have to increase, so one count serves every swapchain
+	double m_frameStartTime; //Clock seconds WaitForFrameStart last returned at
+
+	//Offscreen readback
+	vk::raii::CommandPool m_readbackCommandPool;
+	GfxBuffer m_readbackBuffer;
 };
 
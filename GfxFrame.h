@@ -1,24 +1,47 @@
 #pragma once
 #include "GfxFwdDecl.h"
+#include "GfxBuffer.h"
 
 struct GfxFrame {
 	GfxFrame():
-		frameBuffer(nullptr)
-		, aquireImageSemaphore(nullptr)
-		, readyToPresentSemaphore(nullptr)
+		aquireImageSemaphore(nullptr)
 		, renderCompleteFence(nullptr)
 		, commandPool(nullptr)
 		, commandBuffers(nullptr)
-		, secondaryCommandBuffers(nullptr)
+		, secondaryCommandPools()
+		, secondaryCommandBuffers()
+		, frameDataBuffer()
+		, goochFrameDataBuffer()
+		, objectDataBuffer()
+		, textureBound(false)
+		, gpuPending(false)
+		, presentId(0)
+		, inputTime(0.0)
+		, startTime(0.0)
+		, gpuReadyTime(0.0)
 	{}
 
-	vk::raii::Framebuffer frameBuffer;
-	//Rendering semaphores
+	//Per frame slot rather than per swapchain image, which image will be acquired isn't known until after the acquire.
+	// Present semaphores are per image and live with the swapchain
 	vk::raii::Semaphore aquireImageSemaphore;
-	vk::raii::Semaphore readyToPresentSemaphore;
 	vk::raii::Fence renderCompleteFence;
 
 	vk::raii::CommandPool commandPool;
 	vk::raii::CommandBuffers commandBuffers;
-	vk::raii::CommandBuffers secondaryCommandBuffers;
+	//One pool per buffer so each can be recorded on a different thread
+	std::vector<vk::raii::CommandPool> secondaryCommandPools;
+	std::vector<vk::raii::CommandBuffer> secondaryCommandBuffers;
+
+	//Rewritten every frame along with the slot's descriptor sets, which is safe once the slot's fence has signalled
+	GfxBuffer frameDataBuffer;
+	GfxBuffer goochFrameDataBuffer;
+	GfxBuffer objectDataBuffer;
+	bool textureBound; //Whether the loaded texture has replaced the placeholder in this slot's descriptor set
+
+	//Latency tracking for the frame last rendered in this slot, times are clock seconds
+	bool gpuPending; //Submitted and its fence not yet waited on, see GfxEngine::CompleteFrame
+	uint64_t presentId; //0 when the present can't be waited on
+	double inputTime; //When the input its snapshot was stepped with was sampled, 0 if nothing drove the simulation
+	double startTime;
+	double gpuReadyTime;
 };
\ No newline at end of file
@@ -17,6 +17,8 @@ using SamplerPtr_t = std::shared_ptr<vk::raii::Sampler>;
 struct GfxImage;
 struct GfxUniformBuffer;
 struct GfxPipeline;
+struct GfxAttachmentFormats;
+struct GfxDynamicState;
 struct GfxSwapchain;
 class GfxEngine;
 struct GfxFrame;
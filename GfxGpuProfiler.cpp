@@ -0,0 +1,182 @@
+#include "GfxGpuProfiler.h"
+#include "GfxDevice.h"
+#include "Exceptions.h"
+#include "Logger.h"
+
+#include <algorithm>
+#include <limits>
+#include <span>
+
+GfxGpuProfiler::FrameQueries::FrameQueries()
+	: commandPool(nullptr)
+	, resetCommandBuffer(nullptr)
+	, scopeCount(0)
+	, scopeNames()
+{}
+
+GfxGpuProfiler::GfxGpuProfiler(GfxDevicePtr_t pDevice, uint32_t queryCount, uint32_t framesInFlight)
+	: m_queryPool(pDevice->CreateQueryPool(queryCount))
+	, m_timestampPeriod(0.0f)
+	, m_timestampMask(0)
+	, m_scopesPerFrame(queryCount / framesInFlight / 2)
+	, m_currentFrameSlot(0)
+	, m_frames(framesInFlight)
+	, m_lastFrameMs(0.0)
+	, m_history()
+{
+	if (m_scopesPerFrame == 0)
+	{
+		throw InitializationException("Gpu profiler needs at least two queries per frame in flight, got " + std::to_string(queryCount));
+	}
+
+	uint32_t const validBits = pDevice->GetTimestampValidBits();
+	if (pDevice->GetProperties().limits.timestampComputeAndGraphics && validBits > 0)
+	{
+		m_timestampPeriod = pDevice->GetProperties().limits.timestampPeriod;
+		m_timestampMask = validBits >= 64 ? std::numeric_limits<uint64_t>::max() : (uint64_t(1) << validBits) - 1;
+	}
+	else
+	{
+		SPDLOG_WARN("Graphics queue can't write timestamps, gpu profiling is disabled");
+	}
+
+	for (FrameQueries& frame : m_frames)
+	{
+		frame.commandPool = pDevice->CreateGraphicsCommandPool();
+		frame.resetCommandBuffer = std::move(pDevice->CreatePrimaryCommandBuffers(*frame.commandPool, 1).front());
+		frame.scopeNames.resize(m_scopesPerFrame, nullptr);
+	}
+}
+
+vk::CommandBuffer GfxGpuProfiler::BeginFrame(uint32_t frameSlot)
+{
+	FrameQueries& frame = m_frames.at(frameSlot);
+	uint32_t const scopeCount = std::min(frame.scopeCount.load(), m_scopesPerFrame);
+	if (scopeCount > 0)
+	{
+		Resolve(frameSlot, scopeCount);
+	}
+	frame.scopeCount = 0;
+	m_currentFrameSlot = frameSlot;
+
+	frame.commandPool.reset();
+	frame.resetCommandBuffer.begin(vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
+	if (IsEnabled())
+	{
+		frame.resetCommandBuffer.resetQueryPool(*m_queryPool, GetFirstQuery(frameSlot), m_scopesPerFrame * 2);
+	}
+	frame.resetCommandBuffer.end();
+
+	return *frame.resetCommandBuffer;
+}
+
+uint32_t GfxGpuProfiler::BeginScope(vk::CommandBuffer commandBuffer, char const* name)
+{
+	if (!IsEnabled())
+	{
+		return k_invalidScope;
+	}
+
+	FrameQueries& frame = m_frames[m_currentFrameSlot];
+	uint32_t const scope = frame.scopeCount.fetch_add(1);
+	if (scope >= m_scopesPerFrame)
+	{
+		SPDLOG_WARN("Gpu profiler ran out of queries for scope {}", name);
+		return k_invalidScope;
+	}
+
+	frame.scopeNames[scope] = name;
+	commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, *m_queryPool, GetFirstQuery(m_currentFrameSlot) + scope * 2);
+	return scope;
+}
+
+void GfxGpuProfiler::EndScope(vk::CommandBuffer commandBuffer, uint32_t scope)
+{
+	if (scope != k_invalidScope)
+	{
+		commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, *m_queryPool, GetFirstQuery(m_currentFrameSlot) + scope * 2 + 1);
+	}
+}
+
+void GfxGpuProfiler::Resolve(uint32_t frameSlot, uint32_t scopeCount)
+{
+	//Each query comes back as its value followed by whether it was available
+	constexpr uint32_t k_valuesPerQuery = 2;
+	uint32_t const queryCount = scopeCount * 2;
+	auto [result, values] = m_queryPool.getResults<uint64_t>(
+		GetFirstQuery(frameSlot),
+		queryCount,
+		queryCount * k_valuesPerQuery * sizeof(uint64_t),
+		k_valuesPerQuery * sizeof(uint64_t),
+		vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWithAvailability);
+
+	//Scopes sharing a name in one frame, like work split over jobs, count as one sample
+	std::map<std::string, double> frameTimes;
+	uint64_t frameBegin = std::numeric_limits<uint64_t>::max();
+	uint64_t frameEnd = 0;
+	for (uint32_t scope = 0; scope < scopeCount; ++scope)
+	{
+		uint64_t const* pBegin = &values[scope * 2 * k_valuesPerQuery];
+		uint64_t const* pEnd = pBegin + k_valuesPerQuery;
+		if (pBegin[1] == 0 || pEnd[1] == 0)
+		{
+			//Never executed, the frame's submission must have been skipped
+			continue;
+		}
+
+		uint64_t const begin = pBegin[0] & m_timestampMask;
+		uint64_t const end = pEnd[0] & m_timestampMask;
+		frameBegin = std::min(frameBegin, begin);
+		frameEnd = std::max(frameEnd, end);
+		frameTimes[m_frames[frameSlot].scopeNames[scope]] += double((end - begin) & m_timestampMask) * m_timestampPeriod / 1000000.0;
+	}
+
+	if (frameEnd >= frameBegin)
+	{
+		m_lastFrameMs = double(frameEnd - frameBegin) * m_timestampPeriod / 1000000.0;
+	}
+
+	for (auto const& [name, ms] : frameTimes)
+	{
+		ScopeHistory& history = m_history[name];
+		history.samples[history.nextSample] = ms;
+		history.nextSample = (history.nextSample + 1) % k_gpuStatsWindow;
+		history.sampleCount = std::min(history.sampleCount + 1, k_gpuStatsWindow);
+	}
+}
+
+std::vector<GpuScopeStats> GfxGpuProfiler::GetScopeStats() const
+{
+	std::vector<GpuScopeStats> stats;
+	stats.reserve(m_history.size());
+	for (auto const& [name, history] : m_history)
+	{
+		//nextSample has already moved past the latest
+		size_t const latest = (history.nextSample + k_gpuStatsWindow - 1) % k_gpuStatsWindow;
+		auto const samples = std::span(history.samples).first(history.sampleCount);
+
+		GpuScopeStats scopeStats;
+		scopeStats.name = name;
+		scopeStats.lastMs = history.samples[latest];
+		scopeStats.minMs = *std::min_element(samples.begin(), samples.end());
+		scopeStats.maxMs = *std::max_element(samples.begin(), samples.end());
+		for (double const sample : samples)
+		{
+			scopeStats.averageMs += sample;
+		}
+		scopeStats.averageMs /= double(samples.size());
+		stats.push_back(scopeStats);
+	}
+	return stats;
+}
+
+GpuScope::GpuScope(GfxGpuProfiler& profiler, vk::CommandBuffer commandBuffer, char const* name)
+	: m_profiler(profiler)
+	, m_commandBuffer(commandBuffer)
+	, m_scope(profiler.BeginScope(commandBuffer, name))
+{}
+
+GpuScope::~GpuScope()
+{
+	m_profiler.EndScope(m_commandBuffer, m_scope);
+}
\ No newline at end of file
@@ -0,0 +1,98 @@
+#pragma once
+#include "GfxFwdDecl.h"
+
+#include <array>
+#include <atomic>
+#include <map>
+#include <string>
+#include <vector>
+
+//Resolved frames kept per scope for the rolling statistics
+constexpr size_t k_gpuStatsWindow = 120;
+
+struct GpuScopeStats
+{
+	std::string name;
+	double lastMs = 0.0;
+	//Over the last k_gpuStatsWindow frames the scope was recorded in
+	double averageMs = 0.0;
+	double minMs = 0.0;
+	double maxMs = 0.0;
+};
+
+//Splits a timestamp query pool between the frames in flight. Each scope writes a pair of timestamps, which are read back
+// when the same frame slot comes round again. By then the slot's fence has been waited on, so reading never stalls
+class GfxGpuProfiler
+{
+public:
+	GfxGpuProfiler(GfxDevicePtr_t pDevice, uint32_t queryCount, uint32_t framesInFlight);
+
+	GfxGpuProfiler(GfxGpuProfiler const&) = delete;
+	GfxGpuProfiler& operator=(GfxGpuProfiler const&) = delete;
+
+	//Call once frameSlot's fence has signalled. Resolves what the slot recorded last time round and returns a command
+	// buffer resetting its queries, which has to be submitted ahead of anything scoped this frame
+	vk::CommandBuffer BeginFrame(uint32_t frameSlot);
+
+	//Safe to call from several recording threads at once. name is kept until the frame resolves, so pass a literal.
+	//Returns k_invalidScope, recording nothing, when the device can't write timestamps or the frame has used up its
+	// share of the pool
+	uint32_t BeginScope(vk::CommandBuffer commandBuffer, char const* name);
+	void EndScope(vk::CommandBuffer commandBuffer, uint32_t scope);
+
+	bool IsEnabled() const noexcept { return m_timestampPeriod > 0.0f; }
+	//From the first timestamp to the last in the most recently resolved frame
+	double GetLastFrameMs() const noexcept { return m_lastFrameMs; }
+	std::vector<GpuScopeStats> GetScopeStats() const;
+
+	static constexpr uint32_t k_invalidScope = UINT32_MAX;
+
+private:
+	struct FrameQueries
+	{
+		FrameQueries();
+
+		vk::raii::CommandPool commandPool;
+		vk::raii::CommandBuffer resetCommandBuffer;
+		std::atomic<uint32_t> scopeCount;
+		std::vector<char const*> scopeNames;
+	};
+
+	struct ScopeHistory
+	{
+		std::array<double, k_gpuStatsWindow> samples = {};
+		size_t sampleCount = 0;
+		size_t nextSample = 0;
+	};
+
+	void Resolve(uint32_t frameSlot, uint32_t scopeCount);
+	uint32_t GetFirstQuery(uint32_t frameSlot) const noexcept { return frameSlot * m_scopesPerFrame * 2; }
+
+	vk::raii::QueryPool m_queryPool;
+	float m_timestampPeriod; //Nanoseconds per tick, 0 when timestamps aren't supported
+	uint64_t m_timestampMask;
+	uint32_t m_scopesPerFrame;
+	uint32_t m_currentFrameSlot;
+	std::vector<FrameQueries> m_frames;
+
+	double m_lastFrameMs;
+	std::map<std::string, ScopeHistory> m_history;
+};
+
+using GfxGpuProfilerPtr_t = std::shared_ptr<GfxGpuProfiler>;
+
+//Times everything recorded into commandBuffer during its lifetime
+class GpuScope
+{
+public:
+	GpuScope(GfxGpuProfiler& profiler, vk::CommandBuffer commandBuffer, char const* name);
+	~GpuScope();
+
+	GpuScope(GpuScope const&) = delete;
+	GpuScope& operator=(GpuScope const&) = delete;
+
+private:
+	GfxGpuProfiler& m_profiler;
+	vk::CommandBuffer m_commandBuffer;
+	uint32_t m_scope;
+};
\ No newline at end of file
@@ -7,13 +7,13 @@ struct GfxImage {
 		image(nullptr),
 		view(nullptr),
 		memory(nullptr),
-		sampler(nullptr),
-		extent()
+		extent(),
+		mipLevels(1)
 	{}
 
 	vk::raii::Image image;
 	vk::raii::ImageView view;
 	vk::raii::DeviceMemory memory;
-	SamplerPtr_t sampler;
 	vk::Extent3D extent;
+	uint32_t mipLevels;
 };
\ No newline at end of file
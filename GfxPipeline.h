@@ -1,12 +1,35 @@
 #pragma once
 #include "GfxFwdDecl.h"
 
+//Fixed function state recorded after binding a pipeline instead of being baked into it, see
+// GfxPipelineBuilder::SetDynamicState. Viewport and scissor are always dynamic and follow the render target
+struct GfxDynamicState
+{
+	bool bExtended = false; //Cull mode, front face and depth state are dynamic too, otherwise baked in as below
+	vk::CullModeFlags cullMode = vk::CullModeFlagBits::eNone;
+	vk::FrontFace frontFace = vk::FrontFace::eClockwise;
+	vk::Bool32 depthTestEnable = VK_FALSE;
+	vk::Bool32 depthWriteEnable = VK_FALSE;
+	vk::CompareOp depthCompareOp = vk::CompareOp::eNever;
+};
+
 struct GfxPipeline {
 	GfxPipeline() noexcept:
 		layout(nullptr),
-		pipeline(nullptr)
+		pipeline(nullptr),
+		dynamicState()
 	{}
 
 	vk::raii::PipelineLayout layout;
 	vk::raii::Pipeline pipeline;
+	GfxDynamicState dynamicState;
+};
+
+//What pipelines draw into. With dynamic rendering the formats are all a pipeline needs, renderPass is only set on the
+// render pass fallback for devices without it
+struct GfxAttachmentFormats
+{
+	vk::Format colorFormat = vk::Format::eUndefined;
+	vk::Format depthFormat = vk::Format::eUndefined;
+	vk::RenderPass renderPass = nullptr;
 };
\ No newline at end of file
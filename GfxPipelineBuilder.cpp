@@ -1,13 +1,26 @@
 #include "GfxPipelineBuilder.h"
+#include "GfxPipeline.h"
 //TODO split out mesh and vertex defs
 #include "Mesh.h"
 #include "Logger.h"
 
-vk::raii::Pipeline GfxPipelineBuilder::BuildPipeline(vk::raii::Device const& device, vk::RenderPass renderPass)
+vk::raii::Pipeline GfxPipelineBuilder::BuildPipeline(vk::raii::Device const& device, GfxAttachmentFormats const& attachments)
 {
     SPDLOG_INFO("Building Pipeline");
 
-    vk::PipelineViewportStateCreateInfo viewportStateCreateInfo({}, _viewport, _scissor);
+    //Counts only, the viewport and scissor themselves are dynamic so pipelines don't depend on the target size
+    vk::PipelineViewportStateCreateInfo viewportStateCreateInfo({}, 1, nullptr, 1, nullptr);
+    std::vector<vk::DynamicState> dynamicStates = { vk::DynamicState::eViewport, vk::DynamicState::eScissor };
+    if (_extendedDynamicState)
+    {
+        dynamicStates.insert(dynamicStates.end(), {
+            vk::DynamicState::eCullModeEXT,
+            vk::DynamicState::eFrontFaceEXT,
+            vk::DynamicState::eDepthTestEnableEXT,
+            vk::DynamicState::eDepthWriteEnableEXT,
+            vk::DynamicState::eDepthCompareOpEXT });
+    }
+    vk::PipelineDynamicStateCreateInfo dynamicStateCreateInfo({}, dynamicStates);
     vk::PipelineColorBlendStateCreateInfo colorBlending(
         {},
         VK_FALSE, //Logic Op enable
@@ -27,14 +40,25 @@ vk::raii::Pipeline GfxPipelineBuilder::BuildPipeline(vk::raii::Device const& dev
         &_multisampling,
         &_depthStencil /* depth stencil state*/,
         &colorBlending,
-        nullptr /*dynamic state*/,
+        &dynamicStateCreateInfo,
         _pipelineLayout,
-        renderPass,
+        attachments.renderPass,
         0 /*subpass*/,
         VK_NULL_HANDLE,
         0 /*base pipeline index*/
     );
 
+    //Only read when there is no render pass
+    vk::PipelineRenderingCreateInfoKHR renderingInfo(
+        0 /*view mask*/,
+        attachments.colorFormat,
+        attachments.depthFormat,
+        vk::Format::eUndefined /*stencil format*/);
+    if (!attachments.renderPass)
+    {
+        pipelineInfo.setPNext(&renderingInfo);
+    }
+
     vk::raii::Pipeline pipeline(
         device,
         nullptr,
@@ -44,6 +68,34 @@ vk::raii::Pipeline GfxPipelineBuilder::BuildPipeline(vk::raii::Device const& dev
 
 }
 
+GfxDynamicState GfxPipelineBuilder::GetDynamicState() const
+{
+    GfxDynamicState state;
+    state.bExtended = _extendedDynamicState;
+    state.cullMode = _rasterizer.cullMode;
+    state.frontFace = _rasterizer.frontFace;
+    state.depthTestEnable = _depthStencil.depthTestEnable;
+    state.depthWriteEnable = _depthStencil.depthWriteEnable;
+    state.depthCompareOp = _depthStencil.depthCompareOp;
+    return state;
+}
+
+void GfxPipelineBuilder::SetDynamicState(vk::CommandBuffer commandBuffer, GfxDynamicState const& state, vk::Extent2D targetExtent)
+{
+    vk::Viewport const viewport(0.0f, float(targetExtent.height), float(targetExtent.width), -float(targetExtent.height), 0.0f, 1.0f);
+    commandBuffer.setViewport(0, viewport);
+    commandBuffer.setScissor(0, vk::Rect2D({ 0, 0 }, targetExtent));
+
+    if (state.bExtended)
+    {
+        commandBuffer.setCullModeEXT(state.cullMode);
+        commandBuffer.setFrontFaceEXT(state.frontFace);
+        commandBuffer.setDepthTestEnableEXT(state.depthTestEnable);
+        commandBuffer.setDepthWriteEnableEXT(state.depthWriteEnable);
+        commandBuffer.setDepthCompareOpEXT(state.depthCompareOp);
+    }
+}
+
 vk::PipelineShaderStageCreateInfo GfxPipelineBuilder::CreateShaderStageInfo(vk::ShaderStageFlagBits stage, vk::ShaderModule shaderModule)
 {
     vk::PipelineShaderStageCreateInfo createInfo(
@@ -8,15 +8,23 @@ public:
 	std::vector<vk::PipelineShaderStageCreateInfo> _shaderStages;
 	VertexDescription _vertexDescription;
 	vk::PipelineInputAssemblyStateCreateInfo _inputAssembly;
-	vk::Viewport _viewport;
-	vk::Rect2D _scissor;
 	vk::PipelineRasterizationStateCreateInfo _rasterizer;
 	vk::PipelineColorBlendAttachmentState _colorBlendAttachment;
 	vk::PipelineMultisampleStateCreateInfo _multisampling;
 	vk::PipelineDepthStencilStateCreateInfo _depthStencil;
 	vk::PipelineLayout _pipelineLayout;
+	//Makes cull mode, front face and depth state dynamic, only set where GfxDevice::SupportsExtendedDynamicState.
+	// Pipelines then differ by shaders and blending alone
+	bool _extendedDynamicState = false;
 
-	vk::raii::Pipeline BuildPipeline(vk::raii::Device const& device, vk::RenderPass pass);
+	//Built for dynamic rendering into the attachment formats, or for subpass 0 of their render pass when one is set
+	vk::raii::Pipeline BuildPipeline(vk::raii::Device const& device, GfxAttachmentFormats const& attachments);
+	//What has to be set after binding the built pipeline, keep it alongside the pipeline
+	GfxDynamicState GetDynamicState() const;
+
+	//Sets the dynamic state of a pipeline built by this builder, after it's bound and before drawing. Secondary command
+	// buffers don't inherit dynamic state so each sets its own. The viewport is flipped so y is up
+	static void SetDynamicState(vk::CommandBuffer commandBuffer, GfxDynamicState const& state, vk::Extent2D targetExtent);
 
 	static vk::PipelineShaderStageCreateInfo CreateShaderStageInfo(vk::ShaderStageFlagBits stage, vk::ShaderModule shaderModule);
 	static vk::PipelineInputAssemblyStateCreateInfo CreateInputAssemblyInfo(vk::PrimitiveTopology topology);
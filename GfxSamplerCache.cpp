@@ -0,0 +1,86 @@
+#include "GfxSamplerCache.h"
+#include "Exceptions.h"
+#include "Logger.h"
+
+#include <bit>
+
+void HashCombine(size_t& seed, size_t value)
+{
+	seed ^= value + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+}
+
+size_t SamplerCreateInfoHash::operator()(vk::SamplerCreateInfo const& createInfo) const noexcept
+{
+	size_t seed = 0;
+	HashCombine(seed, static_cast<VkSamplerCreateFlags>(createInfo.flags));
+	HashCombine(seed, static_cast<size_t>(createInfo.magFilter));
+	HashCombine(seed, static_cast<size_t>(createInfo.minFilter));
+	HashCombine(seed, static_cast<size_t>(createInfo.mipmapMode));
+	HashCombine(seed, static_cast<size_t>(createInfo.addressModeU));
+	HashCombine(seed, static_cast<size_t>(createInfo.addressModeV));
+	HashCombine(seed, static_cast<size_t>(createInfo.addressModeW));
+	HashCombine(seed, std::bit_cast<uint32_t>(createInfo.mipLodBias));
+	HashCombine(seed, createInfo.anisotropyEnable);
+	HashCombine(seed, std::bit_cast<uint32_t>(createInfo.maxAnisotropy));
+	HashCombine(seed, createInfo.compareEnable);
+	HashCombine(seed, static_cast<size_t>(createInfo.compareOp));
+	HashCombine(seed, std::bit_cast<uint32_t>(createInfo.minLod));
+	HashCombine(seed, std::bit_cast<uint32_t>(createInfo.maxLod));
+	HashCombine(seed, static_cast<size_t>(createInfo.borderColor));
+	HashCombine(seed, createInfo.unnormalizedCoordinates);
+	return seed;
+}
+
+GfxSamplerCache::GfxSamplerCache(DevicePtr_t pDevice)
+	: m_pDevice(pDevice)
+	, m_mutex()
+	, m_samplers()
+{}
+
+SamplerPtr_t GfxSamplerCache::GetSampler(vk::SamplerCreateInfo const& createInfo)
+{
+	if (createInfo.pNext)
+	{
+		throw InvalidStateException("Sampler cache can't key samplers with extension structures");
+	}
+
+	std::scoped_lock lock(m_mutex);
+	auto found = m_samplers.find(createInfo);
+	if (found != m_samplers.end())
+	{
+		return found->second;
+	}
+
+	SamplerPtr_t pSampler = std::make_shared<vk::raii::Sampler>(*m_pDevice, createInfo);
+	m_samplers.emplace(createInfo, pSampler);
+	SPDLOG_DEBUG("Created sampler, {} unique samplers cached", m_samplers.size());
+	return pSampler;
+}
+
+size_t GfxSamplerCache::Size() const
+{
+	std::scoped_lock lock(m_mutex);
+	return m_samplers.size();
+}
+
+vk::SamplerCreateInfo GfxSamplerCache::LinearSamplerInfo(vk::SamplerAddressMode addressMode)
+{
+	return vk::SamplerCreateInfo(
+		{},
+		vk::Filter::eLinear /*mag filter*/,
+		vk::Filter::eLinear /*min filter*/,
+		vk::SamplerMipmapMode::eLinear /*mipmap mode*/,
+		/* U,V,W respectively*/
+		addressMode,
+		addressMode,
+		addressMode,
+		0.0f /*mip LOD bias*/,
+		VK_FALSE /*anisotropy enable*/,
+		0.0f /* max anisotropy*/,
+		VK_FALSE /* compare enable*/,
+		vk::CompareOp::eNever,
+		0.0f /*min LOD*/,
+		VK_LOD_CLAMP_NONE /*max LOD*/,
+		vk::BorderColor::eFloatOpaqueWhite
+	);
+}
\ No newline at end of file
@@ -0,0 +1,31 @@
+#pragma once
+#include "GfxFwdDecl.h"
+#include <mutex>
+#include <unordered_map>
+
+struct SamplerCreateInfoHash
+{
+	size_t operator()(vk::SamplerCreateInfo const& createInfo) const noexcept;
+};
+
+//Hands out one shared sampler per distinct SamplerCreateInfo, so sampler object counts stay bounded by the number of
+// distinct settings rather than the number of textures. Samplers live as long as the cache so they are safe to bake
+// into descriptor set layouts as immutable samplers
+class GfxSamplerCache
+{
+public:
+	GfxSamplerCache(DevicePtr_t pDevice);
+
+	//Extension chains are not part of the key, so createInfo.pNext must be null
+	SamplerPtr_t GetSampler(vk::SamplerCreateInfo const& createInfo);
+
+	size_t Size() const;
+
+	//Trilinear filtering over every mip level with the given addressing on all axes
+	static vk::SamplerCreateInfo LinearSamplerInfo(vk::SamplerAddressMode addressMode);
+
+private:
+	DevicePtr_t m_pDevice;
+	mutable std::mutex m_mutex;
+	std::unordered_map<vk::SamplerCreateInfo, SamplerPtr_t, SamplerCreateInfoHash> m_samplers;
+};
\ No newline at end of file
@@ -0,0 +1,19 @@
+#pragma once
+#include "GfxFwdDecl.h"
+
+uint32_t const k_maxFramesInFlight = 3;
+
+//How frames are paced from the cpu through the gpu and onto the screen
+struct GfxSettings
+{
+	vk::PresentModeKHR presentMode = vk::PresentModeKHR::eFifo; //Windowed only, mailbox or immediate for uncapped frame rates
+	//Frames the cpu may record ahead of the gpu, between 1 and k_maxFramesInFlight. Fewer cuts latency, more keeps the gpu fed
+	uint32_t framesInFlight = 2;
+	//Windowed only. Input is sampled and the simulation stepped on the render thread as late as the frame can start and
+	// still make the next refresh, see FramePacer. Pacing needs VK_KHR_present_wait, without it frames start as soon
+	// as the previous one is done
+	bool bLatencyMode = false;
+	//Begins passes straight on image views when the device supports VK_KHR_dynamic_rendering, otherwise falls back to a
+	// render pass with a framebuffer per swapchain image
+	bool bDynamicRendering = true;
+};
\ No newline at end of file
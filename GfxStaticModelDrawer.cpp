@@ -1,29 +1,36 @@
 #include "GfxStaticModelDrawer.h"
 #include "GfxPipeline.h"
+#include "GfxPipelineBuilder.h"
 #include "GfxDescriptorManager.h"
 
-void GfxStaticModelDrawer::DrawObjects(
+uint32_t GfxStaticModelDrawer::DrawObjects(
 	std::span<StaticModelPtr_t const> models,
 	GfxPipeline const& pipeline,
 	vk::CommandBuffer& secondaryCommandBuffer,
-	GfxDescriptorManagerPtr_t const& descriptorManager)
+	GfxDescriptorManagerPtr_t const& descriptorManager,
+	uint32_t frameSlot,
+	SceneSnapshot const& snapshot,
+	vk::Extent2D targetExtent)
 {
 	secondaryCommandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, *pipeline.pipeline);
+	GfxPipelineBuilder::SetDynamicState(secondaryCommandBuffer, pipeline.dynamicState, targetExtent);
 
 	secondaryCommandBuffer.bindDescriptorSets(
 		vk::PipelineBindPoint::eGraphics,
 		*pipeline.layout,
 		0,
-		descriptorManager->GetDescriptors(),
+		descriptorManager->GetDescriptors(frameSlot),
 		nullptr
 		);
 
-	for (uint32_t i = 0; auto const pModel : models)
+	for (auto const pModel : models)
 	{
 		secondaryCommandBuffer.bindVertexBuffers(0/*first binding*/, *pModel->GetVertexBuffer().m_buffer, { 0 } /*offset*/);
 		secondaryCommandBuffer.bindIndexBuffer(*pModel->GetIndexBuffer().m_buffer, 0/*offset*/, vk::IndexType::eUint32);
-		secondaryCommandBuffer.drawIndexed(pModel->GetIndexBuffer().m_dataSize / sizeof(uint32_t), 1/*instance count*/, 0, 0, i /*first instance*/);
-
-		i++;
+		secondaryCommandBuffer.pushConstants<VertexQuantization>(*pipeline.layout, vk::ShaderStageFlagBits::eVertex, 0/*offset*/, pModel->GetQuantization());
+		MeshLod const& lod = pModel->GetLod();
+		secondaryCommandBuffer.drawIndexed(lod.indexCount, 1/*instance count*/, lod.indexOffset, 0 /*vertex offset*/, pModel->GetTransformIndex(snapshot) /*first instance*/);
 	}
+
+	return uint32_t(models.size());
 }
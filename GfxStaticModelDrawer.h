@@ -8,9 +8,13 @@
 class GfxStaticModelDrawer
 {
 public:
-	static void DrawObjects(
+	//Returns the number of draws recorded
+	static uint32_t DrawObjects(
 		std::span<StaticModelPtr_t const> models,
 		GfxPipeline const& pipeline,
 		vk::CommandBuffer& secondaryCommandBuffer,
-		GfxDescriptorManagerPtr_t const& descriptorManager);
+		GfxDescriptorManagerPtr_t const& descriptorManager,
+		uint32_t frameSlot, //Selects the descriptor sets written for this frame
+		SceneSnapshot const& snapshot,
+		vk::Extent2D targetExtent);
 };
\ No newline at end of file
@@ -1,23 +1,37 @@
 #pragma once
 #include "GfxFwdDecl.h"
+#include "GfxImage.h"
 
 struct GfxSwapchain
 {
 	GfxSwapchain()
 		: m_imageViews()
+		, m_swapchainImages()
+		, m_images()
 		, m_swapchain(nullptr)
 		, m_format(vk::Format::eUndefined)
 		, m_extent(0,0)
+		, m_presentMode(vk::PresentModeKHR::eFifo)
 	{}
 
 	vk::ImageView GetImageView(uint32_t index) const {
-		return *m_imageViews.at(index);
+		return IsOffscreen() ? *m_images.at(index).view : *m_imageViews.at(index);
 	}
 
-	uint32_t Size() const { return m_imageViews.size(); }
+	vk::Image GetImage(uint32_t index) const {
+		return IsOffscreen() ? *m_images.at(index).image : m_swapchainImages.at(index);
+	}
+
+	uint32_t Size() const { return IsOffscreen() ? m_images.size() : m_imageViews.size(); }
+
+	//Offscreen swapchains own their images, there is nothing to acquire from or present to
+	bool IsOffscreen() const noexcept { return !m_images.empty(); }
 
 	std::vector<vk::raii::ImageView> m_imageViews;
+	std::vector<vk::Image> m_swapchainImages; //Owned by m_swapchain
+	std::vector<GfxImage> m_images; //Only filled for offscreen swapchains
 	vk::raii::SwapchainKHR m_swapchain;
 	vk::Format m_format;
 	vk::Extent2D m_extent;
+	vk::PresentModeKHR m_presentMode;
 };
\ No newline at end of file
@@ -1,6 +1,6 @@
 #include "GfxTextOverlay.h"
 #include "GfxDevice.h"
-#include "GfxFrame.h"
+#include "GfxPipeline.h"
 #include "GfxPipelineBuilder.h"
 #include "Mesh.h"
 #include "Math.h"
@@ -8,52 +8,177 @@
 #include "Logger.h"
 #include "ShaderLoader.h"
 
+#include <algorithm>
+#include <format>
+#include <span>
+#include <string_view>
+
+constexpr uint32_t PackColor(uint8_t r, uint8_t g, uint8_t b, uint8_t a)
+{
+	return uint32_t(r) | uint32_t(g) << 8 | uint32_t(b) << 16 | uint32_t(a) << 24;
+}
+
+//Formats into buffer rather than a new string, truncating if it doesn't fit
+template<typename... Args>
+std::string_view FormatTo(std::span<char> buffer, std::format_string<Args...> format, Args&&... args)
+{
+	auto const result = std::format_to_n(buffer.data(), buffer.size(), format, std::forward<Args>(args)...);
+	return std::string_view(buffer.data(), std::min<size_t>(result.size, buffer.size()));
+}
+
+//Writes quads in pixel coordinates from the top left into a slice of the overlay's glyph ring
+class OverlayQuadWriter
+{
+public:
+	OverlayQuadWriter(TextGlyph* pGlyphs, vk::Extent2D frameBufferDim, std::vector<SdfGlyph> const& fontGlyphs, float fontPixelSize, uint32_t fontFirstChar)
+		: m_pGlyphs(pGlyphs)
+		, m_quadCount(0)
+		, m_pixelToNdc(2.0f / float(frameBufferDim.width), 2.0f / float(frameBufferDim.height))
+		, m_fontGlyphs(fontGlyphs)
+		, m_fontPixelSize(fontPixelSize)
+		, m_fontFirstChar(fontFirstChar)
+	{}
+
+	uint32_t GetQuadCount() const noexcept { return m_quadCount; }
+
+	void AddQuad(glm::vec2 min, glm::vec2 max, glm::vec2 uvMin, glm::vec2 uvMax, uint32_t color)
+	{
+		if (m_quadCount == k_maxOverlayGlyphs)
+		{
+			return;
+		}
+
+		//The viewport is flipped so ndc y points up, pixel y counts down from the top
+		glm::vec2 const ndcMin(min.x * m_pixelToNdc.x - 1.0f, 1.0f - min.y * m_pixelToNdc.y);
+		glm::vec2 const ndcMax(max.x * m_pixelToNdc.x - 1.0f, 1.0f - max.y * m_pixelToNdc.y);
+		m_pGlyphs[m_quadCount] = TextGlyph{ ndcMin.x, ndcMin.y, ndcMax.x, ndcMax.y, uvMin.x, uvMin.y, uvMax.x, uvMax.y, color };
+		m_quadCount++;
+	}
+
+	void AddSolidQuad(glm::vec2 min, glm::vec2 max, uint32_t color)
+	{
+		AddQuad(min, max, glm::vec2(-1.0f), glm::vec2(-1.0f), color);
+	}
+
+	//baseline is the pen position for the first character, size is the font's pixel height. The distance field
+	// keeps edges sharp at any size
+	void AddText(std::string_view text, glm::vec2 baseline, float size, uint32_t color)
+	{
+		float const scale = size / m_fontPixelSize;
+		for (char const letter : text)
+		{
+			uint32_t const charIndex = uint32_t(uint8_t(letter)) - m_fontFirstChar;
+			if (charIndex >= m_fontGlyphs.size())
+			{
+				continue;
+			}
+
+			SdfGlyph const& glyph = m_fontGlyphs[charIndex];
+			if (glyph.x1 > glyph.x0)
+			{
+				AddQuad(
+					baseline + glm::vec2(glyph.x0, glyph.y0) * scale,
+					baseline + glm::vec2(glyph.x1, glyph.y1) * scale,
+					glm::vec2(glyph.u0, glyph.v0),
+					glm::vec2(glyph.u1, glyph.v1),
+					color);
+			}
+			baseline.x += glyph.advance * scale;
+		}
+	}
+
+	//One bar per sample oldest first, scaled so the tallest fits
+	void AddGraph(std::array<float, k_overlayGraphSamples> const& samples, uint32_t oldestSample, glm::vec2 min, glm::vec2 size, uint32_t color)
+	{
+		AddSolidQuad(min, min + size, PackColor(0, 0, 0, 128));
+
+		float const maxSample = std::max(*std::max_element(samples.begin(), samples.end()), 0.0001f);
+		float const barWidth = size.x / float(k_overlayGraphSamples);
+		for (uint32_t i = 0; i < k_overlayGraphSamples; ++i)
+		{
+			float const barHeight = samples[(oldestSample + i) % k_overlayGraphSamples] / maxSample * size.y;
+			float const x = min.x + float(i) * barWidth;
+			AddSolidQuad(glm::vec2(x, min.y + size.y - barHeight), glm::vec2(x + barWidth, min.y + size.y), color);
+		}
+	}
+
+private:
+	TextGlyph* m_pGlyphs;
+	uint32_t m_quadCount;
+	glm::vec2 m_pixelToNdc;
+	std::vector<SdfGlyph> const& m_fontGlyphs;
+	float m_fontPixelSize;
+	uint32_t m_fontFirstChar;
+};
+
 GfxTextOverlay::GfxTextOverlay()
 	: overlayPipeline(nullptr)
-	, overlayRenderPass(nullptr)
+	, overlayDynamicState()
+	, fontGlyphs()
+	, fontPixelSize(0.0f)
+	, fontFirstChar(0)
 	, textImage()
-	, sampler(nullptr)
+	, pSampler(nullptr)
 	, descriptorPool(nullptr)
 	, overlayDescriptorLayout(nullptr)
 	, overlaySet(nullptr)
 	, overlayLayout(nullptr)
-	, overlayVertexBuffer()
-	, overlayFrameBuffers({ nullptr, nullptr })
-	, commandPool(nullptr)
-	, commandBuffer(nullptr)
+	, overlayGlyphBuffer()
+	, commandPools()
+	, commandBuffers()
+	, cpuGraph()
+	, gpuGraph()
+	, drawGraph()
+	, memoryGraph()
+	, latencyGraph()
 {}
 
 GfxTextOverlay::GfxTextOverlay(
 	GfxDevicePtr_t pDevice,
 	vk::CommandPool graphicsCommandPool,
-	vk::Viewport viewport,
-	vk::Rect2D scissor)
+	GfxAttachmentFormats const& attachments,
+	uint32_t framesInFlight,
+	JobSystem& jobSystem)
 	: overlayPipeline(nullptr)
-	, overlayRenderPass(nullptr)
+	, overlayDynamicState()
+	, fontGlyphs()
+	, fontPixelSize(0.0f)
+	, fontFirstChar(0)
 	, textImage()
-	, sampler(nullptr)
+	, pSampler(nullptr)
 	, descriptorPool(nullptr)
 	, overlayDescriptorLayout(nullptr)
 	, overlaySet(nullptr)
 	, overlayLayout(nullptr)
-	, overlayVertexBuffer()
-	, overlayFrameBuffers({nullptr, nullptr})
-	, commandPool(nullptr)
-	, commandBuffer(nullptr)
+	, overlayGlyphBuffer()
+	, commandPools()
+	, commandBuffers()
+	, cpuGraph()
+	, gpuGraph()
+	, drawGraph()
+	, memoryGraph()
+	, latencyGraph()
 {
 	SPDLOG_INFO("Creating Text Overlay");
 
 	//Load font
-	uint32_t const k_fontWidth = STB_FONT_consolas_24_latin1_BITMAP_WIDTH;
-	uint32_t const k_fontHeight = STB_FONT_consolas_24_latin1_BITMAP_WIDTH;
+	SdfFontAtlas const fontAtlas = SdfFont::LoadOrGenerate(k_fontAtlasCachePath, jobSystem);
+	fontGlyphs = fontAtlas.glyphs;
+	fontPixelSize = fontAtlas.pixelSize;
+	fontFirstChar = fontAtlas.firstChar;
 
-	static uint8_t font24Pixels[k_fontWidth][k_fontHeight];
-	stb_font_consolas_24_latin1(stbFontData, font24Pixels, k_fontHeight);
-
-	commandPool = pDevice->CreateGraphicsCommandPool();
-	commandBuffer = std::move(pDevice->CreatePrimaryCommandBuffers(*commandPool, 1).front());
+	for (uint32_t i = 0; i < framesInFlight; ++i)
+	{
+		commandPools.push_back(pDevice->CreateGraphicsCommandPool());
+		commandBuffers.push_back(std::move(pDevice->CreateSecondaryCommandBuffers(*commandPools.back(), 1).front()));
+	}
 
-	overlayVertexBuffer = pDevice->CreateBuffer(k_max_char_count * sizeof(glm::vec4), vk::BufferUsageFlagBits::eVertexBuffer);
+	//A slice per frame in flight, written from the cpu each frame while the other slices may still be read
+	overlayGlyphBuffer = pDevice->CreateBuffer(framesInFlight * k_maxOverlayGlyphs * sizeof(TextGlyph), vk::BufferUsageFlagBits::eVertexBuffer);
+	if (!overlayGlyphBuffer.m_pData)
+	{
+		throw InitializationException("Cannot map text memory");
+	}
 
 	vk::Format textImageFormat = vk::Format::eR8Unorm;
 	vk::ImageCreateInfo createInfo(
@@ -61,8 +186,8 @@ GfxTextOverlay::GfxTextOverlay(
 		vk::ImageType::e2D,
 		textImageFormat,
 		vk::Extent3D{
-			k_fontWidth,
-			k_fontHeight,
+			fontAtlas.width,
+			fontAtlas.height,
 			1
 		},
 		1 /*Mip levels*/,
@@ -78,32 +203,14 @@ GfxTextOverlay::GfxTextOverlay(
 	//Stage data
 	vk::DeviceSize size = textImage.image.getMemoryRequirements().size;
 	GfxBuffer stagingBuffer = pDevice->CreateBuffer(size, vk::BufferUsageFlagBits::eTransferSrc);
-	memcpy(stagingBuffer.m_pData, &font24Pixels[0][0], static_cast<size_t>(k_fontWidth * k_fontHeight)); //Size of font texture is 1 byte hence just need width * height
+	memcpy(stagingBuffer.m_pData, fontAtlas.pixels.data(), fontAtlas.pixels.size()); //Size of font texture is 1 byte hence just need width * height
 
 
 	vk::Queue uploadQueue = pDevice->GetGraphicsQueue();
 	pDevice->UploadImageData(graphicsCommandPool, uploadQueue, textImage, stagingBuffer);
 
-	//Create sampler for text image
-	vk::SamplerCreateInfo samplerCreateInfo(
-		{},
-		vk::Filter::eLinear,
-		vk::Filter::eLinear,
-		vk::SamplerMipmapMode::eLinear,
-		/*address modes for U,V,W respectively*/
-		vk::SamplerAddressMode::eMirroredRepeat,
-		vk::SamplerAddressMode::eMirroredRepeat,
-		vk::SamplerAddressMode::eMirroredRepeat,
-		0.0f /*mip LOD bias*/,
-		VK_FALSE /*Anisotropy enable*/,
-		0.0f /*max anisotrophy*/,
-		VK_FALSE /*compare enable*/,
-		vk::CompareOp::eNever,
-		0.0f /*min LOD*/,
-		1.0f /*max LOD*/,
-		vk::BorderColor::eFloatOpaqueWhite
-	);
-	sampler = vk::raii::Sampler(pDevice->GetDevice(), samplerCreateInfo);
+	//Clamped so glyphs at the atlas edges never filter in distances from the opposite side
+	pSampler = pDevice->GetSampler(GfxSamplerCache::LinearSamplerInfo(vk::SamplerAddressMode::eClampToEdge));
 
 	//Font descriptor
 	vk::DescriptorPoolSize poolSize(vk::DescriptorType::eCombinedImageSampler, 1);
@@ -119,7 +226,7 @@ GfxTextOverlay::GfxTextOverlay(
 		0 /*binding id*/,
 		vk::DescriptorType::eCombinedImageSampler,
 		vk::ShaderStageFlagBits::eFragment,
-		*sampler
+		**pSampler
 	);
 	vk::DescriptorSetLayoutCreateInfo dslCreateInfo(
 		{},
@@ -133,7 +240,7 @@ GfxTextOverlay::GfxTextOverlay(
 	vk::DescriptorSetAllocateInfo allocInfo(*descriptorPool, *overlayDescriptorLayout);
 	overlaySet = std::move(pDevice->GetDevice().allocateDescriptorSets(allocInfo).front());
 
-	vk::DescriptorImageInfo textDescriptor(*sampler, *textImage.view, vk::ImageLayout::eShaderReadOnlyOptimal);
+	vk::DescriptorImageInfo textDescriptor(nullptr /*immutable sampler*/, *textImage.view, vk::ImageLayout::eShaderReadOnlyOptimal);
 
 	vk::WriteDescriptorSet writeSet(*overlaySet, 0, 0, vk::DescriptorType::eCombinedImageSampler, textDescriptor);
 	pDevice->GetDevice().updateDescriptorSets(writeSet, nullptr);
@@ -142,164 +249,90 @@ GfxTextOverlay::GfxTextOverlay(
 	vk::raii::ShaderModule textVertShader = ShaderLoader::LoadModule("text.vert.spv", pDevice);
 	vk::raii::ShaderModule textFragShader = ShaderLoader::LoadModule("text.frag.spv", pDevice);
 
-	overlayPipeline = CreateOverlayPipeline(pDevice, viewport, scissor, *textVertShader, *textFragShader, *overlayLayout);
-
-	UpdateTextOverlay(*pDevice->GetDevice(), scissor.extent);
+	overlayPipeline = CreateOverlayPipeline(pDevice, attachments, *textVertShader, *textFragShader, *overlayLayout);
 }
 
-vk::CommandBuffer GfxTextOverlay::RenderTextOverlay(GfxFrame const& frame, vk::Rect2D renderArea)
+vk::CommandBuffer GfxTextOverlay::RenderTextOverlay(vk::CommandBufferInheritanceInfo const* pInheritanceInfo, uint32_t frameSlot, vk::Extent2D frameBufferDim, FrameStats const& stats, GfxGpuProfiler& profiler)
 {
-	commandPool.reset();
-	vk::CommandBufferBeginInfo const cbBeginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
-	commandBuffer.begin(cbBeginInfo);
-
-	vk::ClearValue clearValues[2] =
-	{
-		vk::ClearValue(),
-		vk::ClearColorValue()
-	};
-
-	vk::RenderPassBeginInfo const beginInfo(*overlayRenderPass, *frame.frameBuffer, renderArea, clearValues);
-	commandBuffer.beginRenderPass(beginInfo, vk::SubpassContents::eInline);
-	commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, *overlayPipeline);
-	commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, *overlayLayout, 0, *overlaySet, nullptr);
+	AddSample(cpuGraph, float(stats.cpuMs));
+	AddSample(gpuGraph, float(stats.gpuMs));
+	AddSample(drawGraph, float(stats.drawCount));
+	AddSample(memoryGraph, float(stats.gpuMemoryBytes / (1024 * 1024)));
+	AddSample(latencyGraph, float(stats.latencyMs));
+	uint32_t const glyphCount = UpdateTextOverlay(frameSlot, frameBufferDim, stats);
+
+	commandPools[frameSlot].reset();
+	vk::raii::CommandBuffer const& commandBuffer = commandBuffers[frameSlot];
+	vk::CommandBufferBeginInfo const beginInfo(
+		vk::CommandBufferUsageFlagBits::eRenderPassContinue | vk::CommandBufferUsageFlagBits::eOneTimeSubmit,
+		pInheritanceInfo);
+	commandBuffer.begin(beginInfo);
 
-	commandBuffer.bindVertexBuffers(0, *overlayVertexBuffer.m_buffer, { 0 });
-
-	for (uint32_t i = 0; i < overlayText.size(); ++i)
 	{
-		commandBuffer.draw(4, 1, i * 4, 0);
+		GpuScope scope(profiler, *commandBuffer, "Overlay");
+		commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, *overlayPipeline);
+		GfxPipelineBuilder::SetDynamicState(*commandBuffer, overlayDynamicState, frameBufferDim);
+		commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, *overlayLayout, 0, *overlaySet, nullptr);
+
+		//Every glyph is a 4 vertex strip, the instance range selects this frame's slice of the ring
+		commandBuffer.bindVertexBuffers(0, *overlayGlyphBuffer.m_buffer, { 0 });
+		commandBuffer.draw(4, glyphCount, 0, frameSlot * k_maxOverlayGlyphs);
 	}
-
-	commandBuffer.endRenderPass();
 	commandBuffer.end();
 
 	return *commandBuffer;
 }
 
-void GfxTextOverlay::UpdateTextOverlay(vk::Device device, vk::Extent2D frameBufferDim)
+void GfxTextOverlay::AddSample(Graph& graph, float sample)
 {
-	//fill in vertex buffer with the correct uv data
-	TextVertex* pIter = (TextVertex*)overlayVertexBuffer.m_pData;
-
-	if (!pIter)
-	{
-		throw InitializationException("Cannot map text memory");
-	}
-
-	//Add text
-	float x = (5.0f / (float)frameBufferDim.width * 2.0) - 1.0f;
-	float y = (5.0f / (float)frameBufferDim.height * 2.0) - 1.0f;
-
-	uint32_t const firstChar = STB_FONT_consolas_24_latin1_FIRST_CHAR;
-
-	float const charW = 2.5f / frameBufferDim.width;
-	float const charH = 2.5f / frameBufferDim.height;
-
-	//Calculate total text width
-	float textWidth = 0;
-	for (char letter : overlayText)
-	{
-		stb_fontchar* charData = &stbFontData[(uint32_t)letter - firstChar];
-		textWidth += charData->advance * charW;
-	}
-
-	//Generate uv mapped quad per char
-	//TODO proper ranges for mapped memory and iterating through it?
-	for (char letter : overlayText)
-	{
-		stb_fontchar* charData = &stbFontData[(uint32_t)letter - firstChar];
-
-		//Top left
-		pIter->vx = x + charData->x0 * charW;
-		pIter->vy = -(y + charData->y0 * charH);
-		pIter->u = charData->s0f;
-		pIter->v = charData->t0f;
-		pIter++;
-
-		//Bottom left
-		pIter->vx = x + charData->x0 * charW;
-		pIter->vy = -(y + charData->y1 * charH);
-		pIter->u = charData->s0f;
-		pIter->v = charData->t1f;
-		pIter++;
-
-		//Top right
-		pIter->vx = x + charData->x1 * charW;
-		pIter->vy = -(y + charData->y0 * charH);
-		pIter->u = charData->s1f;
-		pIter->v = charData->t0f;
-		pIter++;
-
-		//Bottom right
-		pIter->vx = x + charData->x1 * charW;
-		pIter->vy = -(y + charData->y1 * charH);
-		pIter->u = charData->s1f;
-		pIter->v = charData->t1f;
-		pIter++;
-
-		x += charData->advance * charW;
-
-	}
+	graph.samples[graph.nextSample] = sample;
+	graph.nextSample = (graph.nextSample + 1) % k_overlayGraphSamples;
 }
 
-vk::raii::RenderPass GfxTextOverlay::CreateOverlayRenderPass(GfxDevicePtr_t pDevice, vk::Format colorFormat, vk::Format depthFormat)
+uint32_t GfxTextOverlay::UpdateTextOverlay(uint32_t frameSlot, vk::Extent2D frameBufferDim, FrameStats const& stats)
 {
-	std::array<vk::AttachmentDescription, 2> attachments =
-	{
-		//Color attachment
-		vk::AttachmentDescription(
-			{},
-			colorFormat,
-			vk::SampleCountFlagBits::e1,
-			vk::AttachmentLoadOp::eLoad, //Dont clear as this is an overlay
-			vk::AttachmentStoreOp::eStore,
-			vk::AttachmentLoadOp::eDontCare,
-			vk::AttachmentStoreOp::eDontCare,
-			vk::ImageLayout::ePresentSrcKHR,
-			vk::ImageLayout::ePresentSrcKHR
-		),
-		//Depth attachment
-		vk::AttachmentDescription(
-			{},
-			depthFormat,
-			vk::SampleCountFlagBits::e1,
-			vk::AttachmentLoadOp::eClear,
-			vk::AttachmentStoreOp::eStore,
-			vk::AttachmentLoadOp::eDontCare,
-			vk::AttachmentStoreOp::eDontCare,
-			vk::ImageLayout::eUndefined,
-			vk::ImageLayout::eDepthStencilAttachmentOptimal
-		)
+	constexpr float k_margin = 8.0f;
+	constexpr float k_rowHeight = 28.0f;
+	constexpr float k_labelWidth = 180.0f;
+	constexpr float k_baselineOffset = 20.0f;
+	constexpr float k_textSize = 20.0f;
+	glm::vec2 const graphSize(240.0f, 22.0f);
+	uint32_t const white = PackColor(255, 255, 255, 255);
+
+	TextGlyph* pSlice = (TextGlyph*)overlayGlyphBuffer.m_pData + frameSlot * k_maxOverlayGlyphs;
+	OverlayQuadWriter writer(pSlice, frameBufferDim, fontGlyphs, fontPixelSize, fontFirstChar);
+
+	std::array<Graph const*, 5> const graphs = { &cpuGraph, &gpuGraph, &drawGraph, &memoryGraph, &latencyGraph };
+	std::array<uint32_t, 5> const graphColors = {
+		PackColor(90, 200, 90, 255),
+		PackColor(90, 150, 240, 255),
+		PackColor(240, 190, 70, 255),
+		PackColor(210, 100, 210, 255),
+		PackColor(230, 90, 80, 255)
 	};
 
-	std::array<vk::SubpassDependency, 2> dependencies = {
-		//Transition from final to initial
-		vk::SubpassDependency(
-			VK_SUBPASS_EXTERNAL,
-			0,
-			vk::PipelineStageFlagBits::eBottomOfPipe,
-			vk::PipelineStageFlagBits::eColorAttachmentOutput,
-			vk::AccessFlagBits::eMemoryRead,
-			vk::AccessFlagBits::eColorAttachmentRead | vk::AccessFlagBits::eColorAttachmentWrite,
-			vk::DependencyFlagBits::eByRegion
-		),
-		//Transition from initial to final
-		vk::SubpassDependency(
-			0,
-			VK_SUBPASS_EXTERNAL,
-			vk::PipelineStageFlagBits::eColorAttachmentOutput,
-			vk::PipelineStageFlagBits::eBottomOfPipe,
-			vk::AccessFlagBits::eColorAttachmentRead | vk::AccessFlagBits::eColorAttachmentWrite,
-			vk::AccessFlagBits::eMemoryRead,
-			vk::DependencyFlagBits::eByRegion
-		)
+	//Labels are formatted in place, nothing is allocated per frame
+	std::array<std::array<char, 32>, 5> textBuffers;
+	std::array<std::string_view, 5> const labels = {
+		FormatTo(textBuffers[0], "cpu  {:7.2f} ms", stats.cpuMs),
+		FormatTo(textBuffers[1], "gpu  {:7.2f} ms", stats.gpuMs),
+		FormatTo(textBuffers[2], "draw {:7}", stats.drawCount),
+		stats.gpuMemoryBytes > 0 ? FormatTo(textBuffers[3], "vram {:7} MB", stats.gpuMemoryBytes / (1024 * 1024)) : std::string_view("vram     n/a"),
+		stats.latencyMs > 0.0 ? FormatTo(textBuffers[4], "lat  {:7.2f} ms", stats.latencyMs) : std::string_view("lat      n/a")
 	};
 
-	return std::move(GfxPipelineBuilder::CreateRenderPass(pDevice->GetDevice(), attachments, dependencies));
+	writer.AddSolidQuad(glm::vec2(0.0f), glm::vec2(2.0f * k_margin + k_labelWidth + graphSize.x, 2.0f * k_margin + float(graphs.size()) * k_rowHeight), PackColor(0, 0, 0, 96));
+	for (uint32_t i = 0; i < graphs.size(); ++i)
+	{
+		glm::vec2 const rowMin(k_margin, k_margin + float(i) * k_rowHeight);
+		writer.AddText(labels[i], rowMin + glm::vec2(0.0f, k_baselineOffset), k_textSize, white);
+		writer.AddGraph(graphs[i]->samples, graphs[i]->nextSample, rowMin + glm::vec2(k_labelWidth, 0.0f), graphSize, graphColors[i]);
+	}
+
+	return writer.GetQuadCount();
 }
 
-vk::raii::Pipeline GfxTextOverlay::CreateOverlayPipeline(GfxDevicePtr_t pDevice, vk::Viewport viewport, vk::Rect2D scissor, vk::ShaderModule textVertShader, vk::ShaderModule textFragShader, vk::PipelineLayout pipelineLayout)
+vk::raii::Pipeline GfxTextOverlay::CreateOverlayPipeline(GfxDevicePtr_t pDevice, GfxAttachmentFormats const& attachments, vk::ShaderModule textVertShader, vk::ShaderModule textFragShader, vk::PipelineLayout pipelineLayout)
 {
 	GfxPipelineBuilder builder;
 	vk::PipelineColorBlendAttachmentState colorBlend(
@@ -316,11 +349,10 @@ vk::raii::Pipeline GfxTextOverlay::CreateOverlayPipeline(GfxDevicePtr_t pDevice,
 	builder._inputAssembly = GfxPipelineBuilder::CreateInputAssemblyInfo(vk::PrimitiveTopology::eTriangleStrip);
 	builder._rasterizer = GfxPipelineBuilder::CreateRasterizationStateInfo(vk::PolygonMode::eFill, vk::CullModeFlagBits::eNone);
 	builder._colorBlendAttachment = colorBlend;
-	builder._depthStencil = GfxPipelineBuilder::CreateDepthStencilStateInfo(VK_TRUE, VK_TRUE, vk::CompareOp::eLessOrEqual);
-	builder._viewport = viewport;
-	builder._scissor = scissor;
+	//Drawn over the scene in the main pass, so it neither tests against nor disturbs the scene's depth
+	builder._depthStencil = GfxPipelineBuilder::CreateDepthStencilStateInfo(VK_FALSE, VK_FALSE, vk::CompareOp::eAlways);
 	builder._multisampling = GfxPipelineBuilder::CreateMultisampleStateInfo();
-	builder._vertexDescription = TextVertex::GetDescription();
+	builder._vertexDescription = TextGlyph::GetDescription();
 	builder._shaderStages.push_back(
 		GfxPipelineBuilder::CreateShaderStageInfo(vk::ShaderStageFlagBits::eVertex, textVertShader)
 	);
@@ -328,7 +360,8 @@ vk::raii::Pipeline GfxTextOverlay::CreateOverlayPipeline(GfxDevicePtr_t pDevice,
 		GfxPipelineBuilder::CreateShaderStageInfo(vk::ShaderStageFlagBits::eFragment, textFragShader)
 	);
 	builder._pipelineLayout = pipelineLayout;
-	overlayRenderPass = CreateOverlayRenderPass(pDevice, vk::Format::eB8G8R8A8Unorm, vk::Format::eD16Unorm);
+	builder._extendedDynamicState = pDevice->SupportsExtendedDynamicState();
 
-	return builder.BuildPipeline(pDevice->GetDevice(), *overlayRenderPass);
+	overlayDynamicState = builder.GetDynamicState();
+	return builder.BuildPipeline(pDevice->GetDevice(), attachments);
 }
@@ -1,12 +1,18 @@
 #pragma once
 #include "GfxFwdDecl.h"
-#include "stb_font_consolas_24_latin1.inl"
 #include "GfxImage.h"
 #include "GfxBuffer.h"
+#include "GfxPipeline.h"
+#include "GfxGpuProfiler.h"
+#include "FrameStats.h"
+#include "SdfFont.h"
 
-constexpr uint32_t k_max_char_count = 2048;
-std::string const overlayText = "hello there";
+constexpr uint32_t k_maxOverlayGlyphs = 2048; //Per frame in flight, graph bars and backgrounds count as glyphs
+constexpr uint32_t k_overlayGraphSamples = 120;
+constexpr char const* k_fontAtlasCachePath = "consolas_24_latin1.sdf";
 
+//Live performance readout drawn over the finished frame. Text and graphs are rebuilt every frame into that frame's
+// slice of a persistently mapped instance ring, then drawn as one instanced draw at the end of the main render pass
 class GfxTextOverlay
 {
 public:
@@ -15,35 +21,52 @@ public:
 	GfxTextOverlay(
 		GfxDevicePtr_t pDevice,
 		vk::CommandPool graphicsCommandPool,
-		vk::Viewport viewport,
-		vk::Rect2D scissor);
+		GfxAttachmentFormats const& attachments, //Overlay is recorded as a secondary command buffer inside the main pass
+		uint32_t framesInFlight,
+		JobSystem& jobSystem); //Generates the font atlas when it isn't cached yet
 
-	vk::CommandBuffer RenderTextOverlay(GfxFrame const& frame, vk::Rect2D renderArea);
+	//Adds stats to the graphs and rebuilds frameSlot's overlay. frameSlot's previous submission must have completed
+	vk::CommandBuffer RenderTextOverlay(vk::CommandBufferInheritanceInfo const* pInheritanceInfo, uint32_t frameSlot, vk::Extent2D frameBufferDim, FrameStats const& stats, GfxGpuProfiler& profiler);
+	uint32_t GetDrawCount() const noexcept { return 1; }
 
 private:
-	void UpdateTextOverlay(vk::Device device, vk::Extent2D frameBufferDim);
-	vk::raii::RenderPass CreateOverlayRenderPass(GfxDevicePtr_t pDevice, vk::Format colorFormat, vk::Format depthFormat);
+	struct Graph
+	{
+		std::array<float, k_overlayGraphSamples> samples = {};
+		uint32_t nextSample = 0; //Also the oldest sample once the graph has filled
+	};
+
+	static void AddSample(Graph& graph, float sample);
+	//Returns the number of glyphs written
+	uint32_t UpdateTextOverlay(uint32_t frameSlot, vk::Extent2D frameBufferDim, FrameStats const& stats);
 	vk::raii::Pipeline CreateOverlayPipeline(
 		GfxDevicePtr_t pDevice,
-		vk::Viewport viewport,
-		vk::Rect2D scissor,
+		GfxAttachmentFormats const& attachments,
 		vk::ShaderModule textVertShader,
 		vk::ShaderModule textFragShader,
 		vk::PipelineLayout pipelineLayout);
 
-	stb_fontchar stbFontData[STB_FONT_consolas_24_latin1_NUM_CHARS];
+	std::vector<SdfGlyph> fontGlyphs;
+	float fontPixelSize;
+	uint32_t fontFirstChar;
 	GfxImage textImage;
-	vk::raii::Sampler sampler;
+	SamplerPtr_t pSampler;
 	vk::raii::DescriptorPool descriptorPool;
 	vk::raii::DescriptorSetLayout overlayDescriptorLayout;
 	vk::raii::PipelineLayout overlayLayout;
 	vk::raii::DescriptorSet overlaySet;
-	vk::raii::CommandBuffer commandBuffer;
-	vk::raii::CommandPool commandPool;
-	vk::raii::RenderPass overlayRenderPass;
+	//One pool per frame in flight so recording never resets a buffer the gpu may still be reading
+	std::vector<vk::raii::CommandPool> commandPools;
+	std::vector<vk::raii::CommandBuffer> commandBuffers;
 	vk::raii::Pipeline overlayPipeline;
-	GfxBuffer overlayVertexBuffer;
-	std::array<vk::raii::Framebuffer, 2> overlayFrameBuffers;
+	GfxDynamicState overlayDynamicState;
+	GfxBuffer overlayGlyphBuffer;
+
+	Graph cpuGraph;
+	Graph gpuGraph;
+	Graph drawGraph;
+	Graph memoryGraph;
+	Graph latencyGraph;
 
 };
 
@@ -2,12 +2,172 @@
 
 #include "Exceptions.h"
 #include "GfxDevice.h"
+#include "KtxFile.h"
+#include "Logger.h"
+#include "CpuProfiler.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <filesystem>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
-ImagePtr_t ImageLoader::LoadTexture(GfxDevice& device, std::string const& filePath)
+//Compressed textures well below this have visible blocking
+constexpr float k_minCompressionPsnr = 30.0f;
+
+constexpr uint32_t k_linearToSrgbSteps = 4096; //Fine enough that every 8 bit sRGB value is reachable
+
+struct SrgbTables
+{
+    std::array<float, 256> toLinear;
+    std::array<uint8_t, k_linearToSrgbSteps + 1> toSrgb;
+};
+
+//Lookup tables so filtering doesn't pay for a pow per channel
+SrgbTables const& GetSrgbTables()
+{
+    static SrgbTables const k_tables = []()
+    {
+        SrgbTables tables;
+        for (uint32_t i = 0; i < tables.toLinear.size(); ++i)
+        {
+            float const c = i / 255.0f;
+            tables.toLinear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+        }
+        for (uint32_t i = 0; i < tables.toSrgb.size(); ++i)
+        {
+            float const l = float(i) / k_linearToSrgbSteps;
+            float const c = l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow(l, 1.0f / 2.4f) - 0.055f;
+            tables.toSrgb[i] = uint8_t(std::clamp(c * 255.0f + 0.5f, 0.0f, 255.0f));
+        }
+        return tables;
+    }();
+    return k_tables;
+}
+
+#if defined(_M_X64) || defined(__SSE2__)
+//Averages 2x2 texels of two source rows into two output texels per iteration. Returns how many output texels were written,
+//the rest need the scalar path as they would read past the end of the row
+uint32_t DownsampleRowSse2(uint8_t const* pRow0, uint8_t const* pRow1, uint8_t* pOut, uint32_t outWidth, uint32_t width)
+{
+    __m128i const zero = _mm_setzero_si128();
+    __m128i const rounding = _mm_set1_epi16(2);
+
+    uint32_t x = 0;
+    for (; x + 1 < outWidth && x * 2 + 3 < width; x += 2)
+    {
+        __m128i const top = _mm_loadu_si128((__m128i const*)(pRow0 + x * 8));
+        __m128i const bottom = _mm_loadu_si128((__m128i const*)(pRow1 + x * 8));
+
+        //Widen to 16 bits and add the rows, the low half holds source texels 0 and 1, the high half 2 and 3
+        __m128i const low = _mm_add_epi16(_mm_unpacklo_epi8(top, zero), _mm_unpacklo_epi8(bottom, zero));
+        __m128i const high = _mm_add_epi16(_mm_unpackhi_epi8(top, zero), _mm_unpackhi_epi8(bottom, zero));
+
+        //Add horizontal neighbours, each pair's sum lands in the low 64 bits
+        __m128i const sumLow = _mm_add_epi16(low, _mm_srli_si128(low, 8));
+        __m128i const sumHigh = _mm_add_epi16(high, _mm_srli_si128(high, 8));
+        __m128i const averages = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(sumLow, sumHigh), rounding), 2);
+
+        _mm_storel_epi64((__m128i*)(pOut + x * 4), _mm_packus_epi16(averages, averages));
+    }
+    return x;
+}
+#endif
+
+//2x2 box filter to the next mip level. Odd dimensions clamp the second tap to the last row or column.
+//sRGB colour is averaged in linear space so mips don't darken, alpha is always linear
+std::vector<uint8_t> Downsample(std::span<uint8_t const> rgba, uint32_t width, uint32_t height, bool srgb)
+{
+    uint32_t const outWidth = std::max(1u, width / 2);
+    uint32_t const outHeight = std::max(1u, height / 2);
+    std::vector<uint8_t> result(size_t(outWidth) * outHeight * 4);
+    SrgbTables const& tables = GetSrgbTables();
+
+    for (uint32_t y = 0; y < outHeight; ++y)
+    {
+        uint8_t const* const pRow0 = &rgba[size_t(std::min(y * 2, height - 1)) * width * 4];
+        uint8_t const* const pRow1 = &rgba[size_t(std::min(y * 2 + 1, height - 1)) * width * 4];
+        uint8_t* const pOutRow = &result[size_t(y) * outWidth * 4];
+
+        uint32_t x = 0;
+#if defined(_M_X64) || defined(__SSE2__)
+        if (!srgb)
+        {
+            x = DownsampleRowSse2(pRow0, pRow1, pOutRow, outWidth, width);
+        }
+#endif
+
+        for (; x < outWidth; ++x)
+        {
+            uint32_t const x0 = std::min(x * 2, width - 1) * 4;
+            uint32_t const x1 = std::min(x * 2 + 1, width - 1) * 4;
+            uint8_t const* const taps[4] = { pRow0 + x0, pRow0 + x1, pRow1 + x0, pRow1 + x1 };
+
+            uint8_t* const pOut = pOutRow + x * 4;
+            for (uint32_t c = 0; c < 4; ++c)
+            {
+                if (srgb && c < 3)
+                {
+                    float const sum = tables.toLinear[taps[0][c]] + tables.toLinear[taps[1][c]] + tables.toLinear[taps[2][c]] + tables.toLinear[taps[3][c]];
+                    pOut[c] = tables.toSrgb[uint32_t(sum * 0.25f * k_linearToSrgbSteps + 0.5f)];
+                }
+                else
+                {
+                    pOut[c] = uint8_t((taps[0][c] + taps[1][c] + taps[2][c] + taps[3][c] + 2) / 4);
+                }
+            }
+        }
+    }
+
+    return result;
+}
+
+std::string GetCachePath(std::string const& filePath, TextureCompression compression)
+{
+    return filePath + "." + TextureCompressor::GetName(compression) + ".ktx2";
+}
+
+bool IsCacheCurrent(std::string const& filePath, std::string const& cachePath)
+{
+    std::error_code error;
+    auto const cacheTime = std::filesystem::last_write_time(cachePath, error);
+    if (error)
+    {
+        return false;
+    }
+
+    auto const sourceTime = std::filesystem::last_write_time(filePath, error);
+    return error || cacheTime >= sourceTime; //Cache alone is fine if the source was removed
+}
+
+ImageData ImageLoader::DecodeTexture(std::string const& filePath, TextureCompression compression)
 {
+    PROFILE_ZONE("ImageLoader::DecodeTexture");
+    vk::Format const format = TextureCompressor::GetFormat(compression);
+    std::string const cachePath = GetCachePath(filePath, compression);
+    if (compression != TextureCompression::eNone && IsCacheCurrent(filePath, cachePath))
+    {
+        try
+        {
+            ImageData cached;
+            if (KtxFile::Read(cachePath, cached) && cached.format == format)
+            {
+                SPDLOG_DEBUG("Loaded cached texture {}", cachePath);
+                return cached;
+            }
+        }
+        catch (InvalidStateException const& e)
+        {
+            SPDLOG_WARN("Ignoring texture cache: {}", e.what());
+        }
+    }
+
     int width, height, channels;
     stbi_uc* const pixels = stbi_load(filePath.c_str(), &width, &height, &channels, STBI_rgb_alpha);
 
@@ -16,29 +176,122 @@ ImagePtr_t ImageLoader::LoadTexture(GfxDevice& device, std::string const& filePa
         throw InvalidStateException("Failed to load image at: " + filePath);
     }
 
-    size_t const imageSize = (size_t)width * (size_t)height * (size_t)channels;
-    GfxBuffer buffer = device.CreateBuffer(imageSize, vk::BufferUsageFlagBits::eTransferSrc);
-
-    memcpy(buffer.m_pData, pixels, imageSize);
+    //STBI_rgb_alpha always expands to 4 channels, channels only reports what the file had
+    size_t const imageSize = (size_t)width * (size_t)height * 4;
+    std::vector<uint8_t> level(pixels, pixels + imageSize);
     stbi_image_free(pixels);
 
-    ImagePtr_t pImage = std::make_shared<Image>();
-    pImage->width = width;
-    pImage->height = height;
-    pImage->data = std::move(buffer);
+    ImageData image;
+    image.width = width;
+    image.height = height;
+    image.format = format;
+    //Uncompressed formats can be filtered by the gpu, block compressed ones need every level encoded here
+    image.generateMips = compression == TextureCompression::eNone;
+
+    //BC5 holds linear data such as normals, everything else is sRGB colour
+    bool const srgb = compression != TextureCompression::eBC5;
+    uint32_t levelWidth = image.width;
+    uint32_t levelHeight = image.height;
+    while (true)
+    {
+        std::vector<uint8_t> const encoded = TextureCompressor::Encode(compression, level, levelWidth, levelHeight);
+        if (image.levels.empty() && compression != TextureCompression::eNone)
+        {
+            std::vector<uint8_t> const decoded = TextureCompressor::Decode(compression, encoded, levelWidth, levelHeight);
+            float const psnr = TextureCompressor::MeasurePsnr(compression, level, decoded);
+            SPDLOG_INFO("Compressed {} to {}: {} -> {} bytes, PSNR {:.2f} dB", filePath, TextureCompressor::GetName(compression), imageSize, encoded.size(), psnr);
+            if (psnr < k_minCompressionPsnr)
+            {
+                SPDLOG_WARN("{} compresses poorly to {}, PSNR {:.2f} dB is under {:.2f} dB", filePath, TextureCompressor::GetName(compression), psnr, k_minCompressionPsnr);
+            }
+        }
+
+        image.levels.push_back(ImageLevel{ .offset = image.pixels.size(), .size = encoded.size(), .width = levelWidth, .height = levelHeight });
+        image.pixels.insert(image.pixels.end(), encoded.begin(), encoded.end());
+
+        if (image.generateMips || (levelWidth == 1 && levelHeight == 1))
+        {
+            break;
+        }
+
+        level = Downsample(level, levelWidth, levelHeight, srgb);
+        levelWidth = std::max(1u, levelWidth / 2);
+        levelHeight = std::max(1u, levelHeight / 2);
+    }
+
+    if (compression != TextureCompression::eNone)
+    {
+        try
+        {
+            KtxFile::Write(cachePath, image);
+        }
+        catch (InvalidStateException const& e)
+        {
+            SPDLOG_WARN("Failed to cache compressed texture: {}", e.what());
+        }
+    }
+
+    return image;
+}
+
+GfxImage ImageLoader::UploadTexture(GfxDevice& device, vk::CommandPool commandPool, ImageData const& imageData)
+{
+    if (!device.SupportsSampledFormat(imageData.format))
+    {
+        throw InvalidStateException("Device can't sample texture format " + vk::to_string(imageData.format));
+    }
+
+    uint32_t mipLevels = uint32_t(imageData.levels.size());
+    vk::ImageUsageFlags usage = vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled;
+    if (imageData.generateMips)
+    {
+        if (device.SupportsLinearBlit(imageData.format))
+        {
+            mipLevels = uint32_t(std::floor(std::log2(std::max(imageData.width, imageData.height)))) + 1;
+            usage |= vk::ImageUsageFlagBits::eTransferSrc;
+        }
+        else
+        {
+            SPDLOG_WARN("Can't blit mips for format {}, texture will only have the levels it was loaded with", vk::to_string(imageData.format));
+        }
+    }
+
+    GfxBuffer stagingBuffer = device.CreateBuffer(imageData.pixels.size(), vk::BufferUsageFlagBits::eTransferSrc);
+    memcpy(stagingBuffer.m_pData, imageData.pixels.data(), imageData.pixels.size());
+
+    vk::ImageCreateInfo textureCreateInfo(
+        {},
+        vk::ImageType::e2D,
+        imageData.format,
+        vk::Extent3D{
+            imageData.width,
+            imageData.height,
+            1
+        },
+        mipLevels,
+        1 /*array levels*/,
+        vk::SampleCountFlagBits::e1,
+        vk::ImageTiling::eOptimal,
+        usage,
+        vk::SharingMode::eExclusive
+    );
+    GfxImage image = device.CreateImage(textureCreateInfo, vk::ImageAspectFlagBits::eColor, vk::MemoryPropertyFlagBits::eDeviceLocal);
 
-    switch (channels)
+    //One region per level, compressed levels smaller than a block still use their real texel extent
+    std::vector<vk::BufferImageCopy> regions;
+    for (uint32_t i = 0; i < imageData.levels.size(); ++i)
     {
-    case 3:
-        pImage->format = vk::Format::eR8G8B8Srgb;
-        break;
-    case 4:
-        pImage->format = vk::Format::eR8G8B8A8Srgb;
-        break;
-    default:
-        throw InvalidStateException("Loading Image with unsupported number of color channels at: " + filePath);
-        break;
+        ImageLevel const& level = imageData.levels[i];
+        regions.emplace_back(
+            level.offset,
+            0 /*buffer row length*/,
+            0 /*buffer image height*/,
+            vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, i /*mip level*/, 0 /*base array layer*/, 1 /*layer count*/),
+            vk::Offset3D(0, 0, 0),
+            vk::Extent3D(level.width, level.height, 1)
+        );
     }
+    device.UploadImageData(commandPool, device.GetGraphicsQueue(), image, stagingBuffer, regions);
 
-    return pImage;
+    return image;
 }
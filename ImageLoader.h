@@ -1,21 +1,33 @@
 #pragma once
 
 #include "GfxFwdDecl.h"
-#include "GfxBuffer.h"
+#include "GfxImage.h"
+#include "TextureCompressor.h"
 
-struct Image
+struct ImageLevel
 {
-	GfxBuffer data;
+	size_t offset; //Into ImageData::pixels
+	size_t size;
+	uint32_t width;
+	uint32_t height;
+};
+
+struct ImageData
+{
+	std::vector<uint8_t> pixels; //Every mip level back to back, largest first
+	std::vector<ImageLevel> levels;
 	uint32_t height;
 	uint32_t width;
 	vk::Format format;
+	bool generateMips = false; //Levels after those in levels are blitted on the gpu at upload
 };
 
-using ImagePtr_t = std::shared_ptr<Image>;
-
 class ImageLoader
 {
 public:
-	static ImagePtr_t LoadTexture(GfxDevice& device, std::string const& filePath);
+	//Decodes, builds the mip chain and compresses without touching the device, safe to call from worker threads. Uncompressed textures leave their mips to the gpu.
+	//Compressed results are cached next to the source as KTX2 and reused while newer than the source
+	static ImageData DecodeTexture(std::string const& filePath, TextureCompression compression);
+	//Creates a sampled device local image and copies every level into it, blocks until the copy completes. Throws if the device can't sample the format
+	static GfxImage UploadTexture(GfxDevice& device, vk::CommandPool commandPool, ImageData const& imageData);
 };
-
@@ -1,5 +1,6 @@
 #include "InputManager.h"
 #include "Exceptions.h"
+#include "Clock.h"
 
 void ProcessButtonState(int glfwButtonAction, ButtonState& processedState) noexcept
 {
@@ -15,6 +16,8 @@ void ProcessButtonState(int glfwButtonAction, ButtonState& processedState) noexc
 
 void InputManager::HandleKeyEvent(int key, int action) noexcept
 {
+	std::scoped_lock lock(m_mutex);
+
 	//Just taking WASD keyboard input for now
 	switch (key)
 	{
@@ -48,7 +51,8 @@ void KeyEventCallback(GLFWwindow* pWindow, int key, int scancode, int action, in
 }
 
 InputManager::InputManager(Window const& window) noexcept
-	: inputState()
+	: m_mutex()
+	, inputState()
 {
 	//Is InputManager the only user data we need out of glfw?
 	glfwSetWindowUserPointer(window.Get(), this);
@@ -56,7 +60,17 @@ InputManager::InputManager(Window const& window) noexcept
 	glfwSetKeyCallback(window.Get(), KeyEventCallback);
 }
 
-ControllerInput const& InputManager::GetState() const noexcept
+ControllerInput InputManager::GetState() const
 {
+	std::scoped_lock lock(m_mutex);
 	return inputState;
 }
+
+void InputManager::PollEvents()
+{
+	//Key callbacks take the lock themselves
+	glfwPollEvents();
+
+	std::scoped_lock lock(m_mutex);
+	inputState.pollTime = Clock::GetSeconds();
+}
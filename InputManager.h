@@ -1,6 +1,8 @@
 #pragma once
 #include "Window.h"
 
+#include <mutex>
+
 struct ButtonState
 {
 	bool isPressed;
@@ -19,17 +21,23 @@ struct ControllerInput
 			ButtonState MoveRight;
 		};
 	};
+	double pollTime = 0.0; //Clock seconds when events were last polled, so how fresh the buttons are
 };
 
 class InputManager {
 public:
 	InputManager(Window const& window) noexcept;
 
-	ControllerInput const& GetState() const noexcept;
+	//Copied under a lock, key events arrive on the main thread while the simulation thread reads
+	ControllerInput GetState() const;
+
+	//Main thread. Polls glfw for events, which arrive through HandleKeyEvent, and stamps the state with the time
+	void PollEvents();
 
 	//Key and action values are based off of GLFW kley and action definitions
 	void HandleKeyEvent(int key, int action) noexcept;
 
 private:
+	mutable std::mutex m_mutex;
 	ControllerInput inputState;
 };
\ No newline at end of file
@@ -0,0 +1,234 @@
+#include "JobSystem.h"
+#include "Logger.h"
+#include "CpuProfiler.h"
+
+#include <algorithm>
+#include <utility>
+
+//Which queue the current thread owns, non worker threads share queue 0
+thread_local uint32_t t_queueIndex = 0;
+
+JobSystem::JobSystem(uint32_t workerCount)
+	: m_queues()
+	, m_workers()
+	, m_queuedCount(0)
+	, m_wakeMutex()
+	, m_wake()
+	, m_stopping(false)
+{
+	if (workerCount == 0)
+	{
+		//The thread waiting on jobs runs them too, so it takes the last core
+		workerCount = std::max(1u, std::thread::hardware_concurrency() - 1);
+	}
+
+	for (uint32_t i = 0; i <= workerCount; ++i)
+	{
+		m_queues.push_back(std::make_unique<WorkQueue>());
+	}
+
+	for (uint32_t i = 1; i <= workerCount; ++i)
+	{
+		m_workers.emplace_back(&JobSystem::WorkerLoop, this, i);
+	}
+	SPDLOG_INFO("Job system started with {} worker threads", workerCount);
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		std::scoped_lock lock(m_wakeMutex);
+		m_stopping = true;
+	}
+	m_wake.notify_all();
+
+	for (std::thread& worker : m_workers)
+	{
+		worker.join();
+	}
+}
+
+void JobSystem::Run(std::function<void()> job, JobCounter& counter)
+{
+	counter.m_pending.fetch_add(1, std::memory_order_relaxed);
+	Push(Job{ std::move(job), &counter });
+}
+
+void JobSystem::Run(std::function<void()> job, JobCounter& counter, JobCounter& dependency)
+{
+	counter.m_pending.fetch_add(1, std::memory_order_relaxed);
+	{
+		//Checked under the dependency's lock so a job finishing concurrently either sees this continuation or we see zero
+		std::scoped_lock lock(dependency.m_mutex);
+		if (!dependency.IsDone())
+		{
+			dependency.m_continuations.push_back(JobCounter::Continuation{ std::move(job), &counter });
+			return;
+		}
+	}
+	Push(Job{ std::move(job), &counter });
+}
+
+void JobSystem::Wait(JobCounter& counter)
+{
+	while (!counter.IsDone())
+	{
+		if (!TryRunJob())
+		{
+			std::this_thread::yield();
+		}
+	}
+
+	//The last job may still be inside Finish, holding the counter's lock
+	std::exception_ptr pException = nullptr;
+	{
+		std::scoped_lock lock(counter.m_mutex);
+		pException = std::exchange(counter.m_pException, nullptr);
+	}
+
+	if (pException)
+	{
+		std::rethrow_exception(pException);
+	}
+}
+
+void JobSystem::ParallelFor(size_t count, size_t grainSize, std::function<void(size_t begin, size_t end)> const& body)
+{
+	grainSize = std::max<size_t>(grainSize, 1);
+	if (count <= grainSize)
+	{
+		body(0, count);
+		return;
+	}
+
+	JobCounter counter;
+	for (size_t begin = grainSize; begin < count; begin += grainSize)
+	{
+		size_t const end = std::min(begin + grainSize, count);
+		Run([&body, begin, end]() { body(begin, end); }, counter);
+	}
+
+	//First range runs here while the workers pick up the rest. The other ranges reference body and counter, so wait on them before anything unwinds
+	try
+	{
+		body(0, grainSize);
+	}
+	catch (...)
+	{
+		Fail(counter, std::current_exception());
+	}
+	Wait(counter);
+}
+
+void JobSystem::Push(Job job)
+{
+	WorkQueue& queue = *m_queues[t_queueIndex];
+	{
+		std::scoped_lock lock(queue.mutex);
+		queue.jobs.push_back(std::move(job));
+	}
+
+	{
+		//Taken so a worker can't check the count and go to sleep between our increment and notify
+		std::scoped_lock lock(m_wakeMutex);
+		m_queuedCount.fetch_add(1, std::memory_order_release);
+	}
+	m_wake.notify_one();
+}
+
+bool JobSystem::TryRunJob()
+{
+	Job job;
+	bool found = false;
+
+	//Own queue newest first for cache warmth, then steal the oldest work from everyone else
+	{
+		WorkQueue& queue = *m_queues[t_queueIndex];
+		std::scoped_lock lock(queue.mutex);
+		if (!queue.jobs.empty())
+		{
+			job = std::move(queue.jobs.back());
+			queue.jobs.pop_back();
+			found = true;
+		}
+	}
+
+	for (size_t i = 1; !found && i < m_queues.size(); ++i)
+	{
+		WorkQueue& victim = *m_queues[(t_queueIndex + i) % m_queues.size()];
+		std::scoped_lock lock(victim.mutex);
+		if (!victim.jobs.empty())
+		{
+			job = std::move(victim.jobs.front());
+			victim.jobs.pop_front();
+			found = true;
+		}
+	}
+
+	if (!found)
+	{
+		return false;
+	}
+
+	m_queuedCount.fetch_sub(1, std::memory_order_relaxed);
+	try
+	{
+		PROFILE_ZONE("Job");
+		job.task();
+	}
+	catch (...)
+	{
+		//Handed to whoever waits on the counter, which still completes so waiters don't hang
+		Fail(*job.pCounter, std::current_exception());
+	}
+	Finish(*job.pCounter);
+	return true;
+}
+
+void JobSystem::Fail(JobCounter& counter, std::exception_ptr pException)
+{
+	std::scoped_lock lock(counter.m_mutex);
+	if (!counter.m_pException)
+	{
+		counter.m_pException = pException;
+	}
+}
+
+void JobSystem::Finish(JobCounter& counter)
+{
+	std::vector<JobCounter::Continuation> continuations;
+	{
+		//Decremented under the lock, Wait takes it too before returning so the counter outlives this scope
+		std::scoped_lock lock(counter.m_mutex);
+		if (counter.m_pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		{
+			continuations.swap(counter.m_continuations);
+		}
+	}
+
+	for (JobCounter::Continuation& continuation : continuations)
+	{
+		Push(Job{ std::move(continuation.job), continuation.pCounter });
+	}
+}
+
+void JobSystem::WorkerLoop(uint32_t queueIndex)
+{
+	t_queueIndex = queueIndex;
+	CpuProfiler::SetThreadName("JobWorker");
+
+	while (true)
+	{
+		if (TryRunJob())
+		{
+			continue;
+		}
+
+		std::unique_lock lock(m_wakeMutex);
+		m_wake.wait(lock, [this]() { return m_stopping || m_queuedCount.load(std::memory_order_acquire) > 0; });
+		if (m_stopping)
+		{
+			return;
+		}
+	}
+}
\ No newline at end of file
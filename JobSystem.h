@@ -0,0 +1,99 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class JobSystem;
+
+//Counts outstanding jobs. Jobs can be queued to start once a counter reaches zero, which is how dependencies are expressed
+class JobCounter
+{
+public:
+	JobCounter() : m_pending(0), m_mutex(), m_continuations(), m_pException(nullptr) {}
+
+	JobCounter(JobCounter const&) = delete;
+	JobCounter& operator=(JobCounter const&) = delete;
+
+	//Only a hint, use JobSystem::Wait before releasing a counter that jobs have used
+	bool IsDone() const noexcept { return m_pending.load(std::memory_order_acquire) == 0; }
+
+private:
+	friend class JobSystem;
+
+	struct Continuation
+	{
+		std::function<void()> job;
+		JobCounter* pCounter;
+	};
+
+	std::atomic<uint32_t> m_pending;
+	mutable std::mutex m_mutex;
+	std::vector<Continuation> m_continuations;
+	std::exception_ptr m_pException; //First exception thrown by a job on this counter, guarded by m_mutex
+};
+
+//Work stealing scheduler for short lived per frame tasks. Each worker pops its own queue from the back and steals from
+// the front of the others, threads that aren't workers push to a shared queue. Waiting threads run jobs instead of blocking.
+//Queues are small locked deques, contention only happens when a thief and the owner meet on the same queue
+class JobSystem
+{
+public:
+	JobSystem(uint32_t workerCount = 0);
+	~JobSystem();
+
+	JobSystem(JobSystem const&) = delete;
+	JobSystem(JobSystem&&) = delete;
+	JobSystem& operator=(JobSystem const&) = delete;
+	JobSystem& operator=(JobSystem&&) = delete;
+
+	//Counter is incremented straight away and decremented when the job finishes
+	void Run(std::function<void()> job, JobCounter& counter);
+	//As above, but the job isn't queued until dependency reaches zero
+	void Run(std::function<void()> job, JobCounter& counter, JobCounter& dependency);
+
+	//Runs other jobs on the calling thread until the counter reaches zero, then rethrows the first exception any of its jobs threw.
+	//Rethrowing clears it so the counter can be reused
+	void Wait(JobCounter& counter);
+
+	//Splits [0, count) into ranges of at most grainSize and returns once every range has run.
+	//Small counts run inline on the calling thread. Every range runs even if one throws, the first exception is rethrown afterwards
+	void ParallelFor(size_t count, size_t grainSize, std::function<void(size_t begin, size_t end)> const& body);
+
+	uint32_t GetWorkerCount() const noexcept { return uint32_t(m_workers.size()); }
+
+private:
+	struct Job
+	{
+		std::function<void()> task;
+		JobCounter* pCounter;
+	};
+
+	struct WorkQueue
+	{
+		std::mutex mutex;
+		std::deque<Job> jobs;
+	};
+
+	void Push(Job job);
+	bool TryRunJob();
+	static void Fail(JobCounter& counter, std::exception_ptr pException);
+	void Finish(JobCounter& counter);
+	void WorkerLoop(uint32_t queueIndex);
+
+	//Queue 0 is shared by every thread that isn't a worker
+	std::vector<std::unique_ptr<WorkQueue>> m_queues;
+	std::vector<std::thread> m_workers;
+
+	std::atomic<uint32_t> m_queuedCount;
+	std::mutex m_wakeMutex;
+	std::condition_variable m_wake;
+	bool m_stopping;
+};
+
+using JobSystemPtr_t = std::shared_ptr<JobSystem>;
\ No newline at end of file
@@ -0,0 +1,277 @@
+#include "KtxFile.h"
+#include "TextureCompressor.h"
+#include "Exceptions.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+constexpr uint8_t k_ktxIdentifier[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+
+struct KtxHeader
+{
+	uint8_t identifier[12];
+	uint32_t vkFormat;
+	uint32_t typeSize;
+	uint32_t pixelWidth;
+	uint32_t pixelHeight;
+	uint32_t pixelDepth;
+	uint32_t layerCount;
+	uint32_t faceCount;
+	uint32_t levelCount;
+	uint32_t supercompressionScheme;
+	uint32_t dfdByteOffset;
+	uint32_t dfdByteLength;
+	uint32_t kvdByteOffset;
+	uint32_t kvdByteLength;
+	uint64_t sgdByteOffset;
+	uint64_t sgdByteLength;
+};
+static_assert(sizeof(KtxHeader) == 80);
+
+struct KtxLevel
+{
+	uint64_t byteOffset;
+	uint64_t byteLength;
+	uint64_t uncompressedByteLength;
+};
+static_assert(sizeof(KtxLevel) == 24);
+
+//Khronos data format descriptor, basic block
+struct DfdSample
+{
+	uint16_t bitOffset;
+	uint8_t bitLength; //Stored as length - 1
+	uint8_t channelType; //Channel id in the low 4 bits, qualifiers in the high 4
+	uint8_t samplePosition[4];
+	uint32_t sampleLower;
+	uint32_t sampleUpper;
+};
+static_assert(sizeof(DfdSample) == 16);
+
+struct DfdBlockHeader
+{
+	uint32_t vendorAndType; //Khronos vendor and basic descriptor type are both 0
+	uint16_t versionNumber;
+	uint16_t descriptorBlockSize;
+	uint8_t colorModel;
+	uint8_t colorPrimaries;
+	uint8_t transferFunction;
+	uint8_t flags;
+	uint8_t texelBlockDimension[4];
+	uint8_t bytesPlane[8];
+};
+static_assert(sizeof(DfdBlockHeader) == 24);
+
+constexpr uint16_t k_dfdVersion = 2; //KDF 1.3
+constexpr uint8_t k_dfdModelRgbsda = 1;
+constexpr uint8_t k_dfdModelBC1A = 128;
+constexpr uint8_t k_dfdModelBC3 = 130;
+constexpr uint8_t k_dfdModelBC5 = 132;
+constexpr uint8_t k_dfdModelBC7 = 134;
+constexpr uint8_t k_dfdPrimariesBT709 = 1;
+constexpr uint8_t k_dfdTransferLinear = 1;
+constexpr uint8_t k_dfdTransferSrgb = 2;
+constexpr uint8_t k_dfdChannelAlpha = 15;
+constexpr uint8_t k_dfdQualifierLinear = 0x10;
+
+bool IsSrgb(vk::Format format)
+{
+	switch (format)
+	{
+	case vk::Format::eR8G8B8A8Srgb:
+	case vk::Format::eB8G8R8A8Srgb:
+	case vk::Format::eBc1RgbSrgbBlock:
+	case vk::Format::eBc1RgbaSrgbBlock:
+	case vk::Format::eBc2SrgbBlock:
+	case vk::Format::eBc3SrgbBlock:
+	case vk::Format::eBc7SrgbBlock:
+		return true;
+	default:
+		return false;
+	}
+}
+
+DfdSample MakeSample(uint16_t bitOffset, uint32_t bitLength, uint8_t channelType, uint32_t sampleUpper)
+{
+	return DfdSample{
+		.bitOffset = bitOffset,
+		.bitLength = uint8_t(bitLength - 1),
+		.channelType = channelType,
+		.samplePosition = { 0, 0, 0, 0 },
+		.sampleLower = 0,
+		.sampleUpper = sampleUpper
+	};
+}
+
+std::vector<uint8_t> BuildDataFormatDescriptor(vk::Format format)
+{
+	DfdBlockHeader header{};
+	header.versionNumber = k_dfdVersion;
+	header.colorPrimaries = k_dfdPrimariesBT709;
+	header.transferFunction = IsSrgb(format) ? k_dfdTransferSrgb : k_dfdTransferLinear;
+	header.bytesPlane[0] = uint8_t(TextureCompressor::GetBlockBytes(format));
+
+	//Alpha is never sRGB encoded
+	uint8_t const alphaChannel = k_dfdChannelAlpha | (IsSrgb(format) ? k_dfdQualifierLinear : 0);
+
+	std::vector<DfdSample> samples;
+	switch (format)
+	{
+	case vk::Format::eR8G8B8A8Unorm:
+	case vk::Format::eR8G8B8A8Srgb:
+		header.colorModel = k_dfdModelRgbsda;
+		samples.push_back(MakeSample(0, 8, 0, 255));
+		samples.push_back(MakeSample(8, 8, 1, 255));
+		samples.push_back(MakeSample(16, 8, 2, 255));
+		samples.push_back(MakeSample(24, 8, alphaChannel, 255));
+		break;
+	case vk::Format::eBc1RgbUnormBlock:
+	case vk::Format::eBc1RgbSrgbBlock:
+		header.colorModel = k_dfdModelBC1A;
+		samples.push_back(MakeSample(0, 64, 0, UINT32_MAX));
+		break;
+	case vk::Format::eBc3UnormBlock:
+	case vk::Format::eBc3SrgbBlock:
+		header.colorModel = k_dfdModelBC3;
+		samples.push_back(MakeSample(0, 64, alphaChannel, UINT32_MAX));
+		samples.push_back(MakeSample(64, 64, 0, UINT32_MAX));
+		break;
+	case vk::Format::eBc5UnormBlock:
+		header.colorModel = k_dfdModelBC5;
+		samples.push_back(MakeSample(0, 64, 0, UINT32_MAX));
+		samples.push_back(MakeSample(64, 64, 1, UINT32_MAX));
+		break;
+	case vk::Format::eBc7UnormBlock:
+	case vk::Format::eBc7SrgbBlock:
+		header.colorModel = k_dfdModelBC7;
+		samples.push_back(MakeSample(0, 128, 0, UINT32_MAX));
+		break;
+	default:
+		throw InvalidStateException("No KTX2 data format descriptor for format " + vk::to_string(format));
+	}
+
+	if (TextureCompressor::IsBlockCompressed(format))
+	{
+		header.texelBlockDimension[0] = 3; //Stored as dimension - 1
+		header.texelBlockDimension[1] = 3;
+	}
+	header.descriptorBlockSize = uint16_t(sizeof(DfdBlockHeader) + samples.size() * sizeof(DfdSample));
+
+	uint32_t const totalSize = sizeof(uint32_t) + header.descriptorBlockSize;
+	std::vector<uint8_t> descriptor(totalSize);
+	memcpy(descriptor.data(), &totalSize, sizeof(totalSize));
+	memcpy(descriptor.data() + sizeof(uint32_t), &header, sizeof(header));
+	memcpy(descriptor.data() + sizeof(uint32_t) + sizeof(header), samples.data(), samples.size() * sizeof(DfdSample));
+	return descriptor;
+}
+
+size_t AlignUp(size_t value, size_t alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+void KtxFile::Write(std::string const& filePath, ImageData const& image)
+{
+	std::vector<uint8_t> const descriptor = BuildDataFormatDescriptor(image.format);
+	uint32_t const levelCount = uint32_t(image.levels.size());
+
+	KtxHeader header{};
+	memcpy(header.identifier, k_ktxIdentifier, sizeof(k_ktxIdentifier));
+	header.vkFormat = uint32_t(image.format);
+	header.typeSize = 1;
+	header.pixelWidth = image.width;
+	header.pixelHeight = image.height;
+	header.faceCount = 1;
+	header.levelCount = levelCount;
+	header.dfdByteOffset = uint32_t(sizeof(KtxHeader) + levelCount * sizeof(KtxLevel));
+	header.dfdByteLength = uint32_t(descriptor.size());
+
+	//Levels are stored smallest first, each aligned to lcm(block size, 4) which is the block size for all formats used here
+	size_t const alignment = std::max<size_t>(TextureCompressor::GetBlockBytes(image.format), 4);
+	std::vector<KtxLevel> levelIndex(levelCount);
+	size_t writeOffset = header.dfdByteOffset + header.dfdByteLength;
+	for (uint32_t i = levelCount; i-- > 0;)
+	{
+		writeOffset = AlignUp(writeOffset, alignment);
+		levelIndex[i] = KtxLevel{ .byteOffset = writeOffset, .byteLength = image.levels[i].size, .uncompressedByteLength = image.levels[i].size };
+		writeOffset += image.levels[i].size;
+	}
+
+	std::vector<uint8_t> file(writeOffset);
+	memcpy(file.data(), &header, sizeof(header));
+	memcpy(file.data() + sizeof(header), levelIndex.data(), levelIndex.size() * sizeof(KtxLevel));
+	memcpy(file.data() + header.dfdByteOffset, descriptor.data(), descriptor.size());
+	for (uint32_t i = 0; i < levelCount; ++i)
+	{
+		memcpy(file.data() + levelIndex[i].byteOffset, image.pixels.data() + image.levels[i].offset, image.levels[i].size);
+	}
+
+	std::ofstream stream(filePath, std::ios::binary | std::ios::trunc);
+	if (!stream.is_open())
+	{
+		throw InvalidStateException("Failed to open KTX2 file for writing at: " + filePath);
+	}
+	stream.write((char const*)file.data(), file.size());
+}
+
+bool KtxFile::Read(std::string const& filePath, ImageData& image)
+{
+	std::ifstream stream(filePath, std::ios::ate | std::ios::binary);
+	if (!stream.is_open())
+	{
+		return false;
+	}
+
+	size_t const fileSize = (size_t)stream.tellg();
+	std::vector<uint8_t> file(fileSize);
+	stream.seekg(0);
+	stream.read((char*)file.data(), fileSize);
+
+	KtxHeader header;
+	if (fileSize < sizeof(header))
+	{
+		throw InvalidStateException("KTX2 file is truncated: " + filePath);
+	}
+	memcpy(&header, file.data(), sizeof(header));
+
+	if (memcmp(header.identifier, k_ktxIdentifier, sizeof(k_ktxIdentifier)) != 0)
+	{
+		throw InvalidStateException("Not a KTX2 file: " + filePath);
+	}
+
+	if (header.supercompressionScheme != 0 || header.pixelDepth != 0 || header.layerCount > 1 || header.faceCount != 1 || header.levelCount == 0)
+	{
+		throw InvalidStateException("Only uncompressed single layer 2D KTX2 files are supported: " + filePath);
+	}
+
+	if (sizeof(header) + size_t(header.levelCount) * sizeof(KtxLevel) > fileSize)
+	{
+		throw InvalidStateException("KTX2 level index is truncated: " + filePath);
+	}
+
+	std::vector<KtxLevel> levelIndex(header.levelCount);
+	memcpy(levelIndex.data(), file.data() + sizeof(header), levelIndex.size() * sizeof(KtxLevel));
+
+	image.format = vk::Format(header.vkFormat);
+	image.width = header.pixelWidth;
+	image.height = header.pixelHeight;
+	image.levels.clear();
+	image.pixels.clear();
+
+	for (uint32_t i = 0; i < header.levelCount; ++i)
+	{
+		uint32_t const width = std::max(1u, header.pixelWidth >> i);
+		uint32_t const height = std::max(1u, header.pixelHeight >> i);
+		KtxLevel const& level = levelIndex[i];
+		if (level.byteLength != TextureCompressor::GetLevelSize(image.format, width, height) || level.byteOffset + level.byteLength > fileSize)
+		{
+			throw InvalidStateException("KTX2 level " + std::to_string(i) + " has an unexpected size: " + filePath);
+		}
+
+		image.levels.push_back(ImageLevel{ .offset = image.pixels.size(), .size = size_t(level.byteLength), .width = width, .height = height });
+		image.pixels.insert(image.pixels.end(), file.begin() + level.byteOffset, file.begin() + level.byteOffset + level.byteLength);
+	}
+
+	return true;
+}
\ No newline at end of file
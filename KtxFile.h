@@ -0,0 +1,12 @@
+#pragma once
+#include <string>
+#include "ImageLoader.h"
+
+//Minimal KTX2 container support for 2D textures with a mip chain, no supercompression or key value data
+class KtxFile
+{
+public:
+	static void Write(std::string const& filePath, ImageData const& image);
+	//Returns false if there is no file at filePath, throws if the file can't be used
+	static bool Read(std::string const& filePath, ImageData& image);
+};
\ No newline at end of file
@@ -5,6 +5,7 @@
 #include <glm/vec4.hpp>
 #include <glm/mat4x4.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
 
 
 constexpr glm::vec3 BASE_FORWARD = glm::vec3(0.0f, 0.0f, 1.0f);
@@ -31,22 +31,61 @@ struct Vertex
 	}
 };
 
-struct TextVertex
+//Dequantization for PackedVertex positions, position = offset + unorm * scale
+//Pushed as a vertex stage push constant per draw
+struct VertexQuantization
 {
-	float vx, vy;
-	float u, v;
+	float offset[4];
+	float scale[4];
+};
+
+//Half size alternative to Vertex, decoded in the vertex shader
+struct PackedVertex
+{
+	uint16_t px, py, pz, pw; //Unorm16 position relative to the mesh bounds
+	uint16_t nx, ny; //Snorm16 octahedral encoded normal
+	uint16_t u, v; //Half float texture coordinates
+
+	static VertexDescription GetDescription()
+	{
+		std::vector < vk::VertexInputBindingDescription> bindings =
+		{
+			vk::VertexInputBindingDescription(0, sizeof(PackedVertex)) //4 * 2 + 2 * 2 + 2 * 2 = 16 bytes
+		};
+
+		std::vector<vk::VertexInputAttributeDescription> attributes =
+		{
+			vk::VertexInputAttributeDescription(0 /*location*/, 0 /*binding*/, vk::Format::eR16G16B16A16Unorm, 0/*offset*/),
+			vk::VertexInputAttributeDescription(1, 0, vk::Format::eR16G16Snorm, 4 * sizeof(uint16_t)),
+			vk::VertexInputAttributeDescription(2, 0, vk::Format::eR16G16Sfloat, 6 * sizeof(uint16_t))
+		};
+
+		return VertexDescription{
+			.attributes = attributes,
+			.bindings = bindings
+		};
+	}
+};
+
+//One quad of the text overlay, read per instance and expanded to its four corners in text.vert
+struct TextGlyph
+{
+	float x0, y0, x1, y1; //Corners in normalized device coordinates
+	float u0, v0, u1, v1; //Negative for solid quads that don't sample the font
+	uint32_t color; //RGBA8
 
 	static VertexDescription GetDescription()
 	{
 		std::vector < vk::VertexInputBindingDescription> bindings =
 		{
-			vk::VertexInputBindingDescription(0, sizeof(TextVertex)) // 4 floats = 16 bytes
+			vk::VertexInputBindingDescription(0, sizeof(TextGlyph), vk::VertexInputRate::eInstance) // 8 floats and a packed color = 36 bytes
 		};
 
 		std::vector<vk::VertexInputAttributeDescription> attributes =
 		{
-			vk::VertexInputAttributeDescription(0 /*location*/, 0 /*binding*/, vk::Format::eR32G32Sfloat, 0/*offset*/), //Position
-			vk::VertexInputAttributeDescription(1, 0, vk::Format::eR32G32Sfloat, 8 /*2 floats from position*/)			// UV
+			vk::VertexInputAttributeDescription(0 /*location*/, 0 /*binding*/, vk::Format::eR32G32B32A32Sfloat, 0/*offset*/), //Rect
+			vk::VertexInputAttributeDescription(1, 0, vk::Format::eR32G32B32A32Sfloat, 16 /*4 floats from rect*/),		// UV rect
+			vk::VertexInputAttributeDescription(2, 0, vk::Format::eR8G8B8A8Unorm, 32 /*4 floats from uv rect*/)		// Color
 		};
 
 		return VertexDescription{
@@ -57,13 +96,52 @@ struct TextVertex
 };
 
 
+//Cluster of up to k_meshletMaxTriangles triangles referencing up to k_meshletMaxVertices vertices
+struct Meshlet
+{
+	uint32_t vertexOffset; //Into Mesh::meshletVertices
+	uint32_t triangleOffset; //Into Mesh::meshletTriangles
+	uint32_t vertexCount;
+	uint32_t triangleCount;
+
+	//Bounding sphere and normal cone in model space, for per cluster culling
+	float center[3];
+	float radius;
+	float coneApex[3];
+	float coneAxis[3];
+	float coneCutoff;
+};
+
+//Range of the index buffer drawn at a level of detail, lod 0 is full detail
+struct MeshLod
+{
+	uint32_t indexOffset;
+	uint32_t indexCount;
+	float error; //Largest model space deviation from full detail
+};
+
+struct MeshStatistics
+{
+	float acmr; //Average cache miss ratio, transformed vertices per triangle. 0.5 is ideal, 3.0 is worst case
+	float atvr; //Average transformed vertex ratio, transformed vertices per vertex. 1.0 is ideal
+	float overdraw; //Pixels shaded per pixel covered
+	float overfetch; //Vertex bytes fetched per vertex buffer byte
+};
+
 struct Mesh
 {
 	GfxBuffer vertexBuffer;
 	GfxBuffer indexBuffer;
-};
-using MeshPtr_t = std::shared_ptr<Mesh>;
 
+	//Index ranges ordered from full to least detail, all sharing the vertex buffer
+	std::vector<MeshLod> lods;
 
-using MeshPool = std::unordered_map<std::string, MeshPtr_t>;
-using MeshPoolPtr_t = std::shared_ptr<MeshPool>;
\ No newline at end of file
+	//Meshlets cover lod 0 only. Meshlet vertices index into the vertex buffer, meshlet triangles are 3 local indices into meshlet vertices
+	std::vector<Meshlet> meshlets;
+	std::vector<uint32_t> meshletVertices;
+	std::vector<uint8_t> meshletTriangles;
+
+	MeshStatistics statistics;
+	VertexQuantization quantization;
+};
+using MeshPtr_t = std::shared_ptr<Mesh>;
\ No newline at end of file
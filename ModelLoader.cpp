@@ -6,11 +6,161 @@
 
 #include "GfxDevice.h"
 #include "GfxBuffer.h"
+#include "Logger.h"
+#include "VertexPacker.h"
+#include "CpuProfiler.h"
 
-MeshPtr_t ModelLoader::LoadModel(GfxDevicePtr_t const pDevice, std::string const& filePath)
+#include <algorithm>
+#include <span>
+
+constexpr size_t k_meshletMaxVertices = 64;
+constexpr size_t k_meshletMaxTriangles = 124; //Multiple of 4 keeps meshlet triangle data aligned
+constexpr float k_meshletConeWeight = 0.25f; //Trade off between spatial locality and normal cone culling efficiency
+constexpr float k_overdrawThreshold = 1.05f; //Allow overdraw optimization to make vertex cache up to 5% worse
+constexpr uint32_t k_vertexCacheSize = 16;
+constexpr float k_maxPackedNormalErrorDegrees = 0.1f;
+constexpr uint32_t k_maxLods = 8;
+constexpr float k_lodReduction = 0.5f; //Each lod targets half the triangles of the previous one
+constexpr float k_lodMinReduction = 0.9f; //Stop once simplification can't remove at least 10% more triangles
+constexpr size_t k_lodMinTriangles = 16;
+
+MeshStatistics AnalyzeMesh(std::vector<Vertex> const& vertices, std::span<uint32_t const> indices)
 {
+	meshopt_VertexCacheStatistics const cacheStats = meshopt_analyzeVertexCache(indices.data(), indices.size(), vertices.size(), k_vertexCacheSize, 0 /*warp size*/, 0 /*primitive group size*/);
+	meshopt_OverdrawStatistics const overdrawStats = meshopt_analyzeOverdraw(indices.data(), indices.size(), &vertices[0].vx, vertices.size(), sizeof(Vertex));
+	meshopt_VertexFetchStatistics const fetchStats = meshopt_analyzeVertexFetch(indices.data(), indices.size(), vertices.size(), sizeof(Vertex));
+
+	return MeshStatistics{
+		.acmr = cacheStats.acmr,
+		.atvr = cacheStats.atvr,
+		.overdraw = overdrawStats.overdraw,
+		.overfetch = fetchStats.overfetch
+	};
+}
+
+//Reorders triangles for the post transform cache then for overdraw
+void OptimizeTriangleOrder(std::vector<Vertex> const& vertices, std::vector<uint32_t>& indices)
+{
+	meshopt_optimizeVertexCache(indices.data(), indices.data(), indices.size(), vertices.size());
+	meshopt_optimizeOverdraw(indices.data(), indices.data(), indices.size(), &vertices[0].vx, vertices.size(), sizeof(Vertex), k_overdrawThreshold);
+}
+
+//Reorders vertices into first use order for fetch locality, indices of all lods share the vertex buffer so are remapped together
+void OptimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+	size_t const usedVertices = meshopt_optimizeVertexFetch(vertices.data(), indices.data(), indices.size(), vertices.data(), vertices.size(), sizeof(Vertex));
+	vertices.resize(usedVertices);
+}
+
+//Simplifies the full detail triangles in indices into a chain of lods, appending each lod's triangles to indices
+std::vector<MeshLod> BuildLods(std::vector<Vertex> const& vertices, std::vector<uint32_t>& indices)
+{
+	std::vector<MeshLod> lods;
+	lods.push_back(MeshLod{ .indexOffset = 0, .indexCount = static_cast<uint32_t>(indices.size()), .error = 0.0f });
+
+	std::vector<uint32_t> const fullDetail = indices;
+	//Simplifier error is relative to the mesh extents, scale it back to model space
+	float const errorScale = meshopt_simplifyScale(&vertices[0].vx, vertices.size(), sizeof(Vertex));
+
+	std::vector<uint32_t> lodIndices(fullDetail.size());
+	while (lods.size() < k_maxLods)
+	{
+		MeshLod const& previous = lods.back();
+		size_t const targetIndexCount = static_cast<size_t>(previous.indexCount * k_lodReduction) / 3 * 3;
+		if (targetIndexCount < k_lodMinTriangles * 3)
+		{
+			break;
+		}
+
+		//Always simplify from full detail so errors don't accumulate down the chain
+		float lodError = 0.0f;
+		size_t const lodIndexCount = meshopt_simplify(
+			lodIndices.data(),
+			fullDetail.data(),
+			fullDetail.size(),
+			&vertices[0].vx,
+			vertices.size(),
+			sizeof(Vertex),
+			targetIndexCount,
+			1.0f /*target error, unbounded so the triangle count decides*/,
+			0 /*options*/,
+			&lodError);
+
+		if (lodIndexCount == 0 || lodIndexCount > previous.indexCount * k_lodMinReduction)
+		{
+			break;
+		}
+
+		std::span<uint32_t> const simplified(lodIndices.data(), lodIndexCount);
+		meshopt_optimizeVertexCache(simplified.data(), simplified.data(), simplified.size(), vertices.size());
+
+		lods.push_back(MeshLod{
+			.indexOffset = static_cast<uint32_t>(indices.size()),
+			.indexCount = static_cast<uint32_t>(lodIndexCount),
+			.error = std::max(lodError * errorScale, previous.error)
+		});
+		indices.insert(indices.end(), simplified.begin(), simplified.end());
+	}
+
+	return lods;
+}
+
+void BuildMeshlets(Mesh& mesh, std::vector<Vertex> const& vertices, std::span<uint32_t const> indices)
+{
+	size_t const maxMeshlets = meshopt_buildMeshletsBound(indices.size(), k_meshletMaxVertices, k_meshletMaxTriangles);
+	std::vector<meshopt_Meshlet> meshlets(maxMeshlets);
+	mesh.meshletVertices.resize(maxMeshlets * k_meshletMaxVertices);
+	mesh.meshletTriangles.resize(maxMeshlets * k_meshletMaxTriangles * 3);
+
+	size_t const meshletCount = meshopt_buildMeshlets(
+		meshlets.data(),
+		mesh.meshletVertices.data(),
+		mesh.meshletTriangles.data(),
+		indices.data(),
+		indices.size(),
+		&vertices[0].vx,
+		vertices.size(),
+		sizeof(Vertex),
+		k_meshletMaxVertices,
+		k_meshletMaxTriangles,
+		k_meshletConeWeight);
+
+	//Trim to what was actually written, triangle data of each meshlet is padded to 4 bytes
+	meshopt_Meshlet const& last = meshlets.at(meshletCount - 1);
+	mesh.meshletVertices.resize(last.vertex_offset + last.vertex_count);
+	mesh.meshletTriangles.resize(last.triangle_offset + ((last.triangle_count * 3 + 3) & ~3));
+
+	mesh.meshlets.reserve(meshletCount);
+	for (size_t i = 0; i < meshletCount; ++i)
+	{
+		meshopt_Meshlet const& meshlet = meshlets[i];
+		meshopt_Bounds const bounds = meshopt_computeMeshletBounds(
+			&mesh.meshletVertices[meshlet.vertex_offset],
+			&mesh.meshletTriangles[meshlet.triangle_offset],
+			meshlet.triangle_count,
+			&vertices[0].vx,
+			vertices.size(),
+			sizeof(Vertex));
+
+		mesh.meshlets.push_back(Meshlet{
+			.vertexOffset = meshlet.vertex_offset,
+			.triangleOffset = meshlet.triangle_offset,
+			.vertexCount = meshlet.vertex_count,
+			.triangleCount = meshlet.triangle_count,
+			.center = { bounds.center[0], bounds.center[1], bounds.center[2] },
+			.radius = bounds.radius,
+			.coneApex = { bounds.cone_apex[0], bounds.cone_apex[1], bounds.cone_apex[2] },
+			.coneAxis = { bounds.cone_axis[0], bounds.cone_axis[1], bounds.cone_axis[2] },
+			.coneCutoff = bounds.cone_cutoff
+		});
+	}
+}
+
+MeshData ModelLoader::ParseModel(std::string const& filePath, uint32_t parseThreadCount)
+{
+	PROFILE_ZONE("ModelLoader::ParseModel");
 	ObjFile parsedObj;
-	if (!objParseFile(parsedObj, filePath.c_str()))
+	if (!objParseFileParallel(parsedObj, filePath.c_str(), parseThreadCount))
 	{
 		throw InvalidStateException("File not found: " + filePath);
 	}
@@ -49,12 +199,66 @@ MeshPtr_t ModelLoader::LoadModel(GfxDevicePtr_t const pDevice, std::string const
 	meshopt_remapVertexBuffer(remappedVertices.data(), vertices.data(), indexCount, sizeof(Vertex), remap.data());
 	meshopt_remapIndexBuffer(indices.data(), nullptr, indexCount, remap.data());
 
+	if (indices.empty())
+	{
+		throw InvalidStateException("Model has no faces: " + filePath);
+	}
+
+	MeshStatistics const importStatistics = AnalyzeMesh(remappedVertices, indices);
+	OptimizeTriangleOrder(remappedVertices, indices);
+
 	MeshPtr_t pMesh = std::make_shared<Mesh>();
-	pMesh->vertexBuffer = pDevice->CreateBuffer(remappedVertices.size() * sizeof(Vertex), vk::BufferUsageFlagBits::eVertexBuffer);
-	pMesh->indexBuffer = pDevice->CreateBuffer(indices.size() * sizeof(uint32_t), vk::BufferUsageFlagBits::eIndexBuffer);
+	pMesh->lods = BuildLods(remappedVertices, indices);
+	OptimizeVertexFetch(remappedVertices, indices);
 
-	memcpy(pMesh->vertexBuffer.m_pData, remappedVertices.data(), pMesh->vertexBuffer.m_dataSize);
-	memcpy(pMesh->indexBuffer.m_pData, indices.data(), pMesh->indexBuffer.m_dataSize);
+	std::span<uint32_t const> const fullDetailIndices(indices.data(), pMesh->lods.front().indexCount);
+	pMesh->statistics = AnalyzeMesh(remappedVertices, fullDetailIndices);
+	BuildMeshlets(*pMesh, remappedVertices, fullDetailIndices);
+
+	SPDLOG_INFO("Optimized {}: {} vertices, {} triangles, {} meshlets. ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f}, overdraw {:.3f} -> {:.3f}, overfetch {:.3f} -> {:.3f}",
+		filePath,
+		remappedVertices.size(),
+		fullDetailIndices.size() / 3,
+		pMesh->meshlets.size(),
+		importStatistics.acmr, pMesh->statistics.acmr,
+		importStatistics.atvr, pMesh->statistics.atvr,
+		importStatistics.overdraw, pMesh->statistics.overdraw,
+		importStatistics.overfetch, pMesh->statistics.overfetch);
+
+	for (size_t i = 0; i < pMesh->lods.size(); ++i)
+	{
+		SPDLOG_INFO("{} lod {}: {} triangles, error {}", filePath, i, pMesh->lods[i].indexCount / 3, pMesh->lods[i].error);
+	}
+
+	//Pack vertices last, everything above works on full precision
+	pMesh->quantization = VertexPacker::ComputeQuantization(remappedVertices);
+	std::vector<PackedVertex> packedVertices = VertexPacker::Pack(remappedVertices, pMesh->quantization);
+
+	//Quantization step is extent / 65535, so decoded positions should be within half of that
+	VertexPackingError const packingError = VertexPacker::MeasureError(remappedVertices, packedVertices, pMesh->quantization);
+	float const maxExtent = std::max({ pMesh->quantization.scale[0], pMesh->quantization.scale[1], pMesh->quantization.scale[2] });
+	float const maxPositionError = maxExtent / 65535.0f;
+	SPDLOG_DEBUG("Packed {} vertex error: position {}, normal {} degrees, uv {}", filePath, packingError.position, packingError.normalDegrees, packingError.uv);
+	if (packingError.position > maxPositionError || packingError.normalDegrees > k_maxPackedNormalErrorDegrees)
+	{
+		SPDLOG_WARN("Packed vertices of {} exceed expected error: position {} (max {}), normal {} degrees (max {})",
+			filePath, packingError.position, maxPositionError, packingError.normalDegrees, k_maxPackedNormalErrorDegrees);
+	}
+
+	return MeshData{
+		.pMesh = pMesh,
+		.vertices = std::move(packedVertices),
+		.indices = std::move(indices)
+	};
+}
+
+void ModelLoader::UploadModel(GfxDevice& device, MeshData const& meshData)
+{
+	PROFILE_ZONE("ModelLoader::UploadModel");
+	Mesh& mesh = *meshData.pMesh;
+	mesh.vertexBuffer = device.CreateBuffer(meshData.vertices.size() * sizeof(PackedVertex), vk::BufferUsageFlagBits::eVertexBuffer);
+	mesh.indexBuffer = device.CreateBuffer(meshData.indices.size() * sizeof(uint32_t), vk::BufferUsageFlagBits::eIndexBuffer);
 
-	return pMesh;
+	memcpy(mesh.vertexBuffer.m_pData, meshData.vertices.data(), mesh.vertexBuffer.m_dataSize);
+	memcpy(mesh.indexBuffer.m_pData, meshData.indices.data(), mesh.indexBuffer.m_dataSize);
 }
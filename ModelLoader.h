@@ -2,7 +2,19 @@
 #include "Mesh.h"
 #include <string>
 
+//Cpu side result of loading a model, the mesh has everything but its gpu buffers filled in
+struct MeshData
+{
+	MeshPtr_t pMesh;
+	std::vector<PackedVertex> vertices;
+	std::vector<uint32_t> indices;
+};
+
 class ModelLoader {
 public:
-	static MeshPtr_t LoadModel(GfxDevicePtr_t const pDevice, std::string const& filePath);
+	//Parses and optimizes without touching the device, safe to call from worker threads. parseThreadCount of 0 splits
+	// large files across every hardware thread, callers that already run loads in parallel should pass 1
+	static MeshData ParseModel(std::string const& filePath, uint32_t parseThreadCount = 0);
+	//Creates the mesh's vertex and index buffers from the parsed data
+	static void UploadModel(GfxDevice& device, MeshData const& meshData);
 };
\ No newline at end of file
@@ -2,26 +2,59 @@
 #include "Camera.h"
 #include "Logger.h"
 #include "InputManager.h"
-#include "StaticModel.h"
+#include "TransformSimd.h"
+#include "Clock.h"
+#include "CpuProfiler.h"
 
-ObjectProcessor::ObjectProcessor(std::shared_ptr<InputManager> pInputManager)
+#include <array>
+
+//Transforms per job, a multiple of the rotation pattern length so every range starts on pattern index 0
+constexpr size_t k_transformsPerJob = 1024;
+static_assert(k_transformsPerJob % 8 == 0);
+
+ObjectProcessor::ObjectProcessor(std::shared_ptr<InputManager> pInputManager, JobSystemPtr_t pJobSystem)
 	: m_pInputManager(pInputManager)
+	, m_pCameraPath(nullptr)
+	, m_pJobSystem(pJobSystem)
 	, m_pCamera(nullptr) //TODO how do we get camera to here?
-	, m_meshTransforms()
+	, m_previousCamera(1, 1)
+	, m_transforms()
+	, m_simulationStep(0)
+	, m_simulationSeconds(0.0)
+	, m_inputTime(0.0)
+	, m_snapshots()
+	, m_snapshotMutex()
+	, m_snapshotAcquired()
+	, m_previousSnapshotAcquired(true)
+	, m_stopPublishing(false)
 {
-	m_meshTransforms.reserve(k_maxModelTransforms);
 }
 
 void ObjectProcessor::SetCamera(std::shared_ptr<Camera> const& pCamera)
 {
 	m_pCamera = pCamera;
+	m_previousCamera = *pCamera;
 }
 
-ObjectData& ObjectProcessor::AddStaticMesh(ObjectData transform)
+void ObjectProcessor::SetCameraPath(CameraPathPtr_t pPath)
 {
-	m_meshTransforms.push_back(std::move(transform));
+	m_pCameraPath = pPath;
+	if (m_pCamera && m_pCameraPath)
+	{
+		CameraKey const key = m_pCameraPath->Sample(m_simulationSeconds);
+		m_pCamera->LookAt(key.position, key.target);
+		m_previousCamera = *m_pCamera;
+	}
+}
 
-	return m_meshTransforms.back();
+TransformHandle ObjectProcessor::AddStaticMesh()
+{
+	return m_transforms.Add(glm::vec3(0.0f), glm::identity<glm::quat>(), glm::vec3(1.0f));
+}
+
+void ObjectProcessor::RemoveStaticMesh(TransformHandle handle)
+{
+	m_transforms.Remove(handle);
 }
 
 //TODO this is pretty much just running through all first 8 3-bit permutations
@@ -39,26 +72,101 @@ std::vector<glm::vec3> const k_rotationPermutations = {
 
 void ObjectProcessor::ProcessObjects(float deltaTime)
 {
-	for (size_t i = 0; i < m_meshTransforms.size(); ++i)
+	PROFILE_ZONE("ObjectProcessor::ProcessObjects");
+	// Each mesh rotates based on it's index, the rotation for this frame is the same for every mesh sharing an axis
+	constexpr float k_rotationDegreesPerSecond = 30.0f;
+	std::array<glm::quat, 8> frameRotations;
+	for (size_t i = 0; i < frameRotations.size(); ++i)
 	{
-		glm::mat4& transform = m_meshTransforms.at(i).transform;
+		//Index zero would be rotating around a zero-axis, so it stays put
+		frameRotations[i] = i == 0
+			? glm::identity<glm::quat>()
+			: glm::angleAxis(glm::radians(k_rotationDegreesPerSecond * deltaTime), glm::normalize(k_rotationPermutations[i]));
+	}
+
+	m_pJobSystem->ParallelFor(m_transforms.Size(), k_transformsPerJob, [this, &frameRotations](size_t begin, size_t end)
+	{
+		m_transforms.BeginStep(begin, end);
+		TransformSimd::ComposeRotations(m_transforms.GetRotations().subspan(begin, end - begin), frameRotations);
+		for (size_t i = begin; i < end; ++i)
+		{
+			if (i % frameRotations.size() != 0)
+			{
+				m_transforms.MarkDirty(uint32_t(i));
+			}
+		}
 
-		// Each mesh rotates based on it's index
-		constexpr float k_rotationDegreesPerSecond = 30.0f;
-		size_t index = i % k_rotationPermutations.size();
-		if (index != 0) { //special case where we do not rotate, otherwise would be rotating by zero-axis
-			transform = glm::rotate(transform, glm::radians(k_rotationDegreesPerSecond * deltaTime), k_rotationPermutations.at(i % k_rotationPermutations.size()));
+		m_transforms.UpdateWorldMatrices(begin, end);
+	});
+
+	m_simulationSeconds += deltaTime;
+	if (m_pCamera)
+	{
+		m_previousCamera = *m_pCamera;
+		//Headless runs have no input, the camera stays where the scene put it unless it follows a path
+		if (m_pCameraPath)
+		{
+			CameraKey const key = m_pCameraPath->Sample(m_simulationSeconds);
+			m_pCamera->LookAt(key.position, key.target);
+			//The path stands in for input sampled as the step runs
+			m_inputTime = m_pInputManager ? Clock::GetSeconds() : 0.0;
+		}
+		else if (m_pInputManager)
+		{
+			ControllerInput const input = m_pInputManager->GetState();
+			m_pCamera->Process(input, deltaTime);
+			m_inputTime = input.pollTime;
 		}
 	}
 
-	if (m_pInputManager)
+	m_simulationStep++;
+}
+
+void ObjectProcessor::PublishSnapshot(double stepSeconds, double alpha)
+{
+	{
+		std::unique_lock lock(m_snapshotMutex);
+		m_snapshotAcquired.wait(lock, [this]() { return m_previousSnapshotAcquired || m_stopPublishing; });
+		m_previousSnapshotAcquired = false;
+	}
+
+	SceneSnapshot& snapshot = m_snapshots.GetWriteBuffer();
+	m_transforms.CopyTo(snapshot);
+	if (m_pCamera)
+	{
+		snapshot.previousCamera = m_previousCamera;
+		snapshot.camera = *m_pCamera;
+	}
+	snapshot.simulationStep = m_simulationStep;
+	snapshot.stepSeconds = stepSeconds;
+	snapshot.alpha = alpha;
+	snapshot.publishTime = Clock::GetSeconds();
+	snapshot.inputTime = m_inputTime;
+
+	m_snapshots.Publish();
+}
+
+SceneSnapshot const& ObjectProcessor::AcquireSnapshot()
+{
+	if (m_snapshots.Acquire())
 	{
-		if (m_pCamera) m_pCamera->Process(m_pInputManager->GetState(), deltaTime);
+		{
+			std::scoped_lock lock(m_snapshotMutex);
+			m_previousSnapshotAcquired = true;
+		}
+		m_snapshotAcquired.notify_one();
 	}
-	else
+
+	return m_snapshots.GetReadBuffer();
+}
+
+void ObjectProcessor::StopPublishing()
+{
 	{
-		SPDLOG_WARN("No InputManager available while processing objects");
+		std::scoped_lock lock(m_snapshotMutex);
+		m_stopPublishing = true;
 	}
+	m_snapshotAcquired.notify_one();
 }
 
 //TODO how do we want to handle object destruction?
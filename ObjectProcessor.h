@@ -1,24 +1,57 @@
 #pragma once
 #include <vector>
 #include <memory>
+#include "TransformStore.h"
+#include "JobSystem.h"
+#include "SceneSnapshot.h"
+#include "TripleBuffer.h"
+#include "CameraPath.h"
 
-struct ObjectData;
+#include <condition_variable>
+#include <mutex>
 
 class Camera;
 class InputManager;
 
 class ObjectProcessor {
 public:
-	ObjectProcessor(std::shared_ptr<InputManager> pInputManager);
+	ObjectProcessor(std::shared_ptr<InputManager> pInputManager, JobSystemPtr_t pJobSystem);
 	void SetCamera(std::shared_ptr<Camera> const& pCamera);
-	ObjectData& AddStaticMesh(ObjectData transform);
+	//Moves the camera along pPath by simulated time in place of input, only call before the simulation thread starts
+	void SetCameraPath(CameraPathPtr_t pPath);
+	TransformHandle AddStaticMesh();
+	void RemoveStaticMesh(TransformHandle handle);
 	~ObjectProcessor();
 
 	void ProcessObjects(float deltaTime);
+
+	//Simulation thread. Copies transforms and camera into a snapshot for the renderer, first waiting until the renderer
+	// has picked up the previous one so the simulation runs at most one frame ahead.
+	//alpha is the fraction of a step of real time not yet simulated, the renderer interpolates on from there
+	void PublishSnapshot(double stepSeconds, double alpha);
+	//Render thread. Latest published snapshot, valid until the next call
+	SceneSnapshot const& AcquireSnapshot();
+	//Releases a simulation thread blocked in PublishSnapshot so it can be joined
+	void StopPublishing();
+
+	//Owned by the simulation, only touch from other threads while the simulation isn't running
+	TransformStore& GetTransforms() noexcept { return m_transforms; }
 private:
 	std::shared_ptr<Camera> m_pCamera;
-	std::vector<ObjectData> m_meshTransforms;
+	Camera m_previousCamera; //Before the latest step
+	TransformStore m_transforms;
 	std::shared_ptr<InputManager> m_pInputManager;
+	CameraPathPtr_t m_pCameraPath;
+	JobSystemPtr_t m_pJobSystem;
+	uint64_t m_simulationStep;
+	double m_simulationSeconds;
+	double m_inputTime; //See SceneSnapshot::inputTime
+
+	TripleBuffer<SceneSnapshot> m_snapshots;
+	std::mutex m_snapshotMutex;
+	std::condition_variable m_snapshotAcquired;
+	bool m_previousSnapshotAcquired;
+	bool m_stopPublishing;
 };
 
 using ObjectProcessorPtr_t = std::shared_ptr<ObjectProcessor>;
\ No newline at end of file
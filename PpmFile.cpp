@@ -0,0 +1,37 @@
+#include "PpmFile.h"
+#include "Exceptions.h"
+
+#include <format>
+#include <fstream>
+#include <vector>
+
+constexpr size_t k_bgraPixelBytes = 4;
+constexpr size_t k_rgbPixelBytes = 3;
+
+void PpmFile::WriteBgra(std::string const& filePath, uint32_t width, uint32_t height, std::span<uint8_t const> pixels)
+{
+	size_t const pixelCount = size_t(width) * height;
+	if (pixels.size() < pixelCount * k_bgraPixelBytes)
+	{
+		throw InvalidStateException(std::format("Not enough pixel data to write a {}x{} image to: {}", width, height, filePath));
+	}
+
+	std::vector<uint8_t> rgb(pixelCount * k_rgbPixelBytes);
+	for (size_t i = 0; i < pixelCount; ++i)
+	{
+		uint8_t const* pSource = pixels.data() + i * k_bgraPixelBytes;
+		rgb[i * k_rgbPixelBytes + 0] = pSource[2];
+		rgb[i * k_rgbPixelBytes + 1] = pSource[1];
+		rgb[i * k_rgbPixelBytes + 2] = pSource[0];
+	}
+
+	std::ofstream stream(filePath, std::ios::binary | std::ios::trunc);
+	if (!stream.is_open())
+	{
+		throw InvalidStateException("Failed to open PPM file for writing at: " + filePath);
+	}
+
+	std::string const header = std::format("P6\n{} {}\n255\n", width, height);
+	stream.write(header.data(), header.size());
+	stream.write((char const*)rgb.data(), rgb.size());
+}
\ No newline at end of file
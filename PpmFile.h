@@ -0,0 +1,12 @@
+#pragma once
+#include <cstdint>
+#include <span>
+#include <string>
+
+//Binary PPM output for frames read back from the gpu, simple enough to diff against golden images without an image library
+class PpmFile
+{
+public:
+	//Pixels are tightly packed rows of 8 bit BGRA as rendered, alpha is dropped
+	static void WriteBgra(std::string const& filePath, uint32_t width, uint32_t height, std::span<uint8_t const> pixels);
+};
\ No newline at end of file
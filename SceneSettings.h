@@ -0,0 +1,10 @@
+#pragma once
+#include <cstdint>
+
+//What gets loaded, benchmarks scale these up to find where frame time goes
+struct SceneSettings
+{
+	uint32_t modelCount = 8;
+	uint32_t cubeCount = 12;
+	uint32_t terrainGridSize = 10; //Cells along each side
+};
\ No newline at end of file
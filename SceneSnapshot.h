@@ -0,0 +1,48 @@
+#pragma once
+#include "Math.h"
+#include "Camera.h"
+#include "TransformStore.h"
+#include "Exceptions.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+//Immutable copy of everything the renderer needs from the simulation for one frame. Holds the state on both sides of
+// the latest step so frames drawn between steps can interpolate
+struct SceneSnapshot
+{
+	//By dense transform index
+	std::vector<glm::vec3> previousPositions;
+	std::vector<glm::quat> previousRotations;
+	std::vector<glm::vec3> previousScales;
+	std::vector<glm::vec3> positions;
+	std::vector<glm::quat> rotations;
+	std::vector<glm::vec3> scales;
+	std::vector<glm::mat4> worldMatrices; //After the latest step
+	std::vector<uint32_t> slotDenseIndices; //By handle slot, so handles resolve without touching the live store
+	std::vector<uint32_t> slotGenerations; //By handle slot, catches handles removed before the snapshot was taken
+
+	Camera previousCamera = Camera(1, 1);
+	Camera camera = Camera(1, 1);
+
+	uint64_t simulationStep = 0;
+	double stepSeconds = 1.0;
+	double alpha = 0.0; //Fraction of a step accumulated but not simulated when published
+	double publishTime = 0.0; //Clock seconds
+	double inputTime = 0.0; //Clock seconds the camera's input was sampled, 0 if nothing drove it
+
+	//Throws like TransformStore::Resolve if the handle had been removed or never existed when the snapshot was taken
+	uint32_t GetDenseIndex(TransformHandle handle) const
+	{
+		if (handle.slot >= slotGenerations.size() || slotGenerations[handle.slot] != handle.generation)
+		{
+			throw InvalidStateException("Stale transform handle in snapshot, slot " + std::to_string(handle.slot) + " generation " + std::to_string(handle.generation));
+		}
+		return slotDenseIndices[handle.slot];
+	}
+	glm::mat4 const& GetWorldMatrix(TransformHandle handle) const { return worldMatrices[GetDenseIndex(handle)]; }
+
+	//Carries on from alpha with the real time since publishing, held at the latest state if the next step is late
+	float GetInterpolationAlpha(double now) const { return float(std::clamp(alpha + (now - publishTime) / stepSeconds, 0.0, 1.0)); }
+};
\ No newline at end of file
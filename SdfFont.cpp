@@ -0,0 +1,339 @@
+#include "SdfFont.h"
+#include "JobSystem.h"
+#include "Clock.h"
+#include "Exceptions.h"
+#include "Logger.h"
+#include "stb_font_consolas_24_latin1.inl"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <numeric>
+
+constexpr uint32_t k_sdfAtlasVersion = 1; //Bump whenever generation changes so stale caches are rebuilt
+constexpr char k_sdfAtlasMagic[4] = { 'S', 'D', 'F', 'A' };
+
+constexpr uint32_t k_sdfAtlasWidth = 256;
+constexpr uint32_t k_sdfPadding = 4; //Texels around each glyph for the field to fall off in
+constexpr float k_sdfSpread = 4.0f; //Distance in source pixels covered by each half of the value range
+constexpr uint32_t k_sdfSupersample = 4;
+constexpr float k_sdfFar = 1e20f; //Finite so the distance transform never subtracts infinities
+
+struct SdfAtlasHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint32_t width;
+	uint32_t height;
+	float pixelSize;
+	uint32_t firstChar;
+	uint32_t glyphCount;
+};
+
+struct GlyphCell
+{
+	uint32_t sourceX, sourceY; //In the baked bitmap
+	uint32_t width, height; //Of the glyph, without padding
+	uint32_t atlasX, atlasY; //Of the padded cell
+};
+
+//Squared euclidean distance transform of one line in place (Felzenszwalb and Huttenlocher). Entries start at 0 for
+// seeds and k_sdfFar elsewhere, scratch vectors must hold count + 1 entries
+void DistanceTransformLine(float* pLine, size_t count, size_t stride, std::vector<float>& f, std::vector<float>& z, std::vector<int>& v)
+{
+	for (size_t i = 0; i < count; ++i)
+	{
+		f[i] = pLine[i * stride];
+	}
+
+	int k = 0;
+	v[0] = 0;
+	z[0] = -k_sdfFar;
+	z[1] = k_sdfFar;
+	for (int q = 1; q < int(count); ++q)
+	{
+		float s = ((f[q] + float(q * q)) - (f[v[k]] + float(v[k] * v[k]))) / float(2 * q - 2 * v[k]);
+		while (s <= z[k])
+		{
+			k--;
+			s = ((f[q] + float(q * q)) - (f[v[k]] + float(v[k] * v[k]))) / float(2 * q - 2 * v[k]);
+		}
+		k++;
+		v[k] = q;
+		z[k] = s;
+		z[k + 1] = k_sdfFar;
+	}
+
+	k = 0;
+	for (int q = 0; q < int(count); ++q)
+	{
+		while (z[k + 1] < float(q))
+		{
+			k++;
+		}
+		pLine[q * stride] = float((q - v[k]) * (q - v[k])) + f[v[k]];
+	}
+}
+
+void DistanceTransform(std::vector<float>& grid, uint32_t width, uint32_t height)
+{
+	size_t const longest = std::max(width, height) + 1;
+	std::vector<float> f(longest);
+	std::vector<float> z(longest);
+	std::vector<int> v(longest);
+
+	for (uint32_t x = 0; x < width; ++x)
+	{
+		DistanceTransformLine(grid.data() + x, height, width, f, z, v);
+	}
+	for (uint32_t y = 0; y < height; ++y)
+	{
+		DistanceTransformLine(grid.data() + size_t(y) * width, width, 1, f, z, v);
+	}
+}
+
+void GenerateGlyph(uint8_t const* pSource, uint32_t sourceStride, GlyphCell const& cell, SdfFontAtlas& atlas)
+{
+	uint32_t const cellWidth = cell.width + 2 * k_sdfPadding;
+	uint32_t const cellHeight = cell.height + 2 * k_sdfPadding;
+	uint32_t const gridWidth = cellWidth * k_sdfSupersample;
+	uint32_t const gridHeight = cellHeight * k_sdfSupersample;
+
+	//Coverage of glyph local texel x, y with nothing outside the glyph's rect
+	auto const fetch = [&](int x, int y)
+	{
+		if (x < 0 || y < 0 || x >= int(cell.width) || y >= int(cell.height))
+		{
+			return 0.0f;
+		}
+		return float(pSource[size_t(cell.sourceY + y) * sourceStride + cell.sourceX + x]) / 255.0f;
+	};
+
+	std::vector<bool> inside(size_t(gridWidth) * gridHeight);
+	std::vector<float> toInside(inside.size());
+	std::vector<float> toOutside(inside.size());
+	for (uint32_t gy = 0; gy < gridHeight; ++gy)
+	{
+		for (uint32_t gx = 0; gx < gridWidth; ++gx)
+		{
+			//Bilinear coverage at the grid texel's centre
+			float const sx = (float(gx) + 0.5f) / float(k_sdfSupersample) - float(k_sdfPadding) - 0.5f;
+			float const sy = (float(gy) + 0.5f) / float(k_sdfSupersample) - float(k_sdfPadding) - 0.5f;
+			int const x0 = int(std::floor(sx));
+			int const y0 = int(std::floor(sy));
+			float const tx = sx - float(x0);
+			float const ty = sy - float(y0);
+			float const coverage =
+				(fetch(x0, y0) * (1.0f - tx) + fetch(x0 + 1, y0) * tx) * (1.0f - ty) +
+				(fetch(x0, y0 + 1) * (1.0f - tx) + fetch(x0 + 1, y0 + 1) * tx) * ty;
+
+			size_t const index = size_t(gy) * gridWidth + gx;
+			inside[index] = coverage >= 0.5f;
+			toInside[index] = inside[index] ? 0.0f : k_sdfFar;
+			toOutside[index] = inside[index] ? k_sdfFar : 0.0f;
+		}
+	}
+
+	DistanceTransform(toInside, gridWidth, gridHeight);
+	DistanceTransform(toOutside, gridWidth, gridHeight);
+
+	for (uint32_t cy = 0; cy < cellHeight; ++cy)
+	{
+		for (uint32_t cx = 0; cx < cellWidth; ++cx)
+		{
+			size_t const index = size_t(cy * k_sdfSupersample + k_sdfSupersample / 2) * gridWidth + cx * k_sdfSupersample + k_sdfSupersample / 2;
+
+			//The outline sits half a grid texel from the centres either side of it
+			float const gridDistance = inside[index] ? std::sqrt(toOutside[index]) - 0.5f : 0.5f - std::sqrt(toInside[index]);
+			float const distance = gridDistance / float(k_sdfSupersample);
+			float const value = std::clamp(0.5f + distance / (2.0f * k_sdfSpread), 0.0f, 1.0f);
+			atlas.pixels[size_t(cell.atlasY + cy) * atlas.width + cell.atlasX + cx] = uint8_t(std::lround(value * 255.0f));
+		}
+	}
+}
+
+SdfFontAtlas SdfFont::LoadOrGenerate(std::string const& cachePath, JobSystem& jobSystem)
+{
+	SdfFontAtlas atlas;
+	try
+	{
+		if (Read(cachePath, atlas))
+		{
+			SPDLOG_DEBUG("Loaded cached font atlas {}", cachePath);
+			return atlas;
+		}
+	}
+	catch (std::exception const& e)
+	{
+		SPDLOG_WARN("Ignoring font atlas cache: {}", e.what());
+	}
+
+	atlas = Generate(jobSystem);
+
+	try
+	{
+		Write(cachePath, atlas);
+	}
+	catch (std::exception const& e)
+	{
+		SPDLOG_WARN("Failed to cache font atlas: {}", e.what());
+	}
+	return atlas;
+}
+
+SdfFontAtlas SdfFont::Generate(JobSystem& jobSystem)
+{
+	double const startTime = Clock::GetSeconds();
+
+	static uint8_t fontPixels[STB_FONT_consolas_24_latin1_BITMAP_HEIGHT][STB_FONT_consolas_24_latin1_BITMAP_WIDTH];
+	stb_fontchar fontData[STB_FONT_consolas_24_latin1_NUM_CHARS];
+	stb_font_consolas_24_latin1(fontData, fontPixels, STB_FONT_consolas_24_latin1_BITMAP_HEIGHT);
+
+	SdfFontAtlas atlas;
+	atlas.width = k_sdfAtlasWidth;
+	atlas.pixelSize = 24.0f;
+	atlas.firstChar = STB_FONT_consolas_24_latin1_FIRST_CHAR;
+	atlas.glyphs.resize(STB_FONT_consolas_24_latin1_NUM_CHARS);
+
+	std::vector<GlyphCell> cells(STB_FONT_consolas_24_latin1_NUM_CHARS);
+	for (uint32_t i = 0; i < cells.size(); ++i)
+	{
+		stb_fontchar const& charData = fontData[i];
+		cells[i] = GlyphCell{
+			.sourceX = uint32_t(std::lround(charData.s0 * STB_FONT_consolas_24_latin1_BITMAP_WIDTH)),
+			.sourceY = uint32_t(std::lround(charData.t0 * STB_FONT_consolas_24_latin1_BITMAP_HEIGHT)),
+			.width = uint32_t(charData.x1 - charData.x0),
+			.height = uint32_t(charData.y1 - charData.y0),
+			.atlasX = 0,
+			.atlasY = 0
+		};
+	}
+
+	//Shelf packing, tallest first so each shelf wastes little above its shorter glyphs
+	std::vector<uint32_t> packOrder(cells.size());
+	std::iota(packOrder.begin(), packOrder.end(), 0);
+	std::sort(packOrder.begin(), packOrder.end(), [&cells](uint32_t a, uint32_t b) { return cells[a].height > cells[b].height; });
+
+	uint32_t shelfX = 0;
+	uint32_t shelfY = 0;
+	uint32_t shelfHeight = 0;
+	for (uint32_t const i : packOrder)
+	{
+		GlyphCell& cell = cells[i];
+		if (cell.width == 0 || cell.height == 0)
+		{
+			continue;
+		}
+
+		uint32_t const cellWidth = cell.width + 2 * k_sdfPadding;
+		uint32_t const cellHeight = cell.height + 2 * k_sdfPadding;
+		if (shelfX + cellWidth > atlas.width)
+		{
+			shelfX = 0;
+			shelfY += shelfHeight;
+			shelfHeight = 0;
+		}
+		cell.atlasX = shelfX;
+		cell.atlasY = shelfY;
+		shelfX += cellWidth;
+		shelfHeight = std::max(shelfHeight, cellHeight);
+	}
+	atlas.height = shelfY + shelfHeight;
+	atlas.pixels.resize(size_t(atlas.width) * atlas.height, 0);
+
+	for (uint32_t i = 0; i < cells.size(); ++i)
+	{
+		GlyphCell const& cell = cells[i];
+		stb_fontchar const& charData = fontData[i];
+		SdfGlyph& glyph = atlas.glyphs[i];
+		glyph.advance = charData.advance;
+		if (cell.width == 0 || cell.height == 0)
+		{
+			glyph.u0 = glyph.v0 = glyph.u1 = glyph.v1 = 0.0f;
+			glyph.x0 = glyph.y0 = glyph.x1 = glyph.y1 = 0.0f;
+			continue;
+		}
+
+		float const padding = float(k_sdfPadding);
+		glyph.u0 = float(cell.atlasX) / float(atlas.width);
+		glyph.v0 = float(cell.atlasY) / float(atlas.height);
+		glyph.u1 = float(cell.atlasX + cell.width + 2 * k_sdfPadding) / float(atlas.width);
+		glyph.v1 = float(cell.atlasY + cell.height + 2 * k_sdfPadding) / float(atlas.height);
+		glyph.x0 = float(charData.x0) - padding;
+		glyph.y0 = float(charData.y0) - padding;
+		glyph.x1 = float(charData.x1) + padding;
+		glyph.y1 = float(charData.y1) + padding;
+	}
+
+	//Cells don't overlap so glyphs can be written from any thread
+	jobSystem.ParallelFor(cells.size(), 8, [&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; ++i)
+		{
+			if (cells[i].width > 0 && cells[i].height > 0)
+			{
+				GenerateGlyph(&fontPixels[0][0], STB_FONT_consolas_24_latin1_BITMAP_WIDTH, cells[i], atlas);
+			}
+		}
+	});
+
+	SPDLOG_INFO("Generated {}x{} font distance field in {:.1f}ms", atlas.width, atlas.height, (Clock::GetSeconds() - startTime) * 1000.0);
+	return atlas;
+}
+
+bool SdfFont::Read(std::string const& filePath, SdfFontAtlas& atlas)
+{
+	std::ifstream stream(filePath, std::ios::binary);
+	if (!stream.is_open())
+	{
+		return false;
+	}
+
+	SdfAtlasHeader header;
+	if (!stream.read((char*)&header, sizeof(header)) || memcmp(header.magic, k_sdfAtlasMagic, sizeof(k_sdfAtlasMagic)) != 0)
+	{
+		throw InvalidStateException("Not a font atlas: " + filePath);
+	}
+	if (header.version != k_sdfAtlasVersion)
+	{
+		SPDLOG_INFO("Font atlas {} is from an older version, regenerating", filePath);
+		return false;
+	}
+
+	atlas.width = header.width;
+	atlas.height = header.height;
+	atlas.pixelSize = header.pixelSize;
+	atlas.firstChar = header.firstChar;
+	atlas.glyphs.resize(header.glyphCount);
+	atlas.pixels.resize(size_t(header.width) * header.height);
+	stream.read((char*)atlas.glyphs.data(), atlas.glyphs.size() * sizeof(SdfGlyph));
+	stream.read((char*)atlas.pixels.data(), atlas.pixels.size());
+	if (!stream)
+	{
+		throw InvalidStateException("Font atlas is truncated: " + filePath);
+	}
+	return true;
+}
+
+void SdfFont::Write(std::string const& filePath, SdfFontAtlas const& atlas)
+{
+	std::ofstream stream(filePath, std::ios::binary | std::ios::trunc);
+	if (!stream.is_open())
+	{
+		throw InvalidStateException("Failed to open font atlas for writing at: " + filePath);
+	}
+
+	SdfAtlasHeader header{};
+	memcpy(header.magic, k_sdfAtlasMagic, sizeof(k_sdfAtlasMagic));
+	header.version = k_sdfAtlasVersion;
+	header.width = atlas.width;
+	header.height = atlas.height;
+	header.pixelSize = atlas.pixelSize;
+	header.firstChar = atlas.firstChar;
+	header.glyphCount = uint32_t(atlas.glyphs.size());
+
+	stream.write((char const*)&header, sizeof(header));
+	stream.write((char const*)atlas.glyphs.data(), atlas.glyphs.size() * sizeof(SdfGlyph));
+	stream.write((char const*)atlas.pixels.data(), atlas.pixels.size());
+}
\ No newline at end of file
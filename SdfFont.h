@@ -0,0 +1,40 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class JobSystem;
+
+struct SdfGlyph
+{
+	float u0, v0, u1, v1; //Glyph's cell in the atlas, including the distance padding
+	float x0, y0, x1, y1; //Cell corners from the pen position, in pixels at SdfFontAtlas::pixelSize
+	float advance;
+};
+
+//Single channel signed distance field of every glyph in the font. 0.5 lies on the outline, higher is inside
+struct SdfFontAtlas
+{
+	uint32_t width = 0;
+	uint32_t height = 0;
+	std::vector<uint8_t> pixels;
+	float pixelSize = 0.0f; //Size the glyph metrics are measured at, scale them by the wanted size over this
+	uint32_t firstChar = 0;
+	std::vector<SdfGlyph> glyphs; //From firstChar onwards
+};
+
+//Builds a distance field atlas from the baked consolas bitmap, which is the only font source in the tree.
+//Each glyph's coverage is supersampled, thresholded and run through an exact euclidean distance transform
+class SdfFont
+{
+public:
+	//Reads the atlas cached at cachePath, or generates it and writes it there when missing or out of date
+	static SdfFontAtlas LoadOrGenerate(std::string const& cachePath, JobSystem& jobSystem);
+	//Glyphs are packed up front then generated in parallel, each writing its own region of the atlas
+	static SdfFontAtlas Generate(JobSystem& jobSystem);
+
+private:
+	//Returns false if there is no usable cache at filePath
+	static bool Read(std::string const& filePath, SdfFontAtlas& atlas);
+	static void Write(std::string const& filePath, SdfFontAtlas const& atlas);
+};
\ No newline at end of file
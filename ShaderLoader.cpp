@@ -5,9 +5,11 @@
 #include "Exceptions.h"
 #include "Logger.h"
 #include "GfxDevice.h"
+#include "CpuProfiler.h"
 
 vk::raii::ShaderModule ShaderLoader::LoadModule(std::string const& filePath, GfxDevicePtr_t pDevice)
 {
+	PROFILE_ZONE("ShaderLoader::LoadModule");
 	//TODO RAII files
 	std::ifstream file(filePath, std::ios::ate | std::ios::binary);
 
@@ -1,45 +1,97 @@
 #include "StaticModel.h"
-#include "GfxDevice.h"
-#include "ModelLoader.h"
 
 //TODO this gets waay cleaner with ECS or other component management so we don't have to talk to object processor directly
-StaticModel::StaticModel(GfxDevicePtr_t const pDevice, MeshPoolPtr_t meshPool, std::string const& modelFilePath, ObjectProcessorPtr_t pObjectProcessor)
-	: m_transform(pObjectProcessor->AddStaticMesh(ObjectData{glm::identity<glm::mat4>()}))
+StaticModel::StaticModel(AssetManagerPtr_t const& pAssetManager, std::string const& modelFilePath, ObjectProcessorPtr_t pObjectProcessor)
+	: m_mesh(pAssetManager->LoadMesh(modelFilePath))
+	, m_pObjectProcessor(pObjectProcessor)
+	, m_transform(pObjectProcessor->AddStaticMesh())
+	, m_lodIndex(0)
 {
-	if (!meshPool->contains(modelFilePath))
-	{
-		MeshPtr_t pMesh = ModelLoader::LoadModel(pDevice, modelFilePath);
-		meshPool->emplace(modelFilePath, pMesh);
-	}
-	m_pMesh = meshPool->at(modelFilePath);
+}
+
+StaticModel::~StaticModel()
+{
+	m_pObjectProcessor->RemoveStaticMesh(m_transform);
 }
 
 void StaticModel::SetPosition(glm::vec3 const& position)
 {
-	m_transform.transform = glm::translate(glm::identity<glm::mat4>(), position);
+	m_pObjectProcessor->GetTransforms().SetPosition(m_transform, position);
 }
 
 void StaticModel::SetRotation(float degrees, glm::vec3 const& axis)
 {
-	m_transform.transform = glm::rotate(glm::identity<glm::mat4>(), glm::radians(degrees), axis);
+	m_pObjectProcessor->GetTransforms().SetRotation(m_transform, glm::angleAxis(glm::radians(degrees), glm::normalize(axis)));
 }
 
 void StaticModel::SetScale(glm::vec3 const& scale)
 {
-	m_transform.transform = glm::scale(glm::identity<glm::mat4>(), scale);
+	m_pObjectProcessor->GetTransforms().SetScale(m_transform, scale);
 }
 
-glm::mat4 const& StaticModel::GetTransform()
+glm::mat4 const& StaticModel::GetTransform(SceneSnapshot const& snapshot)
 {
-	return m_transform.transform;
+	return snapshot.GetWorldMatrix(m_transform);
+}
+
+uint32_t StaticModel::GetTransformIndex(SceneSnapshot const& snapshot)
+{
+	return snapshot.GetDenseIndex(m_transform);
 }
 
 GfxBuffer const& StaticModel::GetVertexBuffer()
 {
-	return m_pMesh->vertexBuffer;
+	return m_mesh.Get().vertexBuffer;
 }
 
 GfxBuffer const& StaticModel::GetIndexBuffer()
 {
-	return m_pMesh->indexBuffer;
+	return m_mesh.Get().indexBuffer;
+}
+
+VertexQuantization const& StaticModel::GetQuantization()
+{
+	return m_mesh.Get().quantization;
+}
+
+void StaticModel::SelectLod(SceneSnapshot const& snapshot)
+{
+	Camera const& camera = snapshot.camera;
+	VertexQuantization const& bounds = m_mesh.Get().quantization;
+	glm::vec3 const extent(bounds.scale[0], bounds.scale[1], bounds.scale[2]);
+	glm::vec3 const localCenter = glm::vec3(bounds.offset[0], bounds.offset[1], bounds.offset[2]) + extent * 0.5f;
+
+	glm::mat4 const& transform = GetTransform(snapshot);
+	glm::vec3 const center = glm::vec3(transform * glm::vec4(localCenter, 1.0f));
+	float const maxScale = glm::max(glm::length(glm::vec3(transform[0])), glm::max(glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2]))));
+	float const radius = glm::length(extent) * 0.5f * maxScale;
+
+	//Distance to the nearest point of the bounding sphere, inside the sphere always draws full detail
+	float const distance = glm::distance(camera.GetPosition(), center) - radius;
+	if (distance <= 0.0f)
+	{
+		m_lodIndex = 0;
+		return;
+	}
+
+	//Pixels covered by one world unit at distance, proj[1][1] is cot(fovy / 2)
+	float const pixelsPerUnit = camera.GetProjection()[1][1] * camera.GetViewportHeight() * 0.5f / distance;
+
+	std::vector<MeshLod> const& lods = m_mesh.Get().lods;
+	m_lodIndex = 0;
+	for (size_t i = 1; i < lods.size(); ++i)
+	{
+		if (lods[i].error * maxScale * pixelsPerUnit > k_lodMaxPixelError)
+		{
+			break;
+		}
+		m_lodIndex = i;
+	}
+}
+
+MeshLod const& StaticModel::GetLod()
+{
+	//Selection may have run against the placeholder's shorter chain
+	std::vector<MeshLod> const& lods = m_mesh.Get().lods;
+	return lods[std::min(m_lodIndex, lods.size() - 1)];
 }
@@ -2,38 +2,46 @@
 #include "Math.h"
 #include "Mesh.h"
 #include "GfxBuffer.h"
+#include "Camera.h"
+#include "AssetManager.h"
+#include "SceneSnapshot.h"
+
+//Largest screen space error in pixels tolerated when picking a lod
+constexpr float k_lodMaxPixelError = 1.0f;
 
 //TODO refactor out
 #include "ObjectProcessor.h"
 
-constexpr uint32_t k_maxModelTransforms = 10000;
-
-struct ObjectData
-{
-	ObjectData(glm::mat4 transform)
-	{
-		this->transform = transform;
-	}
-
-	glm::mat4 transform;
-};
-
 class StaticModel {
 public:
-	StaticModel(GfxDevicePtr_t const pDevice, MeshPoolPtr_t meshPool, std::string const& modelFilePath, ObjectProcessorPtr_t pObjectProcessor);
+	StaticModel(AssetManagerPtr_t const& pAssetManager, std::string const& modelFilePath, ObjectProcessorPtr_t pObjectProcessor);
+	~StaticModel();
+
+	StaticModel(StaticModel const&) = delete;
+	StaticModel& operator=(StaticModel const&) = delete;
 
+	//Setters write the simulation's transform store, so only call them before the simulation thread starts
 	void SetPosition(glm::vec3 const& position);
 	void SetRotation(float degrees, glm::vec3 const& axis);
 	void SetScale(glm::vec3 const& scale);
 
-	glm::mat4 const& GetTransform();
+	glm::mat4 const& GetTransform(SceneSnapshot const& snapshot);
+	//Index of this model's matrix in the object buffer, drawn as the first instance
+	uint32_t GetTransformIndex(SceneSnapshot const& snapshot);
 
 	GfxBuffer const& GetVertexBuffer();
 	GfxBuffer const& GetIndexBuffer();
+	VertexQuantization const& GetQuantization();
+
+	//Picks the least detailed lod whose error projects to under k_lodMaxPixelError from the snapshot's camera
+	void SelectLod(SceneSnapshot const& snapshot);
+	MeshLod const& GetLod();
 
 private:
-	MeshPtr_t m_pMesh;
-	ObjectData& m_transform;
+	MeshHandle_t m_mesh; //Placeholder until loaded, so everything below may change between frames
+	ObjectProcessorPtr_t m_pObjectProcessor;
+	TransformHandle m_transform;
+	size_t m_lodIndex;
 };
 
 using StaticModelPtr_t = std::shared_ptr<StaticModel>;
\ No newline at end of file
@@ -6,24 +6,33 @@
 #include "ShaderLoader.h"
 #include "MarchingCubeTables.h"
 #include "Camera.h"
+#include "VertexPacker.h"
+#include "Exceptions.h"
+#include "GfxGpuProfiler.h"
+#include "CpuProfiler.h"
+
+#include <algorithm>
 
 //For mat4 size
 #include "Math.h"
 
-constexpr uint32_t k_valuesGenerated = 256;
+constexpr uint32_t k_densityGroupSize = 256; //local_size_x in densityGenerator.comp
 constexpr uint32_t k_densityInputBindingId = 0;
 constexpr uint32_t k_densityOutputBindingId = 1;
 
-TerrainGenerator::TerrainGenerator(GfxDevicePtr_t pDevice, vk::Viewport viewport, vk::Rect2D scissor, vk::RenderPass renderPass)
+TerrainGenerator::TerrainGenerator(GfxDevicePtr_t pDevice, GfxAttachmentFormats const& attachments, uint32_t gridSize, uint32_t framesInFlight)
 	: m_pPipeline(std::make_unique<GfxPipeline>())
 	, m_pComputePipline(std::make_unique<GfxPipeline>())
-	, m_computeDescriptors(pDevice)
+	, m_computeDescriptors(pDevice, framesInFlight)
 	, m_grid()
+	, m_cellCount(gridSize * gridSize * gridSize)
 	, m_pInputBuffer(nullptr)
-	, m_pOutputBuffer(nullptr)
-	, m_graphicsCommandPool(nullptr)
-	, m_renderCommandBuffer(nullptr)
-	, m_generateCommandBuffer(nullptr)
+	, m_outputBuffers()
+	, m_graphicsCommandPools()
+	, m_renderCommandBuffers()
+	, m_vertices()
+	, m_vertexBuffers(framesInFlight)
+	, m_generateCommandBuffers()
 {
 	//Set up compute pipeline
 	m_computeDescriptors.AddBinding(
@@ -69,30 +78,37 @@ TerrainGenerator::TerrainGenerator(GfxDevicePtr_t pDevice, vk::Viewport viewport
 	builder._shaderStages.push_back(GfxPipelineBuilder::CreateShaderStageInfo(vk::ShaderStageFlagBits::eVertex, *vertexShader));
 	builder._shaderStages.push_back(GfxPipelineBuilder::CreateShaderStageInfo(vk::ShaderStageFlagBits::eFragment, *fragShader));
 	builder._inputAssembly = GfxPipelineBuilder::CreateInputAssemblyInfo(vk::PrimitiveTopology::eTriangleList);
-	builder._viewport = viewport;
-	builder._scissor = scissor;
 	builder._rasterizer = GfxPipelineBuilder::CreateRasterizationStateInfo(vk::PolygonMode::eFill, vk::CullModeFlagBits::eNone);
 	builder._depthStencil = GfxPipelineBuilder::CreateDepthStencilStateInfo(VK_TRUE, VK_TRUE, vk::CompareOp::eLess);
 	builder._multisampling = GfxPipelineBuilder::CreateMultisampleStateInfo();
 	builder._colorBlendAttachment = GfxPipelineBuilder::CreateColorBlendAttachmentState();
 	builder._pipelineLayout = *m_pPipeline->layout;
-	builder._vertexDescription = TerrainVertex::GetDescription();
+	builder._vertexDescription = PackedTerrainVertex::GetDescription();
+	builder._extendedDynamicState = pDevice->SupportsExtendedDynamicState();
 
-	m_pPipeline->pipeline = builder.BuildPipeline(pDevice->GetDevice(), renderPass);
+	m_pPipeline->pipeline = builder.BuildPipeline(pDevice->GetDevice(), attachments);
+	m_pPipeline->dynamicState = builder.GetDynamicState();
 
 	//Set up commands
-	m_graphicsCommandPool = pDevice->CreateGraphicsCommandPool();
-	m_renderCommandBuffer = std::move(pDevice->CreateSecondaryCommandBuffers(*m_graphicsCommandPool, 1).front());
-	m_generateCommandBuffer = std::move(pDevice->CreatePrimaryCommandBuffers(*m_graphicsCommandPool, 1).front());
+	for (uint32_t i = 0; i < framesInFlight; ++i)
+	{
+		m_graphicsCommandPools.push_back(pDevice->CreateGraphicsCommandPool());
+		m_renderCommandBuffers.push_back(std::move(pDevice->CreateSecondaryCommandBuffers(*m_graphicsCommandPools.back(), 1).front()));
+		m_generateCommandBuffers.push_back(std::move(pDevice->CreatePrimaryCommandBuffers(*m_graphicsCommandPools.back(), 1).front()));
+	}
 
 	//Set up terrain voxels
-	//For now we just create a grid at 0,0,0 that is 10 x 10 x 10
-	constexpr uint32_t k_gridSize = 10;
+	//For now we just create a grid at 0,0,0 that is gridSize x gridSize x gridSize
+	//One density value is generated per cell, so the dispatch and readback grow with the grid
+	if (gridSize == 0)
+	{
+		throw InitializationException("Terrain grid needs at least one cell");
+	}
 	constexpr float k_cellSize = 1.0f;
-	m_grid.reserve(k_gridSize * k_gridSize * k_gridSize);
-	for (uint32_t height = 0; height < k_gridSize; ++height) {
-		for (uint32_t width = 0; width < k_gridSize; ++width) {
-			for (uint32_t depth = 0; depth < k_gridSize; ++depth) {
+	m_grid.reserve(m_cellCount);
+	for (uint32_t height = 0; height < gridSize; ++height) {
+		for (uint32_t width = 0; width < gridSize; ++width) {
+			for (uint32_t depth = 0; depth < gridSize; ++depth) {
 				Cell cell;
 				cell.fbl = { .x = width * k_cellSize, .y = height * k_cellSize, .z = depth * k_cellSize };
 				cell.bbl = { .x = width * k_cellSize, .y = height * k_cellSize, .z = (depth + 1) * k_cellSize };
@@ -115,17 +131,22 @@ TerrainGenerator::TerrainGenerator(GfxDevicePtr_t pDevice, vk::Viewport viewport
 	glm::mat4 ident = glm::identity<glm::mat4>();
 	m_pInputBuffer->CopyToBuffer(&ident, inputBufferSize, 0);
 
-	size_t const outputBufferSize = k_valuesGenerated * sizeof(float);
-	m_pOutputBuffer = std::make_shared<GfxBuffer>(pDevice->CreateBuffer(outputBufferSize, vk::BufferUsageFlagBits::eStorageBuffer));
-	std::vector<float> empty(k_valuesGenerated, 0.0f);
-	m_pOutputBuffer->CopyToBuffer(empty.data(), outputBufferSize, 0);
-	vk::WriteDescriptorSet writeDescriptor = m_computeDescriptors.GetWriteDescriptor(DataUsageFrequency::ePerFrame, k_densityOutputBindingId);
-	pDevice->UploadBufferData(outputBufferSize, 0, *m_pOutputBuffer->m_buffer, writeDescriptor);
+	//Each slot's output is read back once its fence has signalled, so slots can't share one
+	size_t const outputBufferSize = m_cellCount * sizeof(float);
+	std::vector<float> empty(m_cellCount, 0.0f);
+	for (uint32_t i = 0; i < framesInFlight; ++i)
+	{
+		m_outputBuffers.push_back(std::make_shared<GfxBuffer>(pDevice->CreateBuffer(outputBufferSize, vk::BufferUsageFlagBits::eStorageBuffer)));
+		m_outputBuffers.back()->CopyToBuffer(empty.data(), outputBufferSize, 0);
+		vk::WriteDescriptorSet writeDescriptor = m_computeDescriptors.GetWriteDescriptor(DataUsageFrequency::ePerFrame, k_densityOutputBindingId, i);
+		pDevice->UploadBufferData(outputBufferSize, 0, *m_outputBuffers.back()->m_buffer, writeDescriptor);
+	}
 }
 
-vk::CommandBuffer TerrainGenerator::Render(GfxDevicePtr_t pDevice)
+vk::CommandBuffer TerrainGenerator::Render(GfxDevicePtr_t pDevice, uint32_t frameSlot, GfxGpuProfiler& profiler)
 {
-	m_graphicsCommandPool.reset();
+	m_graphicsCommandPools[frameSlot].reset();
+	vk::raii::CommandBuffer const& generateCommandBuffer = m_generateCommandBuffers[frameSlot];
 	//Terrain generation algorithim is as follows
 
 	//Upload noise texture once at initialization
@@ -133,42 +154,49 @@ vk::CommandBuffer TerrainGenerator::Render(GfxDevicePtr_t pDevice)
 
 	//Wait for previous frame to finish
 	//Update camera data per frame
-	vk::WriteDescriptorSet writeDescriptor = m_computeDescriptors.GetWriteDescriptor(DataUsageFrequency::ePerFrame, k_densityInputBindingId);
+	vk::WriteDescriptorSet writeDescriptor = m_computeDescriptors.GetWriteDescriptor(DataUsageFrequency::ePerFrame, k_densityInputBindingId, frameSlot);
 	pDevice->UploadBufferData(sizeof(glm::mat4), 0, *m_pInputBuffer->m_buffer, writeDescriptor);
 
 	//Run compute shader to generate grid values
 	vk::CommandBufferBeginInfo const beginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
-	m_generateCommandBuffer.begin(beginInfo);
-
-	m_generateCommandBuffer.bindDescriptorSets(
-		vk::PipelineBindPoint::eCompute,
-		*m_pComputePipline->layout,
-		0,
-		m_computeDescriptors.GetDescriptor(DataUsageFrequency::ePerFrame),
-		nullptr
-	);
+	generateCommandBuffer.begin(beginInfo);
 
-	m_generateCommandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, *m_pComputePipline->pipeline);
-	m_generateCommandBuffer.dispatch(k_valuesGenerated, 1, 1);
+	{
+		GpuScope scope(profiler, *generateCommandBuffer, "TerrainDensity");
+		generateCommandBuffer.bindDescriptorSets(
+			vk::PipelineBindPoint::eCompute,
+			*m_pComputePipline->layout,
+			0,
+			m_computeDescriptors.GetDescriptor(DataUsageFrequency::ePerFrame, frameSlot),
+			nullptr
+		);
+
+		generateCommandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, *m_pComputePipline->pipeline);
+		generateCommandBuffer.dispatch((m_cellCount + k_densityGroupSize - 1) / k_densityGroupSize, 1, 1);
+	}
 
-	//Wait on compute shader to complete
-	//TODO barrier
+	//Densities are read on the host once the slot's fence has signalled, the fence alone doesn't make them visible there
+	vk::MemoryBarrier const readbackBarrier(vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eHostRead);
+	generateCommandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eHost, {}, readbackBarrier, nullptr, nullptr);
 
 	//Feed grid values to mesh shader
 	//Use mesh shader to generate terrain
 
 	//Draw visible terrain with fragment shader
 
-	m_generateCommandBuffer.end();
-	return *m_generateCommandBuffer;
+	generateCommandBuffer.end();
+	return *generateCommandBuffer;
 }
 
 void TerrainGenerator::GenerateVertexBuffer(std::vector<float> const& lookUpIndices)
 {
-	for (float const lookUp : lookUpIndices)
+	PROFILE_ZONE("TerrainGenerator::GenerateVertexBuffer");
+	m_vertices.clear();
+	size_t const cellCount = std::min(lookUpIndices.size(), m_grid.size());
+	for (size_t cellIndex = 0; cellIndex < cellCount; ++cellIndex)
 	{
 		//truncate to int
-		int32_t const permutationIndex = static_cast<int32_t>(lookUp);
+		int32_t const permutationIndex = static_cast<int32_t>(lookUpIndices[cellIndex]);
 
 		//Read through look up
 		for (uint32_t i = 0; i < 12; ++i)
@@ -178,8 +206,7 @@ void TerrainGenerator::GenerateVertexBuffer(std::vector<float> const& lookUpIndi
 			if (cellEdgeIndex == UINT8_MAX) continue;
 
 			//Gather values from grid
-			//Coupling permutation index and cell together for now
-			Cell cell = m_grid[permutationIndex];
+			Cell const& cell = m_grid[cellIndex];
 
 			Edge edge = k_EdgeToVertexLookupTable[cellEdgeIndex];
 			TerrainVertex a = cell.TerrainVertices[edge.a];
@@ -197,37 +224,46 @@ bool TerrainGenerator::ReadyToRender()
 	return !m_vertices.empty();
 }
 
-vk::CommandBuffer TerrainGenerator::RenderTerrain(vk::CommandBufferInheritanceInfo const* pInheritanceInfo, GfxDevicePtr_t pDevice, Camera const& camera)
+vk::CommandBuffer TerrainGenerator::RenderTerrain(vk::CommandBufferInheritanceInfo const* pInheritanceInfo, uint32_t frameSlot, vk::Extent2D targetExtent, GfxDevicePtr_t pDevice, Camera const& camera, GfxGpuProfiler& profiler)
 {
-	//upload vertex buffer to gpu
-	size_t const k_vertexBufferSize = m_vertices.size() * sizeof(TerrainVertex);
-	m_pVertexBuffer = std::make_shared<GfxBuffer>(pDevice->CreateBuffer(k_vertexBufferSize, vk::BufferUsageFlagBits::eVertexBuffer));
-	m_pVertexBuffer->CopyToBuffer(m_vertices.data(), k_vertexBufferSize, 0);
+	//upload vertex buffer to gpu, replacing only this slot's so earlier frames keep drawing from theirs
+	std::vector<PackedTerrainVertex> const packedVertices = VertexPacker::Pack(m_vertices);
+	size_t const k_vertexBufferSize = packedVertices.size() * sizeof(PackedTerrainVertex);
+	std::shared_ptr<GfxBuffer>& pVertexBuffer = m_vertexBuffers[frameSlot];
+	pVertexBuffer = std::make_shared<GfxBuffer>(pDevice->CreateBuffer(k_vertexBufferSize, vk::BufferUsageFlagBits::eVertexBuffer));
+	pVertexBuffer->CopyToBuffer(packedVertices.data(), k_vertexBufferSize, 0);
 
 	//Draw terrain in render pass
 	vk::CommandBufferBeginInfo const beginInfo(
 		vk::CommandBufferUsageFlagBits::eRenderPassContinue | vk::CommandBufferUsageFlagBits::eOneTimeSubmit,
 		pInheritanceInfo);
-	m_renderCommandBuffer.begin(beginInfo);
+	vk::raii::CommandBuffer const& renderCommandBuffer = m_renderCommandBuffers[frameSlot];
+	renderCommandBuffer.begin(beginInfo);
 
-	m_renderCommandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, *m_pPipeline->pipeline);
-	m_renderCommandBuffer.bindVertexBuffers(0, *m_pVertexBuffer->m_buffer, { 0 });
+	{
+		GpuScope scope(profiler, *renderCommandBuffer, "Terrain");
+		renderCommandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, *m_pPipeline->pipeline);
+		GfxPipelineBuilder::SetDynamicState(*renderCommandBuffer, m_pPipeline->dynamicState, targetExtent);
+		renderCommandBuffer.bindVertexBuffers(0, *pVertexBuffer->m_buffer, { 0 });
 
-	//upload camera data to gpu
-	m_renderCommandBuffer.pushConstants<glm::mat4>(*m_pPipeline->layout, vk::ShaderStageFlagBits::eVertex, 0, camera.GetViewProj());
+		//upload camera data to gpu
+		renderCommandBuffer.pushConstants<glm::mat4>(*m_pPipeline->layout, vk::ShaderStageFlagBits::eVertex, 0, camera.GetViewProj());
 
-	//Draw vertices
-	m_renderCommandBuffer.draw(m_vertices.size(), 1, 0, 0);
+		//Draw vertices
+		renderCommandBuffer.draw(m_vertices.size(), 1, 0, 0);
+	}
 
-	m_renderCommandBuffer.end();
-	return *m_renderCommandBuffer;
+	renderCommandBuffer.end();
+	return *renderCommandBuffer;
 }
 
-std::vector<float> TerrainGenerator::GetDensityOutput() {
+std::vector<float> TerrainGenerator::GetDensityOutput(uint32_t frameSlot) {
 	std::vector<float> vec;
 
-	uint32_t numIterations = m_pOutputBuffer->m_dataSize / sizeof(float);
-	float* pData = (float*)m_pOutputBuffer->m_pData;
+	GfxBuffer const& outputBuffer = *m_outputBuffers[frameSlot];
+	//The allocation may be padded past the grid
+	uint32_t numIterations = m_cellCount;
+	float* pData = (float*)outputBuffer.m_pData;
 	for (uint32_t i = 0; i < numIterations; ++i)
 	{
 		vec.emplace_back(pData[i]);
@@ -10,6 +10,7 @@
 struct Mesh;
 struct GfxPipeline;
 class Camera;
+class GfxGpuProfiler;
 
 struct Edge
 {
@@ -63,32 +64,39 @@ struct Cell
 class TerrainGenerator
 {
 public:
-	TerrainGenerator(GfxDevicePtr_t pDevice, vk::Viewport viewport, vk::Rect2D scissor, vk::RenderPass renderPass);
+	//gridSize is the number of cells along each side of the terrain volume
+	TerrainGenerator(GfxDevicePtr_t pDevice, GfxAttachmentFormats const& attachments, uint32_t gridSize, uint32_t framesInFlight);
 
-	vk::CommandBuffer Render(GfxDevicePtr_t pDevice);
-	vk::CommandBuffer RenderTerrain(vk::CommandBufferInheritanceInfo const* pInheritanceInfo, GfxDevicePtr_t pDevice, Camera const& camera);
+	//Every frame slot has its own command buffers, density output and vertex buffer, so frameSlot's previous
+	// submission must have completed before any of these are called with it
+	vk::CommandBuffer Render(GfxDevicePtr_t pDevice, uint32_t frameSlot, GfxGpuProfiler& profiler);
+	vk::CommandBuffer RenderTerrain(vk::CommandBufferInheritanceInfo const* pInheritanceInfo, uint32_t frameSlot, vk::Extent2D targetExtent, GfxDevicePtr_t pDevice, Camera const& camera, GfxGpuProfiler& profiler);
 
+	//Replaces the vertices with those generated from lookUpIndices, one marching cubes configuration per grid cell
 	void GenerateVertexBuffer(std::vector<float> const& lookUpIndices);
-	std::vector<float> GetDensityOutput();
+	//What frameSlot's last density dispatch wrote, zeros before its first
+	std::vector<float> GetDensityOutput(uint32_t frameSlot);
 
 	bool ReadyToRender();
 
 private:
 	std::vector<Cell> m_grid;
+	uint32_t m_cellCount; //Density values generated and read back per frame, one per cell of m_grid
 	std::shared_ptr<GfxBuffer> m_pInputBuffer;
-	std::shared_ptr<GfxBuffer> m_pOutputBuffer;
+	std::vector<std::shared_ptr<GfxBuffer>> m_outputBuffers; //By frame slot
 
 	//Common Render components
 	std::unique_ptr<GfxPipeline> m_pPipeline;
-	vk::raii::CommandPool m_graphicsCommandPool;
-	vk::raii::CommandBuffer m_renderCommandBuffer;
+	//One pool per frame in flight holding that slot's render and generate buffers
+	std::vector<vk::raii::CommandPool> m_graphicsCommandPools;
+	std::vector<vk::raii::CommandBuffer> m_renderCommandBuffers;
 	std::vector<TerrainVertex> m_vertices;
 	//Temp
-	std::shared_ptr<GfxBuffer> m_pVertexBuffer;
+	std::vector<std::shared_ptr<GfxBuffer>> m_vertexBuffers; //By frame slot
 
 
 	//Compute components
 	std::unique_ptr<GfxPipeline> m_pComputePipline;
 	GfxDescriptorManager m_computeDescriptors;
-	vk::raii::CommandBuffer m_generateCommandBuffer;
+	std::vector<vk::raii::CommandBuffer> m_generateCommandBuffers;
 };
\ No newline at end of file
@@ -31,4 +31,27 @@ struct TerrainVertex {
 	{
 		return { x / denom, y / denom, z / denom };
 	}
+};
+
+//Half float positions, terrain cells sit on a coarse grid so half precision is plenty
+struct PackedTerrainVertex {
+	uint16_t x, y, z, w;
+
+	static VertexDescription GetDescription()
+	{
+		std::vector < vk::VertexInputBindingDescription> bindings =
+		{
+			vk::VertexInputBindingDescription(0, sizeof(PackedTerrainVertex))
+		};
+
+		std::vector<vk::VertexInputAttributeDescription> attributes =
+		{
+			vk::VertexInputAttributeDescription(0 /*location*/, 0 /*binding*/, vk::Format::eR16G16B16A16Sfloat, 0/*offset*/),
+		};
+
+		return VertexDescription{
+			.attributes = attributes,
+			.bindings = bindings
+		};
+	}
 };
\ No newline at end of file
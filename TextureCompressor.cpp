@@ -0,0 +1,652 @@
+#include "TextureCompressor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+static_assert(TextureCompressor::GetLevelSize(vk::Format::eBc1RgbSrgbBlock, 4, 4) == 8);
+static_assert(TextureCompressor::GetLevelSize(vk::Format::eBc1RgbSrgbBlock, 256, 128) == 256 * 128 / 2);
+static_assert(TextureCompressor::GetLevelSize(vk::Format::eBc3SrgbBlock, 256, 128) == 256 * 128);
+static_assert(TextureCompressor::GetLevelSize(vk::Format::eBc7SrgbBlock, 1, 1) == 16);
+static_assert(TextureCompressor::GetLevelSize(vk::Format::eBc5UnormBlock, 6, 2) == 2 * 16);
+static_assert(TextureCompressor::GetLevelSize(vk::Format::eR8G8B8A8Srgb, 3, 5) == 60);
+
+constexpr uint32_t k_blockDimension = 4;
+constexpr uint32_t k_blockTexels = k_blockDimension * k_blockDimension;
+constexpr uint32_t k_principalAxisIterations = 8;
+
+//Interpolation weights of BC7 4 bit indices, out of 64
+constexpr uint32_t k_bc7Weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+struct Block
+{
+	uint8_t texels[k_blockTexels][4];
+};
+
+//Edge blocks of textures that aren't a multiple of 4 repeat the last row and column
+Block LoadBlock(std::span<uint8_t const> rgba, uint32_t width, uint32_t height, uint32_t blockX, uint32_t blockY)
+{
+	Block block;
+	for (uint32_t y = 0; y < k_blockDimension; ++y)
+	{
+		uint32_t const sourceY = std::min(blockY * k_blockDimension + y, height - 1);
+		for (uint32_t x = 0; x < k_blockDimension; ++x)
+		{
+			uint32_t const sourceX = std::min(blockX * k_blockDimension + x, width - 1);
+			memcpy(block.texels[y * k_blockDimension + x], &rgba[(size_t(sourceY) * width + sourceX) * 4], 4);
+		}
+	}
+	return block;
+}
+
+void StoreBlock(Block const& block, std::span<uint8_t> rgba, uint32_t width, uint32_t height, uint32_t blockX, uint32_t blockY)
+{
+	for (uint32_t y = 0; y < k_blockDimension && blockY * k_blockDimension + y < height; ++y)
+	{
+		for (uint32_t x = 0; x < k_blockDimension && blockX * k_blockDimension + x < width; ++x)
+		{
+			size_t const destination = (size_t(blockY * k_blockDimension + y) * width + blockX * k_blockDimension + x) * 4;
+			memcpy(&rgba[destination], block.texels[y * k_blockDimension + x], 4);
+		}
+	}
+}
+
+uint32_t SquaredDistance(uint8_t const* pA, uint8_t const* pB, uint32_t channelCount)
+{
+	uint32_t distance = 0;
+	for (uint32_t c = 0; c < channelCount; ++c)
+	{
+		int32_t const delta = int32_t(pA[c]) - int32_t(pB[c]);
+		distance += delta * delta;
+	}
+	return distance;
+}
+
+//Fits a line through the block's first channelCount channels along their principal axis and returns its extreme points
+void FitEndpoints(Block const& block, uint32_t channelCount, float (&low)[4], float (&high)[4])
+{
+	float mean[4] = {};
+	for (auto const& texel : block.texels)
+	{
+		for (uint32_t c = 0; c < channelCount; ++c)
+		{
+			mean[c] += texel[c];
+		}
+	}
+	for (uint32_t c = 0; c < channelCount; ++c)
+	{
+		mean[c] /= k_blockTexels;
+	}
+
+	float covariance[4][4] = {};
+	for (auto const& texel : block.texels)
+	{
+		for (uint32_t i = 0; i < channelCount; ++i)
+		{
+			for (uint32_t j = 0; j < channelCount; ++j)
+			{
+				covariance[i][j] += (texel[i] - mean[i]) * (texel[j] - mean[j]);
+			}
+		}
+	}
+
+	//Start power iteration from the row of the most varying channel, a fixed start can be orthogonal to the answer
+	uint32_t widest = 0;
+	for (uint32_t c = 1; c < channelCount; ++c)
+	{
+		widest = covariance[c][c] > covariance[widest][widest] ? c : widest;
+	}
+
+	float axis[4] = {};
+	for (uint32_t c = 0; c < channelCount; ++c)
+	{
+		axis[c] = covariance[widest][c];
+	}
+
+	for (uint32_t iteration = 0; iteration < k_principalAxisIterations; ++iteration)
+	{
+		float next[4] = {};
+		float largest = 0.0f;
+		for (uint32_t i = 0; i < channelCount; ++i)
+		{
+			for (uint32_t j = 0; j < channelCount; ++j)
+			{
+				next[i] += covariance[i][j] * axis[j];
+			}
+			largest = std::max(largest, std::abs(next[i]));
+		}
+
+		if (largest == 0.0f)
+		{
+			break;
+		}
+
+		for (uint32_t c = 0; c < channelCount; ++c)
+		{
+			axis[c] = next[c] / largest;
+		}
+	}
+
+	float length = 0.0f;
+	for (uint32_t c = 0; c < channelCount; ++c)
+	{
+		length += axis[c] * axis[c];
+	}
+	length = std::sqrt(length);
+
+	//Flat blocks have no axis and collapse to the mean
+	float minimum = 0.0f;
+	float maximum = 0.0f;
+	if (length > 0.0f)
+	{
+		for (uint32_t c = 0; c < channelCount; ++c)
+		{
+			axis[c] /= length;
+		}
+
+		minimum = std::numeric_limits<float>::max();
+		maximum = -std::numeric_limits<float>::max();
+		for (auto const& texel : block.texels)
+		{
+			float projection = 0.0f;
+			for (uint32_t c = 0; c < channelCount; ++c)
+			{
+				projection += (texel[c] - mean[c]) * axis[c];
+			}
+			minimum = std::min(minimum, projection);
+			maximum = std::max(maximum, projection);
+		}
+	}
+
+	for (uint32_t c = 0; c < 4; ++c)
+	{
+		low[c] = c < channelCount ? std::clamp(mean[c] + axis[c] * minimum, 0.0f, 255.0f) : 0.0f;
+		high[c] = c < channelCount ? std::clamp(mean[c] + axis[c] * maximum, 0.0f, 255.0f) : 0.0f;
+	}
+}
+
+uint16_t PackRgb565(float const (&color)[4])
+{
+	uint32_t const r = uint32_t(std::lround(color[0] * 31.0f / 255.0f));
+	uint32_t const g = uint32_t(std::lround(color[1] * 63.0f / 255.0f));
+	uint32_t const b = uint32_t(std::lround(color[2] * 31.0f / 255.0f));
+	return uint16_t((r << 11) | (g << 5) | b);
+}
+
+void UnpackRgb565(uint16_t packed, uint8_t (&color)[4])
+{
+	uint32_t const r = (packed >> 11) & 31;
+	uint32_t const g = (packed >> 5) & 63;
+	uint32_t const b = packed & 31;
+	color[0] = uint8_t((r << 3) | (r >> 2));
+	color[1] = uint8_t((g << 2) | (g >> 4));
+	color[2] = uint8_t((b << 3) | (b >> 2));
+	color[3] = 255;
+}
+
+//Always writes 4 colour mode blocks, alpha is dropped
+void EncodeBC1(Block const& block, uint8_t* pOut)
+{
+	float low[4], high[4];
+	FitEndpoints(block, 3, low, high);
+
+	uint16_t color0 = PackRgb565(high);
+	uint16_t color1 = PackRgb565(low);
+	if (color0 < color1)
+	{
+		std::swap(color0, color1);
+	}
+
+	uint32_t indices = 0;
+	if (color0 != color1)
+	{
+		uint8_t palette[4][4];
+		UnpackRgb565(color0, palette[0]);
+		UnpackRgb565(color1, palette[1]);
+		for (uint32_t c = 0; c < 3; ++c)
+		{
+			palette[2][c] = uint8_t((2 * palette[0][c] + palette[1][c] + 1) / 3);
+			palette[3][c] = uint8_t((palette[0][c] + 2 * palette[1][c] + 1) / 3);
+		}
+
+		for (uint32_t i = 0; i < k_blockTexels; ++i)
+		{
+			uint32_t best = 0;
+			uint32_t bestDistance = std::numeric_limits<uint32_t>::max();
+			for (uint32_t p = 0; p < 4; ++p)
+			{
+				uint32_t const distance = SquaredDistance(block.texels[i], palette[p], 3);
+				if (distance < bestDistance)
+				{
+					best = p;
+					bestDistance = distance;
+				}
+			}
+			indices |= best << (2 * i);
+		}
+	}
+
+	memcpy(pOut + 0, &color0, sizeof(color0));
+	memcpy(pOut + 2, &color1, sizeof(color1));
+	memcpy(pOut + 4, &indices, sizeof(indices));
+}
+
+void DecodeBC1(uint8_t const* pIn, Block& block)
+{
+	uint16_t color0, color1;
+	uint32_t indices;
+	memcpy(&color0, pIn + 0, sizeof(color0));
+	memcpy(&color1, pIn + 2, sizeof(color1));
+	memcpy(&indices, pIn + 4, sizeof(indices));
+
+	uint8_t palette[4][4];
+	UnpackRgb565(color0, palette[0]);
+	UnpackRgb565(color1, palette[1]);
+	for (uint32_t c = 0; c < 3; ++c)
+	{
+		if (color0 > color1)
+		{
+			palette[2][c] = uint8_t((2 * palette[0][c] + palette[1][c] + 1) / 3);
+			palette[3][c] = uint8_t((palette[0][c] + 2 * palette[1][c] + 1) / 3);
+		}
+		else
+		{
+			palette[2][c] = uint8_t((palette[0][c] + palette[1][c] + 1) / 2);
+			palette[3][c] = 0;
+		}
+	}
+	palette[2][3] = 255;
+	palette[3][3] = color0 > color1 ? 255 : 0;
+
+	for (uint32_t i = 0; i < k_blockTexels; ++i)
+	{
+		memcpy(block.texels[i], palette[(indices >> (2 * i)) & 3], 4);
+	}
+}
+
+//Single channel block, also the alpha half of BC3 and each half of BC5. Always writes 8 value mode blocks
+void EncodeBC4(Block const& block, uint32_t channel, uint8_t* pOut)
+{
+	uint8_t minimum = 255;
+	uint8_t maximum = 0;
+	for (auto const& texel : block.texels)
+	{
+		minimum = std::min(minimum, texel[channel]);
+		maximum = std::max(maximum, texel[channel]);
+	}
+
+	uint64_t indices = 0;
+	if (maximum > minimum)
+	{
+		uint8_t palette[8] = { maximum, minimum };
+		for (uint32_t p = 2; p < 8; ++p)
+		{
+			palette[p] = uint8_t(((8 - p) * maximum + (p - 1) * minimum + 3) / 7);
+		}
+
+		for (uint32_t i = 0; i < k_blockTexels; ++i)
+		{
+			uint64_t best = 0;
+			uint32_t bestDistance = std::numeric_limits<uint32_t>::max();
+			for (uint32_t p = 0; p < 8; ++p)
+			{
+				uint32_t const distance = SquaredDistance(&block.texels[i][channel], &palette[p], 1);
+				if (distance < bestDistance)
+				{
+					best = p;
+					bestDistance = distance;
+				}
+			}
+			indices |= best << (3 * i);
+		}
+	}
+
+	pOut[0] = maximum;
+	pOut[1] = minimum;
+	memcpy(pOut + 2, &indices, 6);
+}
+
+void DecodeBC4(uint8_t const* pIn, uint32_t channel, Block& block)
+{
+	uint8_t palette[8] = { pIn[0], pIn[1] };
+	if (pIn[0] > pIn[1])
+	{
+		for (uint32_t p = 2; p < 8; ++p)
+		{
+			palette[p] = uint8_t(((8 - p) * pIn[0] + (p - 1) * pIn[1] + 3) / 7);
+		}
+	}
+	else
+	{
+		for (uint32_t p = 2; p < 6; ++p)
+		{
+			palette[p] = uint8_t(((6 - p) * pIn[0] + (p - 1) * pIn[1] + 2) / 5);
+		}
+		palette[6] = 0;
+		palette[7] = 255;
+	}
+
+	uint64_t indices = 0;
+	memcpy(&indices, pIn + 2, 6);
+	for (uint32_t i = 0; i < k_blockTexels; ++i)
+	{
+		block.texels[i][channel] = palette[(indices >> (3 * i)) & 7];
+	}
+}
+
+//Little endian bit stream in the order BC7 lays out its fields
+class BitStream
+{
+public:
+	BitStream(uint8_t* pData) : m_pData(pData), m_offset(0) {}
+
+	void Write(uint32_t value, uint32_t bitCount)
+	{
+		for (uint32_t i = 0; i < bitCount; ++i, ++m_offset)
+		{
+			m_pData[m_offset / 8] |= uint8_t(((value >> i) & 1) << (m_offset % 8));
+		}
+	}
+
+	uint32_t Read(uint32_t bitCount)
+	{
+		uint32_t value = 0;
+		for (uint32_t i = 0; i < bitCount; ++i, ++m_offset)
+		{
+			value |= uint32_t((m_pData[m_offset / 8] >> (m_offset % 8)) & 1) << i;
+		}
+		return value;
+	}
+
+private:
+	uint8_t* m_pData;
+	uint32_t m_offset;
+};
+
+//Mode 6 endpoints are 7 bits per channel plus a shared low bit, picks the low bit that lands closest
+void QuantizeBC7Endpoint(float const (&endpoint)[4], uint8_t (&quantized)[4], uint8_t& pBit)
+{
+	float bestError = std::numeric_limits<float>::max();
+	for (uint8_t p = 0; p < 2; ++p)
+	{
+		uint8_t candidate[4];
+		float error = 0.0f;
+		for (uint32_t c = 0; c < 4; ++c)
+		{
+			candidate[c] = uint8_t(std::clamp(std::lround((endpoint[c] - p) / 2.0f), 0l, 127l));
+			float const delta = float((candidate[c] << 1) | p) - endpoint[c];
+			error += delta * delta;
+		}
+
+		if (error < bestError)
+		{
+			bestError = error;
+			pBit = p;
+			memcpy(quantized, candidate, sizeof(candidate));
+		}
+	}
+}
+
+void BuildBC7Palette(uint8_t const (&endpoints)[2][4], uint8_t const (&pBits)[2], uint8_t (&palette)[16][4])
+{
+	for (uint32_t i = 0; i < 16; ++i)
+	{
+		for (uint32_t c = 0; c < 4; ++c)
+		{
+			uint32_t const e0 = (endpoints[0][c] << 1) | pBits[0];
+			uint32_t const e1 = (endpoints[1][c] << 1) | pBits[1];
+			palette[i][c] = uint8_t(((64 - k_bc7Weights4[i]) * e0 + k_bc7Weights4[i] * e1 + 32) >> 6);
+		}
+	}
+}
+
+//Mode 6 only, a single RGBA line with 4 bit indices. Worse than a full mode search on blocks with several distinct colours but cheap
+void EncodeBC7(Block const& block, uint8_t* pOut)
+{
+	float low[4], high[4];
+	FitEndpoints(block, 4, low, high);
+
+	uint8_t endpoints[2][4];
+	uint8_t pBits[2];
+	QuantizeBC7Endpoint(low, endpoints[0], pBits[0]);
+	QuantizeBC7Endpoint(high, endpoints[1], pBits[1]);
+
+	uint8_t palette[16][4];
+	BuildBC7Palette(endpoints, pBits, palette);
+
+	uint8_t indices[k_blockTexels];
+	for (uint32_t i = 0; i < k_blockTexels; ++i)
+	{
+		uint32_t bestDistance = std::numeric_limits<uint32_t>::max();
+		for (uint8_t p = 0; p < 16; ++p)
+		{
+			uint32_t const distance = SquaredDistance(block.texels[i], palette[p], 4);
+			if (distance < bestDistance)
+			{
+				indices[i] = p;
+				bestDistance = distance;
+			}
+		}
+	}
+
+	//The first index is stored without its high bit, so flip the line if it is set
+	if (indices[0] & 8)
+	{
+		std::swap(endpoints[0], endpoints[1]);
+		std::swap(pBits[0], pBits[1]);
+		for (uint8_t& index : indices)
+		{
+			index = 15 - index;
+		}
+	}
+
+	memset(pOut, 0, 16);
+	BitStream stream(pOut);
+	stream.Write(1 << 6, 7); //Mode 6
+	for (uint32_t c = 0; c < 4; ++c)
+	{
+		stream.Write(endpoints[0][c], 7);
+		stream.Write(endpoints[1][c], 7);
+	}
+	stream.Write(pBits[0], 1);
+	stream.Write(pBits[1], 1);
+	stream.Write(indices[0], 3);
+	for (uint32_t i = 1; i < k_blockTexels; ++i)
+	{
+		stream.Write(indices[i], 4);
+	}
+}
+
+void DecodeBC7(uint8_t const* pIn, Block& block)
+{
+	uint8_t data[16];
+	memcpy(data, pIn, sizeof(data));
+	BitStream stream(data);
+
+	if (stream.Read(7) != (1 << 6))
+	{
+		//Not mode 6, decode as magenta so it stands out
+		for (auto& texel : block.texels)
+		{
+			texel[0] = 255; texel[1] = 0; texel[2] = 255; texel[3] = 255;
+		}
+		return;
+	}
+
+	uint8_t endpoints[2][4];
+	for (uint32_t c = 0; c < 4; ++c)
+	{
+		endpoints[0][c] = uint8_t(stream.Read(7));
+		endpoints[1][c] = uint8_t(stream.Read(7));
+	}
+	uint8_t pBits[2];
+	pBits[0] = uint8_t(stream.Read(1));
+	pBits[1] = uint8_t(stream.Read(1));
+
+	uint8_t palette[16][4];
+	BuildBC7Palette(endpoints, pBits, palette);
+
+	for (uint32_t i = 0; i < k_blockTexels; ++i)
+	{
+		memcpy(block.texels[i], palette[stream.Read(i == 0 ? 3 : 4)], 4);
+	}
+}
+
+vk::Format TextureCompressor::GetFormat(TextureCompression compression)
+{
+	switch (compression)
+	{
+	case TextureCompression::eNone:
+		return vk::Format::eR8G8B8A8Srgb;
+	case TextureCompression::eBC1:
+		return vk::Format::eBc1RgbSrgbBlock;
+	case TextureCompression::eBC3:
+		return vk::Format::eBc3SrgbBlock;
+	case TextureCompression::eBC5:
+		return vk::Format::eBc5UnormBlock;
+	case TextureCompression::eBC7:
+		return vk::Format::eBc7SrgbBlock;
+	default:
+		throw InvalidStateException("Unknown texture compression");
+	}
+}
+
+std::string TextureCompressor::GetName(TextureCompression compression)
+{
+	switch (compression)
+	{
+	case TextureCompression::eNone:
+		return "rgba8";
+	case TextureCompression::eBC1:
+		return "bc1";
+	case TextureCompression::eBC3:
+		return "bc3";
+	case TextureCompression::eBC5:
+		return "bc5";
+	case TextureCompression::eBC7:
+		return "bc7";
+	default:
+		throw InvalidStateException("Unknown texture compression");
+	}
+}
+
+std::vector<uint8_t> TextureCompressor::Encode(TextureCompression compression, std::span<uint8_t const> rgba, uint32_t width, uint32_t height)
+{
+	if (compression == TextureCompression::eNone)
+	{
+		return std::vector<uint8_t>(rgba.begin(), rgba.end());
+	}
+
+	vk::Format const format = GetFormat(compression);
+	uint32_t const blockBytes = GetBlockBytes(format);
+	uint32_t const blocksX = (width + 3) / k_blockDimension;
+	uint32_t const blocksY = (height + 3) / k_blockDimension;
+	std::vector<uint8_t> blocks(GetLevelSize(format, width, height));
+
+	for (uint32_t blockY = 0; blockY < blocksY; ++blockY)
+	{
+		for (uint32_t blockX = 0; blockX < blocksX; ++blockX)
+		{
+			Block const block = LoadBlock(rgba, width, height, blockX, blockY);
+			uint8_t* const pOut = &blocks[(size_t(blockY) * blocksX + blockX) * blockBytes];
+
+			switch (compression)
+			{
+			case TextureCompression::eBC1:
+				EncodeBC1(block, pOut);
+				break;
+			case TextureCompression::eBC3:
+				EncodeBC4(block, 3, pOut);
+				EncodeBC1(block, pOut + 8);
+				break;
+			case TextureCompression::eBC5:
+				EncodeBC4(block, 0, pOut);
+				EncodeBC4(block, 1, pOut + 8);
+				break;
+			case TextureCompression::eBC7:
+				EncodeBC7(block, pOut);
+				break;
+			}
+		}
+	}
+
+	return blocks;
+}
+
+std::vector<uint8_t> TextureCompressor::Decode(TextureCompression compression, std::span<uint8_t const> blocks, uint32_t width, uint32_t height)
+{
+	if (compression == TextureCompression::eNone)
+	{
+		return std::vector<uint8_t>(blocks.begin(), blocks.end());
+	}
+
+	uint32_t const blockBytes = GetBlockBytes(GetFormat(compression));
+	uint32_t const blocksX = (width + 3) / k_blockDimension;
+	uint32_t const blocksY = (height + 3) / k_blockDimension;
+	std::vector<uint8_t> rgba(size_t(width) * height * 4);
+
+	for (uint32_t blockY = 0; blockY < blocksY; ++blockY)
+	{
+		for (uint32_t blockX = 0; blockX < blocksX; ++blockX)
+		{
+			uint8_t const* const pIn = &blocks[(size_t(blockY) * blocksX + blockX) * blockBytes];
+			Block block;
+
+			switch (compression)
+			{
+			case TextureCompression::eBC1:
+				DecodeBC1(pIn, block);
+				break;
+			case TextureCompression::eBC3:
+				DecodeBC1(pIn + 8, block);
+				DecodeBC4(pIn, 3, block);
+				break;
+			case TextureCompression::eBC5:
+				DecodeBC4(pIn, 0, block);
+				DecodeBC4(pIn + 8, 1, block);
+				for (auto& texel : block.texels)
+				{
+					texel[2] = 0;
+					texel[3] = 255;
+				}
+				break;
+			case TextureCompression::eBC7:
+				DecodeBC7(pIn, block);
+				break;
+			}
+
+			StoreBlock(block, rgba, width, height, blockX, blockY);
+		}
+	}
+
+	return rgba;
+}
+
+float TextureCompressor::MeasurePsnr(TextureCompression compression, std::span<uint8_t const> reference, std::span<uint8_t const> decoded)
+{
+	uint32_t channelCount = 4;
+	if (compression == TextureCompression::eBC1)
+	{
+		channelCount = 3;
+	}
+	else if (compression == TextureCompression::eBC5)
+	{
+		channelCount = 2;
+	}
+
+	double squaredError = 0.0;
+	size_t const texelCount = std::min(reference.size(), decoded.size()) / 4;
+	for (size_t i = 0; i < texelCount; ++i)
+	{
+		squaredError += SquaredDistance(&reference[i * 4], &decoded[i * 4], channelCount);
+	}
+
+	if (squaredError == 0.0)
+	{
+		return std::numeric_limits<float>::infinity();
+	}
+
+	double const meanSquaredError = squaredError / (double(texelCount) * channelCount);
+	return float(10.0 * std::log10(255.0 * 255.0 / meanSquaredError));
+}
\ No newline at end of file
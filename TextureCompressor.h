@@ -0,0 +1,81 @@
+#pragma once
+#include <span>
+#include <string>
+#include <vector>
+#include "GfxFwdDecl.h"
+#include "Exceptions.h"
+
+enum class TextureCompression
+{
+	eNone, //Uncompressed RGBA8, 32 bits per texel
+	eBC1, //Opaque colour, 4 bits per texel
+	eBC3, //Colour with smooth alpha, 8 bits per texel
+	eBC5, //Two channel linear data such as tangent space normals, 8 bits per texel
+	eBC7 //Colour with alpha at higher quality than BC3, 8 bits per texel
+};
+
+//CPU block compression of RGBA8 texels into the BC formats sampled directly by the gpu
+class TextureCompressor
+{
+public:
+	static vk::Format GetFormat(TextureCompression compression);
+	static std::string GetName(TextureCompression compression);
+
+	static constexpr bool IsBlockCompressed(vk::Format format)
+	{
+		return format >= vk::Format::eBc1RgbUnormBlock && format <= vk::Format::eBc7SrgbBlock;
+	}
+
+	//Bytes per 4x4 block for block compressed formats, bytes per texel otherwise
+	static constexpr uint32_t GetBlockBytes(vk::Format format)
+	{
+		switch (format)
+		{
+		case vk::Format::eBc1RgbUnormBlock:
+		case vk::Format::eBc1RgbSrgbBlock:
+		case vk::Format::eBc1RgbaUnormBlock:
+		case vk::Format::eBc1RgbaSrgbBlock:
+		case vk::Format::eBc4UnormBlock:
+		case vk::Format::eBc4SnormBlock:
+			return 8;
+		case vk::Format::eBc2UnormBlock:
+		case vk::Format::eBc2SrgbBlock:
+		case vk::Format::eBc3UnormBlock:
+		case vk::Format::eBc3SrgbBlock:
+		case vk::Format::eBc5UnormBlock:
+		case vk::Format::eBc5SnormBlock:
+		case vk::Format::eBc6HUfloatBlock:
+		case vk::Format::eBc6HSfloatBlock:
+		case vk::Format::eBc7UnormBlock:
+		case vk::Format::eBc7SrgbBlock:
+			return 16;
+		case vk::Format::eR8G8B8A8Unorm:
+		case vk::Format::eR8G8B8A8Srgb:
+		case vk::Format::eB8G8R8A8Unorm:
+		case vk::Format::eB8G8R8A8Srgb:
+			return 4;
+		case vk::Format::eR8Unorm:
+			return 1;
+		default:
+			throw InvalidStateException("Unsupported texture format");
+		}
+	}
+
+	//Bytes needed for one mip level, block compressed formats round partial blocks up to a whole 4x4 block
+	static constexpr size_t GetLevelSize(vk::Format format, uint32_t width, uint32_t height)
+	{
+		if (IsBlockCompressed(format))
+		{
+			return size_t((width + 3) / 4) * size_t((height + 3) / 4) * GetBlockBytes(format);
+		}
+		return size_t(width) * size_t(height) * GetBlockBytes(format);
+	}
+
+	//Encodes tightly packed RGBA8 texels
+	static std::vector<uint8_t> Encode(TextureCompression compression, std::span<uint8_t const> rgba, uint32_t width, uint32_t height);
+	//Decodes blocks written by Encode back to RGBA8. BC7 only understands mode 6, which is the only mode Encode writes
+	static std::vector<uint8_t> Decode(TextureCompression compression, std::span<uint8_t const> blocks, uint32_t width, uint32_t height);
+
+	//Peak signal to noise ratio in dB over the channels the compression keeps
+	static float MeasurePsnr(TextureCompression compression, std::span<uint8_t const> reference, std::span<uint8_t const> decoded);
+};
\ No newline at end of file
@@ -0,0 +1,223 @@
+#include "TransformSimd.h"
+#include "Exceptions.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <string>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+//The kernels load quaternions straight from memory as four floats
+static_assert(sizeof(glm::quat) == 16 && offsetof(glm::quat, x) == 0 && offsetof(glm::quat, w) == 12, "Expected glm::quat to be laid out as x, y, z, w");
+
+#if defined(_M_X64) || defined(__SSE2__)
+struct QuatLanes
+{
+	__m128 x;
+	__m128 y;
+	__m128 z;
+	__m128 w;
+};
+
+QuatLanes LoadQuats(glm::quat const* pQuats)
+{
+	float const* pFloats = &pQuats->x;
+	QuatLanes lanes{ _mm_loadu_ps(pFloats), _mm_loadu_ps(pFloats + 4), _mm_loadu_ps(pFloats + 8), _mm_loadu_ps(pFloats + 12) };
+	_MM_TRANSPOSE4_PS(lanes.x, lanes.y, lanes.z, lanes.w);
+	return lanes;
+}
+
+void StoreQuats(QuatLanes lanes, glm::quat* pQuats)
+{
+	_MM_TRANSPOSE4_PS(lanes.x, lanes.y, lanes.z, lanes.w);
+	float* pFloats = &pQuats->x;
+	_mm_storeu_ps(pFloats, lanes.x);
+	_mm_storeu_ps(pFloats + 4, lanes.y);
+	_mm_storeu_ps(pFloats + 8, lanes.z);
+	_mm_storeu_ps(pFloats + 12, lanes.w);
+}
+
+//Same operation order as glm's quaternion product, so results only differ from it by rounding
+QuatLanes MultiplyQuats(QuatLanes const& p, QuatLanes const& q)
+{
+	QuatLanes result;
+	result.w = _mm_sub_ps(_mm_sub_ps(_mm_sub_ps(_mm_mul_ps(p.w, q.w), _mm_mul_ps(p.x, q.x)), _mm_mul_ps(p.y, q.y)), _mm_mul_ps(p.z, q.z));
+	result.x = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(p.w, q.x), _mm_mul_ps(p.x, q.w)), _mm_mul_ps(p.y, q.z)), _mm_mul_ps(p.z, q.y));
+	result.y = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(p.w, q.y), _mm_mul_ps(p.y, q.w)), _mm_mul_ps(p.z, q.x)), _mm_mul_ps(p.x, q.z));
+	result.z = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(p.w, q.z), _mm_mul_ps(p.z, q.w)), _mm_mul_ps(p.x, q.y)), _mm_mul_ps(p.y, q.x));
+	return result;
+}
+
+//Full precision sqrt and divide rather than rsqrt, its 12 bits would show up as scale in the matrices
+QuatLanes NormalizeQuats(QuatLanes const& q)
+{
+	__m128 const lengthSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(q.x, q.x), _mm_mul_ps(q.y, q.y)), _mm_add_ps(_mm_mul_ps(q.z, q.z), _mm_mul_ps(q.w, q.w)));
+	__m128 const inverseLength = _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(lengthSquared));
+	return QuatLanes{ _mm_mul_ps(q.x, inverseLength), _mm_mul_ps(q.y, inverseLength), _mm_mul_ps(q.z, inverseLength), _mm_mul_ps(q.w, inverseLength) };
+}
+#endif
+
+void TransformSimd::ComposeRotations(std::span<glm::quat> rotations, std::span<glm::quat const> pattern)
+{
+	if (pattern.empty() || pattern.size() % 4 != 0)
+	{
+		throw InvalidStateException("Rotation pattern length must be a non zero multiple of 4, got " + std::to_string(pattern.size()));
+	}
+
+	size_t i = 0;
+#if defined(_M_X64) || defined(__SSE2__)
+	//Blocks start on multiples of 4 so each one lines up with 4 consecutive pattern entries
+	for (; i + 4 <= rotations.size(); i += 4)
+	{
+		QuatLanes const current = LoadQuats(&rotations[i]);
+		QuatLanes const delta = LoadQuats(&pattern[i % pattern.size()]);
+		StoreQuats(NormalizeQuats(MultiplyQuats(current, delta)), &rotations[i]);
+	}
+#endif
+
+	for (; i < rotations.size(); ++i)
+	{
+		rotations[i] = glm::normalize(rotations[i] * pattern[i % pattern.size()]);
+	}
+}
+
+void TransformSimd::BuildWorldMatrices(
+	std::span<glm::vec3 const> positions,
+	std::span<glm::quat const> rotations,
+	std::span<glm::vec3 const> scales,
+	std::span<uint8_t> dirty,
+	std::span<glm::mat4> worldMatrices)
+{
+	size_t i = 0;
+#if defined(_M_X64) || defined(__SSE2__)
+	__m128 const one = _mm_set1_ps(1.0f);
+	__m128 const two = _mm_set1_ps(2.0f);
+	__m128 const zero = _mm_setzero_ps();
+
+	for (; i + 4 <= worldMatrices.size(); i += 4)
+	{
+		//Mostly static scenes skip whole blocks on a single compare
+		uint32_t dirtyBlock = 0;
+		memcpy(&dirtyBlock, &dirty[i], sizeof(dirtyBlock));
+		if (dirtyBlock == 0)
+		{
+			continue;
+		}
+
+		QuatLanes const q = LoadQuats(&rotations[i]);
+		__m128 const xx = _mm_mul_ps(q.x, q.x);
+		__m128 const yy = _mm_mul_ps(q.y, q.y);
+		__m128 const zz = _mm_mul_ps(q.z, q.z);
+		__m128 const xy = _mm_mul_ps(q.x, q.y);
+		__m128 const xz = _mm_mul_ps(q.x, q.z);
+		__m128 const yz = _mm_mul_ps(q.y, q.z);
+		__m128 const wx = _mm_mul_ps(q.w, q.x);
+		__m128 const wy = _mm_mul_ps(q.w, q.y);
+		__m128 const wz = _mm_mul_ps(q.w, q.z);
+
+		__m128 const scaleX = _mm_setr_ps(scales[i].x, scales[i + 1].x, scales[i + 2].x, scales[i + 3].x);
+		__m128 const scaleY = _mm_setr_ps(scales[i].y, scales[i + 1].y, scales[i + 2].y, scales[i + 3].y);
+		__m128 const scaleZ = _mm_setr_ps(scales[i].z, scales[i + 1].z, scales[i + 2].z, scales[i + 3].z);
+
+		//Rotation matrix terms as in glm::mat3_cast with each column scaled, transposed so each register is one lane's column
+		__m128 column0[4] = {
+			_mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), scaleX),
+			_mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), scaleX),
+			_mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), scaleX),
+			zero };
+		__m128 column1[4] = {
+			_mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), scaleY),
+			_mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), scaleY),
+			_mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), scaleY),
+			zero };
+		__m128 column2[4] = {
+			_mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), scaleZ),
+			_mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), scaleZ),
+			_mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), scaleZ),
+			zero };
+		_MM_TRANSPOSE4_PS(column0[0], column0[1], column0[2], column0[3]);
+		_MM_TRANSPOSE4_PS(column1[0], column1[1], column1[2], column1[3]);
+		_MM_TRANSPOSE4_PS(column2[0], column2[1], column2[2], column2[3]);
+
+		for (size_t lane = 0; lane < 4; ++lane)
+		{
+			if (!dirty[i + lane])
+			{
+				continue;
+			}
+
+			glm::mat4& world = worldMatrices[i + lane];
+			_mm_storeu_ps(&world[0].x, column0[lane]);
+			_mm_storeu_ps(&world[1].x, column1[lane]);
+			_mm_storeu_ps(&world[2].x, column2[lane]);
+			world[3] = glm::vec4(positions[i + lane], 1.0f);
+			dirty[i + lane] = 0;
+		}
+	}
+#endif
+
+	for (; i < worldMatrices.size(); ++i)
+	{
+		if (dirty[i])
+		{
+			worldMatrices[i] = BuildWorldMatrix(positions[i], rotations[i], scales[i]);
+			dirty[i] = 0;
+		}
+	}
+}
+
+void TransformSimd::InterpolateWorldMatrices(
+	std::span<glm::vec3 const> fromPositions,
+	std::span<glm::quat const> fromRotations,
+	std::span<glm::vec3 const> fromScales,
+	std::span<glm::vec3 const> toPositions,
+	std::span<glm::quat const> toRotations,
+	std::span<glm::vec3 const> toScales,
+	float alpha,
+	std::span<glm::mat4> worldMatrices)
+{
+	//Blended a batch at a time into scratch arrays so matrix assembly still goes through the wide path
+	constexpr size_t k_batchSize = 64;
+	std::array<glm::vec3, k_batchSize> positions;
+	std::array<glm::quat, k_batchSize> rotations;
+	std::array<glm::vec3, k_batchSize> scales;
+	std::array<uint8_t, k_batchSize> dirty;
+
+	for (size_t begin = 0; begin < worldMatrices.size(); begin += k_batchSize)
+	{
+		size_t const count = std::min(k_batchSize, worldMatrices.size() - begin);
+		for (size_t i = 0; i < count; ++i)
+		{
+			positions[i] = glm::mix(fromPositions[begin + i], toPositions[begin + i], alpha);
+			scales[i] = glm::mix(fromScales[begin + i], toScales[begin + i], alpha);
+
+			//Steps are small, so nlerp is indistinguishable from slerp here
+			glm::quat const& from = fromRotations[begin + i];
+			glm::quat const& to = toRotations[begin + i];
+			float const sign = glm::dot(from, to) < 0.0f ? -1.0f : 1.0f;
+			rotations[i] = glm::normalize(from * (1.0f - alpha) + to * (alpha * sign));
+		}
+		dirty.fill(1);
+
+		BuildWorldMatrices(
+			std::span(positions).first(count),
+			std::span(rotations).first(count),
+			std::span(scales).first(count),
+			std::span(dirty).first(count),
+			worldMatrices.subspan(begin, count));
+	}
+}
+
+glm::mat4 TransformSimd::BuildWorldMatrix(glm::vec3 const& position, glm::quat const& rotation, glm::vec3 const& scale)
+{
+	glm::mat4 world = glm::mat4_cast(rotation);
+	world[0] *= scale.x;
+	world[1] *= scale.y;
+	world[2] *= scale.z;
+	world[3] = glm::vec4(position, 1.0f);
+	return world;
+}
\ No newline at end of file
@@ -0,0 +1,35 @@
+#pragma once
+#include "Math.h"
+
+#include <span>
+
+//Batch kernels over TransformStore's dense arrays. With SSE2 four transforms are handled per iteration by transposing
+// their quaternions into x, y, z and w registers, anything left over or without SSE2 takes the scalar path
+class TransformSimd
+{
+public:
+	//rotations[i] = normalize(rotations[i] * pattern[i % pattern.size()]), the pattern length must be a multiple of 4
+	static void ComposeRotations(std::span<glm::quat> rotations, std::span<glm::quat const> pattern);
+
+	//Rebuilds the world matrix of every transform with a non zero dirty flag and clears the flag
+	static void BuildWorldMatrices(
+		std::span<glm::vec3 const> positions,
+		std::span<glm::quat const> rotations,
+		std::span<glm::vec3 const> scales,
+		std::span<uint8_t> dirty,
+		std::span<glm::mat4> worldMatrices);
+
+	//World matrices part way between two states, positions and scales are lerped and rotations nlerped along the shorter arc
+	static void InterpolateWorldMatrices(
+		std::span<glm::vec3 const> fromPositions,
+		std::span<glm::quat const> fromRotations,
+		std::span<glm::vec3 const> fromScales,
+		std::span<glm::vec3 const> toPositions,
+		std::span<glm::quat const> toRotations,
+		std::span<glm::vec3 const> toScales,
+		float alpha,
+		std::span<glm::mat4> worldMatrices);
+
+	//Scale, then rotate, then translate
+	static glm::mat4 BuildWorldMatrix(glm::vec3 const& position, glm::quat const& rotation, glm::vec3 const& scale);
+};
\ No newline at end of file
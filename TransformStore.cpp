@@ -0,0 +1,173 @@
+#include "TransformStore.h"
+#include "TransformSimd.h"
+#include "SceneSnapshot.h"
+#include "Exceptions.h"
+
+#include <algorithm>
+#include <string>
+
+TransformHandle TransformStore::Add(glm::vec3 const& position, glm::quat const& rotation, glm::vec3 const& scale)
+{
+	uint32_t const denseIndex = uint32_t(m_worldMatrices.size());
+
+	uint32_t slot = 0;
+	if (m_freeSlots.empty())
+	{
+		slot = uint32_t(m_slots.size());
+		m_slots.push_back(Slot{ .denseIndex = denseIndex, .generation = 0 });
+	}
+	else
+	{
+		slot = m_freeSlots.back();
+		m_freeSlots.pop_back();
+		m_slots[slot].denseIndex = denseIndex;
+	}
+
+	m_positions.push_back(position);
+	m_rotations.push_back(rotation);
+	m_scales.push_back(scale);
+	m_previousPositions.push_back(position);
+	m_previousRotations.push_back(rotation);
+	m_previousScales.push_back(scale);
+	m_dirty.push_back(1);
+	m_worldMatrices.push_back(glm::identity<glm::mat4>());
+	m_denseToSlot.push_back(slot);
+
+	return TransformHandle{ .slot = slot, .generation = m_slots[slot].generation };
+}
+
+void TransformStore::Remove(TransformHandle handle)
+{
+	uint32_t const denseIndex = Resolve(handle);
+	uint32_t const lastIndex = uint32_t(m_worldMatrices.size() - 1);
+
+	if (denseIndex != lastIndex)
+	{
+		m_positions[denseIndex] = m_positions[lastIndex];
+		m_rotations[denseIndex] = m_rotations[lastIndex];
+		m_scales[denseIndex] = m_scales[lastIndex];
+		m_previousPositions[denseIndex] = m_previousPositions[lastIndex];
+		m_previousRotations[denseIndex] = m_previousRotations[lastIndex];
+		m_previousScales[denseIndex] = m_previousScales[lastIndex];
+		m_dirty[denseIndex] = m_dirty[lastIndex];
+		m_worldMatrices[denseIndex] = m_worldMatrices[lastIndex];
+		m_denseToSlot[denseIndex] = m_denseToSlot[lastIndex];
+		m_slots[m_denseToSlot[denseIndex]].denseIndex = denseIndex;
+	}
+
+	m_positions.pop_back();
+	m_rotations.pop_back();
+	m_scales.pop_back();
+	m_previousPositions.pop_back();
+	m_previousRotations.pop_back();
+	m_previousScales.pop_back();
+	m_dirty.pop_back();
+	m_worldMatrices.pop_back();
+	m_denseToSlot.pop_back();
+
+	//Outstanding handles to this slot now fail the generation check
+	m_slots[handle.slot].generation++;
+	m_freeSlots.push_back(handle.slot);
+}
+
+bool TransformStore::IsValid(TransformHandle handle) const noexcept
+{
+	return handle.slot < m_slots.size() && m_slots[handle.slot].generation == handle.generation;
+}
+
+void TransformStore::SetPosition(TransformHandle handle, glm::vec3 const& position)
+{
+	uint32_t const denseIndex = Resolve(handle);
+	m_positions[denseIndex] = position;
+	m_dirty[denseIndex] = 1;
+}
+
+void TransformStore::SetRotation(TransformHandle handle, glm::quat const& rotation)
+{
+	uint32_t const denseIndex = Resolve(handle);
+	m_rotations[denseIndex] = rotation;
+	m_dirty[denseIndex] = 1;
+}
+
+void TransformStore::SetScale(TransformHandle handle, glm::vec3 const& scale)
+{
+	uint32_t const denseIndex = Resolve(handle);
+	m_scales[denseIndex] = scale;
+	m_dirty[denseIndex] = 1;
+}
+
+glm::vec3 const& TransformStore::GetPosition(TransformHandle handle) const
+{
+	return m_positions[Resolve(handle)];
+}
+
+glm::quat const& TransformStore::GetRotation(TransformHandle handle) const
+{
+	return m_rotations[Resolve(handle)];
+}
+
+glm::vec3 const& TransformStore::GetScale(TransformHandle handle) const
+{
+	return m_scales[Resolve(handle)];
+}
+
+glm::mat4 const& TransformStore::GetWorldMatrix(TransformHandle handle) const
+{
+	return m_worldMatrices[Resolve(handle)];
+}
+
+uint32_t TransformStore::GetDenseIndex(TransformHandle handle) const
+{
+	return Resolve(handle);
+}
+
+void TransformStore::BeginStep(size_t begin, size_t end)
+{
+	std::copy(m_positions.begin() + begin, m_positions.begin() + end, m_previousPositions.begin() + begin);
+	std::copy(m_rotations.begin() + begin, m_rotations.begin() + end, m_previousRotations.begin() + begin);
+	std::copy(m_scales.begin() + begin, m_scales.begin() + end, m_previousScales.begin() + begin);
+}
+
+void TransformStore::UpdateWorldMatrices()
+{
+	UpdateWorldMatrices(0, m_worldMatrices.size());
+}
+
+void TransformStore::UpdateWorldMatrices(size_t begin, size_t end)
+{
+	size_t const count = end - begin;
+	TransformSimd::BuildWorldMatrices(
+		std::span(m_positions).subspan(begin, count),
+		std::span(m_rotations).subspan(begin, count),
+		std::span(m_scales).subspan(begin, count),
+		std::span(m_dirty).subspan(begin, count),
+		std::span(m_worldMatrices).subspan(begin, count));
+}
+
+void TransformStore::CopyTo(SceneSnapshot& snapshot) const
+{
+	snapshot.previousPositions = m_previousPositions;
+	snapshot.previousRotations = m_previousRotations;
+	snapshot.previousScales = m_previousScales;
+	snapshot.positions = m_positions;
+	snapshot.rotations = m_rotations;
+	snapshot.scales = m_scales;
+	snapshot.worldMatrices = m_worldMatrices;
+
+	snapshot.slotDenseIndices.resize(m_slots.size());
+	snapshot.slotGenerations.resize(m_slots.size());
+	for (size_t i = 0; i < m_slots.size(); ++i)
+	{
+		snapshot.slotDenseIndices[i] = m_slots[i].denseIndex;
+		snapshot.slotGenerations[i] = m_slots[i].generation;
+	}
+}
+
+uint32_t TransformStore::Resolve(TransformHandle handle) const
+{
+	if (!IsValid(handle))
+	{
+		throw InvalidStateException("Stale transform handle, slot " + std::to_string(handle.slot) + " generation " + std::to_string(handle.generation));
+	}
+	return m_slots[handle.slot].denseIndex;
+}
\ No newline at end of file
@@ -0,0 +1,81 @@
+#pragma once
+#include "Math.h"
+
+#include <span>
+#include <vector>
+
+struct SceneSnapshot;
+
+//Stable reference to a transform, stays valid while the transforms around it are added and removed
+struct TransformHandle
+{
+	uint32_t slot = UINT32_MAX;
+	uint32_t generation = 0;
+};
+
+//Structure of arrays transform storage. Components are packed densely so per frame passes touch contiguous memory,
+// handles go through a slot table whose generation counter catches use after removal.
+//World matrices are only rebuilt for transforms marked dirty since the last UpdateWorldMatrices
+class TransformStore
+{
+public:
+	TransformHandle Add(glm::vec3 const& position, glm::quat const& rotation, glm::vec3 const& scale);
+	//Swaps the last transform into the removed one's place, so dense indices of other transforms may change
+	void Remove(TransformHandle handle);
+	bool IsValid(TransformHandle handle) const noexcept;
+
+	void SetPosition(TransformHandle handle, glm::vec3 const& position);
+	void SetRotation(TransformHandle handle, glm::quat const& rotation);
+	void SetScale(TransformHandle handle, glm::vec3 const& scale);
+
+	glm::vec3 const& GetPosition(TransformHandle handle) const;
+	glm::quat const& GetRotation(TransformHandle handle) const;
+	glm::vec3 const& GetScale(TransformHandle handle) const;
+	//As of the last UpdateWorldMatrices
+	glm::mat4 const& GetWorldMatrix(TransformHandle handle) const;
+
+	//Index into the dense arrays, only stable until the next Remove
+	uint32_t GetDenseIndex(TransformHandle handle) const;
+	size_t Size() const noexcept { return m_worldMatrices.size(); }
+
+	//Dense access for batch updates, callers writing components must mark them dirty
+	std::span<glm::vec3> GetPositions() noexcept { return m_positions; }
+	std::span<glm::quat> GetRotations() noexcept { return m_rotations; }
+	std::span<glm::vec3> GetScales() noexcept { return m_scales; }
+	void MarkDirty(uint32_t denseIndex) noexcept { m_dirty[denseIndex] = 1; }
+
+	//Keeps the current components as the previous state, which snapshots carry for interpolation
+	void BeginStep(size_t begin, size_t end);
+
+	void UpdateWorldMatrices();
+	//Only touches transforms in [begin, end), so disjoint ranges can be updated from different threads
+	void UpdateWorldMatrices(size_t begin, size_t end);
+	//Indexed by dense index, ready to copy to the gpu as is
+	std::span<glm::mat4 const> GetWorldMatrices() const noexcept { return m_worldMatrices; }
+	//Components before and after the latest step, world matrices and each slot's dense index and generation,
+	// enough to resolve handles and interpolate without the store
+	void CopyTo(SceneSnapshot& snapshot) const;
+
+private:
+	struct Slot
+	{
+		uint32_t denseIndex;
+		uint32_t generation;
+	};
+
+	//Throws if the handle has been removed or never existed
+	uint32_t Resolve(TransformHandle handle) const;
+
+	std::vector<glm::vec3> m_positions;
+	std::vector<glm::quat> m_rotations;
+	std::vector<glm::vec3> m_scales;
+	std::vector<glm::vec3> m_previousPositions;
+	std::vector<glm::quat> m_previousRotations;
+	std::vector<glm::vec3> m_previousScales;
+	std::vector<uint8_t> m_dirty;
+	std::vector<glm::mat4> m_worldMatrices;
+	std::vector<uint32_t> m_denseToSlot;
+
+	std::vector<Slot> m_slots;
+	std::vector<uint32_t> m_freeSlots;
+};
\ No newline at end of file
@@ -0,0 +1,51 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+//Lock free single producer, single consumer mailbox. The producer always has a buffer to write and the consumer
+// always has the latest finished buffer to read, neither waits on the other. Unread buffers are overwritten
+template<typename T>
+class TripleBuffer
+{
+public:
+	TripleBuffer() : m_buffers(), m_writeIndex(0), m_readIndex(1), m_latest(2) {}
+
+	TripleBuffer(TripleBuffer const&) = delete;
+	TripleBuffer& operator=(TripleBuffer const&) = delete;
+
+	//Producer side, contents are whatever was published two swaps ago so writers should overwrite everything
+	T& GetWriteBuffer() noexcept { return m_buffers[m_writeIndex]; }
+
+	//Makes the write buffer the latest. The previous latest becomes the next write buffer, read or not
+	void Publish() noexcept
+	{
+		uint8_t const previous = m_latest.exchange(m_writeIndex | k_freshBit, std::memory_order_acq_rel);
+		m_writeIndex = previous & k_indexMask;
+	}
+
+	//Consumer side, swaps in the latest buffer if one was published since the last call. Returns false if not
+	bool Acquire() noexcept
+	{
+		if ((m_latest.load(std::memory_order_relaxed) & k_freshBit) == 0)
+		{
+			return false;
+		}
+
+		uint8_t const previous = m_latest.exchange(m_readIndex, std::memory_order_acq_rel);
+		m_readIndex = previous & k_indexMask;
+		return true;
+	}
+
+	//Stays untouched by the producer until the next Acquire
+	T const& GetReadBuffer() const noexcept { return m_buffers[m_readIndex]; }
+
+private:
+	static constexpr uint8_t k_indexMask = 0x3;
+	static constexpr uint8_t k_freshBit = 0x4;
+
+	std::array<T, 3> m_buffers;
+	uint8_t m_writeIndex; //Producer only
+	uint8_t m_readIndex; //Consumer only
+	std::atomic<uint8_t> m_latest; //Index of the latest buffer plus whether the consumer has seen it
+};
\ No newline at end of file
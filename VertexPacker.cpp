@@ -0,0 +1,166 @@
+#include "VertexPacker.h"
+#include "Math.h"
+
+#include <glm/gtc/packing.hpp>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+glm::vec2 SignNotZero(glm::vec2 v)
+{
+	return glm::vec2(v.x >= 0.0f ? 1.0f : -1.0f, v.y >= 0.0f ? 1.0f : -1.0f);
+}
+
+//Projects the unit sphere onto an octahedron then unfolds it onto the [-1,1] square
+glm::vec2 EncodeOctahedral(glm::vec3 n)
+{
+	float const l1Norm = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+	if (l1Norm == 0.0f)
+	{
+		return glm::vec2(0.0f); //Decodes to +z, same default the loader uses for missing normals
+	}
+
+	n /= l1Norm;
+	glm::vec2 encoded(n.x, n.y);
+	if (n.z < 0.0f)
+	{
+		encoded = (1.0f - glm::abs(glm::vec2(encoded.y, encoded.x))) * SignNotZero(encoded);
+	}
+	return encoded;
+}
+
+//Matches DecodeOctahedral in the vertex shaders
+glm::vec3 DecodeOctahedral(glm::vec2 e)
+{
+	glm::vec3 n(e.x, e.y, 1.0f - std::abs(e.x) - std::abs(e.y));
+	float const t = std::max(-n.z, 0.0f);
+	n.x += n.x >= 0.0f ? -t : t;
+	n.y += n.y >= 0.0f ? -t : t;
+	return glm::normalize(n);
+}
+
+VertexQuantization VertexPacker::ComputeQuantization(std::span<Vertex const> vertices)
+{
+	glm::vec3 minimum(std::numeric_limits<float>::max());
+	glm::vec3 maximum(std::numeric_limits<float>::lowest());
+
+	for (Vertex const& vertex : vertices)
+	{
+		glm::vec3 const position(vertex.vx, vertex.vy, vertex.vz);
+		minimum = glm::min(minimum, position);
+		maximum = glm::max(maximum, position);
+	}
+
+	glm::vec3 extent = maximum - minimum;
+	//Flat meshes would otherwise divide by zero
+	extent = glm::max(extent, glm::vec3(std::numeric_limits<float>::min()));
+
+	return VertexQuantization{
+		.offset = { minimum.x, minimum.y, minimum.z, 0.0f },
+		.scale = { extent.x, extent.y, extent.z, 1.0f }
+	};
+}
+
+PackedVertex VertexPacker::Pack(Vertex const& vertex, VertexQuantization const& quantization)
+{
+	glm::vec2 const normal = EncodeOctahedral(glm::vec3(vertex.nx, vertex.ny, vertex.nz));
+
+	return PackedVertex{
+		.px = glm::packUnorm1x16((vertex.vx - quantization.offset[0]) / quantization.scale[0]),
+		.py = glm::packUnorm1x16((vertex.vy - quantization.offset[1]) / quantization.scale[1]),
+		.pz = glm::packUnorm1x16((vertex.vz - quantization.offset[2]) / quantization.scale[2]),
+		.pw = glm::packUnorm1x16(1.0f),
+		.nx = glm::packSnorm1x16(normal.x),
+		.ny = glm::packSnorm1x16(normal.y),
+		.u = glm::packHalf1x16(vertex.u),
+		.v = glm::packHalf1x16(vertex.v)
+	};
+}
+
+Vertex VertexPacker::Unpack(PackedVertex const& vertex, VertexQuantization const& quantization)
+{
+	glm::vec3 const normal = DecodeOctahedral(glm::vec2(glm::unpackSnorm1x16(vertex.nx), glm::unpackSnorm1x16(vertex.ny)));
+
+	return Vertex{
+		.vx = quantization.offset[0] + glm::unpackUnorm1x16(vertex.px) * quantization.scale[0],
+		.vy = quantization.offset[1] + glm::unpackUnorm1x16(vertex.py) * quantization.scale[1],
+		.vz = quantization.offset[2] + glm::unpackUnorm1x16(vertex.pz) * quantization.scale[2],
+		.nx = normal.x,
+		.ny = normal.y,
+		.nz = normal.z,
+		.u = glm::unpackHalf1x16(vertex.u),
+		.v = glm::unpackHalf1x16(vertex.v)
+	};
+}
+
+std::vector<PackedVertex> VertexPacker::Pack(std::span<Vertex const> vertices, VertexQuantization const& quantization)
+{
+	std::vector<PackedVertex> packedVertices;
+	packedVertices.reserve(vertices.size());
+
+	for (Vertex const& vertex : vertices)
+	{
+		packedVertices.push_back(Pack(vertex, quantization));
+	}
+
+	return packedVertices;
+}
+
+VertexPackingError VertexPacker::MeasureError(std::span<Vertex const> vertices, std::span<PackedVertex const> packedVertices, VertexQuantization const& quantization)
+{
+	VertexPackingError error{ 0.0f, 0.0f, 0.0f };
+	float minNormalCosine = 1.0f;
+
+	for (size_t i = 0; i < vertices.size(); ++i)
+	{
+		Vertex const& original = vertices[i];
+		Vertex const decoded = Unpack(packedVertices[i], quantization);
+
+		glm::vec3 const positionError = glm::abs(glm::vec3(original.vx, original.vy, original.vz) - glm::vec3(decoded.vx, decoded.vy, decoded.vz));
+		error.position = std::max({ error.position, positionError.x, positionError.y, positionError.z });
+
+		glm::vec3 const originalNormal(original.nx, original.ny, original.nz);
+		if (glm::dot(originalNormal, originalNormal) > 0.0f)
+		{
+			float const cosine = glm::dot(glm::normalize(originalNormal), glm::vec3(decoded.nx, decoded.ny, decoded.nz));
+			minNormalCosine = std::min(minNormalCosine, cosine);
+		}
+
+		error.uv = std::max({ error.uv, std::abs(original.u - decoded.u), std::abs(original.v - decoded.v) });
+	}
+
+	error.normalDegrees = glm::degrees(std::acos(glm::clamp(minNormalCosine, -1.0f, 1.0f)));
+	return error;
+}
+
+PackedTerrainVertex VertexPacker::Pack(TerrainVertex const& vertex)
+{
+	return PackedTerrainVertex{
+		.x = glm::packHalf1x16(vertex.x),
+		.y = glm::packHalf1x16(vertex.y),
+		.z = glm::packHalf1x16(vertex.z),
+		.w = glm::packHalf1x16(1.0f)
+	};
+}
+
+TerrainVertex VertexPacker::Unpack(PackedTerrainVertex const& vertex)
+{
+	return TerrainVertex{
+		.x = glm::unpackHalf1x16(vertex.x),
+		.y = glm::unpackHalf1x16(vertex.y),
+		.z = glm::unpackHalf1x16(vertex.z)
+	};
+}
+
+std::vector<PackedTerrainVertex> VertexPacker::Pack(std::span<TerrainVertex const> vertices)
+{
+	std::vector<PackedTerrainVertex> packedVertices;
+	packedVertices.reserve(vertices.size());
+
+	for (TerrainVertex const& vertex : vertices)
+	{
+		packedVertices.push_back(Pack(vertex));
+	}
+
+	return packedVertices;
+}
\ No newline at end of file
@@ -0,0 +1,29 @@
+#pragma once
+#include <span>
+#include <vector>
+#include "Mesh.h"
+#include "TerrainVertex.h"
+
+struct VertexPackingError
+{
+	float position; //Largest absolute error of any position component
+	float normalDegrees; //Largest angle between an original and a decoded normal
+	float uv; //Largest absolute error of any texture coordinate
+};
+
+//Converts full precision vertices into the packed layouts used for rendering
+// the decode functions mirror what the vertex shaders do
+class VertexPacker
+{
+public:
+	static VertexQuantization ComputeQuantization(std::span<Vertex const> vertices);
+
+	static PackedVertex Pack(Vertex const& vertex, VertexQuantization const& quantization);
+	static Vertex Unpack(PackedVertex const& vertex, VertexQuantization const& quantization);
+	static std::vector<PackedVertex> Pack(std::span<Vertex const> vertices, VertexQuantization const& quantization);
+	static VertexPackingError MeasureError(std::span<Vertex const> vertices, std::span<PackedVertex const> packedVertices, VertexQuantization const& quantization);
+
+	static PackedTerrainVertex Pack(TerrainVertex const& vertex);
+	static TerrainVertex Unpack(PackedTerrainVertex const& vertex);
+	static std::vector<PackedTerrainVertex> Pack(std::span<TerrainVertex const> vertices);
+};
\ No newline at end of file
@@ -32,6 +32,13 @@ WindowDimensions Window::GetWindowSize() const
 	return m_windowSize;
 }
 
+WindowDimensions Window::GetFramebufferSize() const
+{
+	int width, height;
+	glfwGetFramebufferSize(m_pWindow, &width, &height);
+	return { static_cast<uint32_t>(width), static_cast<uint32_t>(height) };
+}
+
 uint32_t Window::GetWindowWidth() const
 {
 	return std::get<0>(m_windowSize);
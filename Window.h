@@ -17,6 +17,8 @@ public:
 	virtual ~Window();
 
 	WindowDimensions GetWindowSize() const;
+	//Current size of the drawable area in pixels, follows resizes unlike GetWindowSize. Zero while minimised
+	WindowDimensions GetFramebufferSize() const;
 	uint32_t GetWindowWidth() const;
 	uint32_t GetWindowHeight() const;
 	bool ShouldClose() const noexcept;
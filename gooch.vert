@@ -1,9 +1,15 @@
 #version 460
 
-layout(location = 0) in vec3 position;
-layout(location = 1) in vec3 normal;
+//PackedVertex layout
+layout(location = 0) in vec4 quantizedPosition;
+layout(location = 1) in vec2 octahedralNormal;
 layout(location = 2) in vec2 _unused;
 
+layout(push_constant) uniform VertexQuantization {
+	vec4 offset;
+	vec4 scale;
+} quantization;
+
 struct ObjectData {
 	mat4 transform;
 };
@@ -21,8 +27,20 @@ layout(std430, set = 1, binding = 0) readonly buffer ObjectBuffer {
 
 layout(location = 0) out vec3 vertexWorldNormal;
 
+vec3 DecodeOctahedral(vec2 e)
+{
+	vec3 n = vec3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+	float t = max(-n.z, 0.0);
+	n.x += n.x >= 0.0 ? -t : t;
+	n.y += n.y >= 0.0 ? -t : t;
+	return normalize(n);
+}
+
 void main()
 {
+	vec3 position = quantization.offset.xyz + quantizedPosition.xyz * quantization.scale.xyz;
+	vec3 normal = DecodeOctahedral(octahedralNormal);
+
 	mat4 transform = objectBuffer.camera.viewProj * objectBuffer.objects[gl_BaseInstance].transform;
 	gl_Position = transform * vec4(position, 1.0);
 	vertexWorldNormal = (objectBuffer.objects[gl_BaseInstance].transform * vec4(normal, 0.0)).xyz;
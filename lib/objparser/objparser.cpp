@@ -9,6 +9,23 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 template <typename T>
 static void growArray(T*& data, size_t& capacity)
@@ -31,6 +48,13 @@ static int fixupIndex(int index, size_t size)
 	return (index >= 0) ? index - 1 : int(size) + index;
 }
 
+// offsets into ObjFile::f of relative (negative) indices that were resolved against chunk-local counts
+struct ObjRelativeIndices
+{
+	size_t* data;
+	size_t size, cap;
+};
+
 static int parseInt(const char* s, const char** end)
 {
 	// skip whitespace
@@ -178,7 +202,7 @@ ObjFile::~ObjFile()
 	delete[] f;
 }
 
-void objParseLine(ObjFile& result, const char* line)
+static void parseLine(ObjFile& result, const char* line, ObjRelativeIndices* relative)
 {
 	if (line[0] == 'v' && line[1] == ' ')
 	{
@@ -235,6 +259,7 @@ void objParseLine(ObjFile& result, const char* line)
 
 		int fv = 0;
 		int f[3][3] = {};
+		bool fr[3][3] = {};
 
 		while (*s)
 		{
@@ -248,17 +273,39 @@ void objParseLine(ObjFile& result, const char* line)
 			f[fv][1] = fixupIndex(vti, vt);
 			f[fv][2] = fixupIndex(vni, vn);
 
+			fr[fv][0] = vi < 0;
+			fr[fv][1] = vti < 0;
+			fr[fv][2] = vni < 0;
+
 			if (fv == 2)
 			{
 				if (result.f_size + 9 > result.f_cap)
 					growArray(result.f, result.f_cap);
 
+				if (relative)
+				{
+					for (size_t i = 0; i < 9; ++i)
+					{
+						if (!fr[i / 3][i % 3])
+							continue;
+
+						if (relative->size + 1 > relative->cap)
+							growArray(relative->data, relative->cap);
+
+						relative->data[relative->size++] = result.f_size + i;
+					}
+				}
+
 				memcpy(&result.f[result.f_size], f, 9 * sizeof(int));
 				result.f_size += 9;
 
 				f[1][0] = f[2][0];
 				f[1][1] = f[2][1];
 				f[1][2] = f[2][2];
+
+				fr[1][0] = fr[2][0];
+				fr[1][1] = fr[2][1];
+				fr[1][2] = fr[2][2];
 			}
 			else
 			{
@@ -268,6 +315,11 @@ void objParseLine(ObjFile& result, const char* line)
 	}
 }
 
+void objParseLine(ObjFile& result, const char* line)
+{
+	parseLine(result, line, 0);
+}
+
 bool objParseFile(ObjFile& result, const char* path)
 {
 	FILE* file = fopen(path, "rb");
@@ -321,6 +373,289 @@ bool objParseFile(ObjFile& result, const char* path)
 	return true;
 }
 
+struct ObjMappedFile
+{
+	const char* data;
+	size_t size;
+
+#ifdef _WIN32
+	HANDLE file;
+	HANDLE mapping;
+#else
+	int fd;
+#endif
+};
+
+static bool mapFile(ObjMappedFile& result, const char* path)
+{
+	result.data = 0;
+	result.size = 0;
+
+#ifdef _WIN32
+	result.mapping = 0;
+	result.file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, 0);
+	if (result.file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(result.file, &size))
+	{
+		CloseHandle(result.file);
+		return false;
+	}
+
+	result.size = size_t(size.QuadPart);
+
+	// empty files can't be mapped
+	if (result.size == 0)
+		return true;
+
+	result.mapping = CreateFileMappingA(result.file, 0, PAGE_READONLY, 0, 0, 0);
+	if (!result.mapping)
+	{
+		CloseHandle(result.file);
+		return false;
+	}
+
+	result.data = static_cast<const char*>(MapViewOfFile(result.mapping, FILE_MAP_READ, 0, 0, 0));
+	if (!result.data)
+	{
+		CloseHandle(result.mapping);
+		CloseHandle(result.file);
+		return false;
+	}
+#else
+	result.fd = open(path, O_RDONLY);
+	if (result.fd < 0)
+		return false;
+
+	struct stat st;
+	if (fstat(result.fd, &st) != 0)
+	{
+		close(result.fd);
+		return false;
+	}
+
+	result.size = size_t(st.st_size);
+
+	// empty files can't be mapped
+	if (result.size == 0)
+		return true;
+
+	void* data = mmap(0, result.size, PROT_READ, MAP_PRIVATE, result.fd, 0);
+	if (data == MAP_FAILED)
+	{
+		close(result.fd);
+		return false;
+	}
+
+	madvise(data, result.size, MADV_SEQUENTIAL);
+	result.data = static_cast<const char*>(data);
+#endif
+
+	return true;
+}
+
+static void unmapFile(ObjMappedFile& file)
+{
+#ifdef _WIN32
+	if (file.data)
+		UnmapViewOfFile(file.data);
+	if (file.mapping)
+		CloseHandle(file.mapping);
+	CloseHandle(file.file);
+#else
+	if (file.data)
+		munmap(const_cast<char*>(file.data), file.size);
+	close(file.fd);
+#endif
+}
+
+// parses all lines that start in [begin, end); lines are terminated by '\n' rather than 0 which the parse functions handle the same way
+static void parseChunk(ObjFile& result, ObjRelativeIndices& relative, const char* begin, const char* end, const char* eof)
+{
+	const char* line = begin;
+
+	while (line < end)
+	{
+		const char* eol = static_cast<const char*>(memchr(line, '\n', eof - line));
+
+		if (!eol)
+		{
+			// last line of the file isn't newline terminated so it can't be parsed in place
+			size_t length = eof - line;
+			char* buffer = new char[length + 1];
+			memcpy(buffer, line, length);
+			buffer[length] = 0;
+
+			parseLine(result, buffer, &relative);
+
+			delete[] buffer;
+			break;
+		}
+
+		parseLine(result, line, &relative);
+
+		line = eol + 1;
+	}
+}
+
+struct ObjChunk
+{
+	const char* begin;
+	const char* end;
+
+	ObjFile data;
+	ObjRelativeIndices relative;
+
+	// first element of this chunk in the merged arrays
+	size_t v_offset, vt_offset, vn_offset, f_offset;
+};
+
+template <typename T>
+static void resizeArray(T*& data, size_t size, size_t& capacity, size_t newcapacity)
+{
+	if (newcapacity <= capacity)
+		return;
+
+	T* newdata = new T[newcapacity];
+
+	if (data)
+	{
+		memcpy(newdata, data, size * sizeof(T));
+		delete[] data;
+	}
+
+	data = newdata;
+	capacity = newcapacity;
+}
+
+static void mergeChunk(ObjFile& result, const ObjChunk& chunk)
+{
+	const ObjFile& data = chunk.data;
+
+	if (data.v_size)
+		memcpy(result.v + chunk.v_offset, data.v, data.v_size * sizeof(float));
+	if (data.vt_size)
+		memcpy(result.vt + chunk.vt_offset, data.vt, data.vt_size * sizeof(float));
+	if (data.vn_size)
+		memcpy(result.vn + chunk.vn_offset, data.vn, data.vn_size * sizeof(float));
+	if (data.f_size)
+		memcpy(result.f + chunk.f_offset, data.f, data.f_size * sizeof(int));
+
+	// relative indices were resolved against the chunk-local counts, rebase them onto the counts of all preceding chunks
+	int base[3] = {int(chunk.v_offset / 3), int(chunk.vt_offset / 3), int(chunk.vn_offset / 3)};
+
+	for (size_t i = 0; i < chunk.relative.size; ++i)
+	{
+		size_t offset = chunk.relative.data[i];
+
+		result.f[chunk.f_offset + offset] += base[offset % 3];
+	}
+}
+
+bool objParseFileParallel(ObjFile& result, const char* path, unsigned int threadCount)
+{
+	// chunks smaller than this aren't worth a thread
+	const size_t minChunkSize = 1 << 20;
+
+	ObjMappedFile file;
+	if (!mapFile(file, path))
+		return false;
+
+	if (threadCount == 0)
+		threadCount = std::thread::hardware_concurrency();
+
+	size_t chunkCount = file.size / minChunkSize;
+	chunkCount = chunkCount < threadCount ? chunkCount : threadCount;
+
+	if (chunkCount <= 1)
+	{
+		unmapFile(file);
+		return objParseFile(result, path);
+	}
+
+	const char* eof = file.data + file.size;
+
+	ObjChunk* chunks = new ObjChunk[chunkCount];
+
+	// split the file evenly, then move each split point to the start of the next line
+	for (size_t i = 0; i < chunkCount; ++i)
+	{
+		const char* split = file.data + file.size / chunkCount * i;
+
+		if (i > 0)
+		{
+			const char* eol = static_cast<const char*>(memchr(split, '\n', eof - split));
+			split = eol ? eol + 1 : eof;
+
+			// previous chunk may already cover this split if it contained a very long line
+			split = split < chunks[i - 1].begin ? chunks[i - 1].begin : split;
+			chunks[i - 1].end = split;
+		}
+
+		chunks[i].begin = split;
+		chunks[i].end = eof;
+		chunks[i].relative.data = 0;
+		chunks[i].relative.size = 0;
+		chunks[i].relative.cap = 0;
+	}
+
+	std::vector<std::thread> workers;
+	workers.reserve(chunkCount);
+
+	for (size_t i = 0; i < chunkCount; ++i)
+		workers.emplace_back(parseChunk, std::ref(chunks[i].data), std::ref(chunks[i].relative), chunks[i].begin, chunks[i].end, eof);
+
+	for (std::thread& worker : workers)
+		worker.join();
+
+	workers.clear();
+
+	unmapFile(file);
+
+	// prefix sum over chunk counts gives each chunk its place in the merged arrays
+	size_t v_size = result.v_size, vt_size = result.vt_size, vn_size = result.vn_size, f_size = result.f_size;
+
+	for (size_t i = 0; i < chunkCount; ++i)
+	{
+		ObjChunk& chunk = chunks[i];
+
+		chunk.v_offset = v_size;
+		chunk.vt_offset = vt_size;
+		chunk.vn_offset = vn_size;
+		chunk.f_offset = f_size;
+
+		v_size += chunk.data.v_size;
+		vt_size += chunk.data.vt_size;
+		vn_size += chunk.data.vn_size;
+		f_size += chunk.data.f_size;
+	}
+
+	resizeArray(result.v, result.v_size, result.v_cap, v_size);
+	resizeArray(result.vt, result.vt_size, result.vt_cap, vt_size);
+	resizeArray(result.vn, result.vn_size, result.vn_cap, vn_size);
+	resizeArray(result.f, result.f_size, result.f_cap, f_size);
+
+	for (size_t i = 0; i < chunkCount; ++i)
+		workers.emplace_back(mergeChunk, std::ref(result), std::cref(chunks[i]));
+
+	for (std::thread& worker : workers)
+		worker.join();
+
+	result.v_size = v_size;
+	result.vt_size = vt_size;
+	result.vn_size = vn_size;
+	result.f_size = f_size;
+
+	for (size_t i = 0; i < chunkCount; ++i)
+		delete[] chunks[i].relative.data;
+
+	delete[] chunks;
+
+	return true;
+}
+
 bool objValidate(const ObjFile& result)
 {
 	size_t v = result.v_size / 3;
@@ -28,4 +28,8 @@ private:
 void objParseLine(ObjFile& result, const char* line);
 bool objParseFile(ObjFile& result, const char* path);
 
+// memory maps the file and parses it on multiple threads, split at line boundaries; results are identical to objParseFile
+// threadCount of 0 uses all hardware threads, small files are parsed serially
+bool objParseFileParallel(ObjFile& result, const char* path, unsigned int threadCount = 0);
+
 bool objValidate(const ObjFile& result);
\ No newline at end of file
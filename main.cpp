@@ -1,8 +1,82 @@
 #include "App.h"
+#include "Benchmark.h"
 #include "Logger.h"
+#include "GfxDevice.h"
 
-int main() {
-	App application("GpuGems");
+#include <cstdio>
+#include <cstring>
+
+constexpr uint64_t k_defaultHeadlessFrameCount = 100;
+
+//--benchmark config.txt or --headless [--frames N] [--size WxH] [--capture file.ppm], and [--trace file.json] with either.
+//Either also takes [--frames-in-flight 1-3] [--no-dynamic-rendering], and windowed runs
+//[--present fifo|fifoRelaxed|mailbox|immediate] [--latency]
+AppSettings ParseArguments(int argc, char** argv)
+{
+	AppSettings settings;
+	for (int i = 1; i < argc; ++i)
+	{
+		bool const bHasValue = i + 1 < argc;
+		if (std::strcmp(argv[i], "--benchmark") == 0 && bHasValue)
+		{
+			//Everything a benchmark needs is in its config so runs can be reproduced from the file alone.
+			//Flags before it are replaced, flags after it such as --trace still apply
+			settings = Benchmark::LoadSettings(argv[++i]);
+		}
+		else if (std::strcmp(argv[i], "--headless") == 0)
+		{
+			settings.bHeadless = true;
+		}
+		else if (std::strcmp(argv[i], "--frames") == 0 && bHasValue)
+		{
+			settings.frameCount = std::strtoull(argv[++i], nullptr, 10);
+		}
+		else if (std::strcmp(argv[i], "--size") == 0 && bHasValue)
+		{
+			uint32_t width = 0;
+			uint32_t height = 0;
+			if (std::sscanf(argv[++i], "%ux%u", &width, &height) == 2 && width > 0 && height > 0)
+			{
+				settings.renderSize = { width, height };
+			}
+		}
+		else if (std::strcmp(argv[i], "--capture") == 0 && bHasValue)
+		{
+			settings.capturePath = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--trace") == 0 && bHasValue)
+		{
+			settings.tracePath = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--present") == 0 && bHasValue)
+		{
+			settings.gfx.presentMode = GfxDevice::ParsePresentMode(argv[++i]);
+		}
+		else if (std::strcmp(argv[i], "--frames-in-flight") == 0 && bHasValue)
+		{
+			settings.gfx.framesInFlight = uint32_t(std::strtoul(argv[++i], nullptr, 10));
+		}
+		else if (std::strcmp(argv[i], "--latency") == 0)
+		{
+			settings.gfx.bLatencyMode = true;
+		}
+		else if (std::strcmp(argv[i], "--no-dynamic-rendering") == 0)
+		{
+			settings.gfx.bDynamicRendering = false;
+		}
+	}
+
+	//Without a window there is nothing to close, so headless runs always stop on their own
+	if (settings.bHeadless && settings.frameCount == 0)
+	{
+		settings.frameCount = k_defaultHeadlessFrameCount;
+	}
+
+	return settings;
+}
+
+int main(int argc, char** argv) {
+	App application("GpuGems", ParseArguments(argc, argv));
 	application.Start();
 
 	while (!application.ShouldQuit())
@@ -1,12 +1,19 @@
 #version 450
 
 layout(location = 0) in vec2 uv;
+layout(location = 1) in vec4 color;
 layout(binding = 0) uniform sampler2D fontSampler;
 
 layout(location = 0) out vec4 oColor;
 
 void main()
 {
-	float color = texture(fontSampler, uv).r;
-	oColor = vec4(color); 
+	//Signed distance with 0 on the outline, antialiased over one screen pixel whatever the text size.
+	// Derivatives are taken outside the branch so they stay defined across the quad
+	float distance = texture(fontSampler, uv).r - 0.5;
+	float edgeWidth = max(fwidth(distance), 0.0001);
+
+	//Negative uvs mark solid quads such as graph bars
+	float coverage = uv.x < 0.0 ? 1.0 : smoothstep(-edgeWidth, edgeWidth, distance);
+	oColor = vec4(color.rgb, color.a * coverage);
 }
\ No newline at end of file
@@ -1,9 +1,11 @@
 #version 450
 
-layout(location = 0) in vec2 pos;
-layout(location = 1) in vec2 uv;
+layout(location = 0) in vec4 rect; //Min corner in xy, max corner in zw
+layout(location = 1) in vec4 uvRect;
+layout(location = 2) in vec4 color;
 
 layout(location = 0) out vec2 oUv;
+layout(location = 1) out vec4 oColor;
 
 out gl_PerVertex
 {
@@ -12,6 +14,9 @@ out gl_PerVertex
 
 void main()
 {
-	gl_Position = vec4(pos, 0.0, 1.0);
-	oUv = uv;
+	//Drawn as a 4 vertex strip per instance, the vertex index picks the corner
+	vec2 corner = vec2(gl_VertexIndex >> 1, gl_VertexIndex & 1);
+	gl_Position = vec4(mix(rect.xy, rect.zw, corner), 0.0, 1.0);
+	oUv = mix(uvRect.xy, uvRect.zw, corner);
+	oColor = color;
 }
\ No newline at end of file
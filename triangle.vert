@@ -1,5 +1,6 @@
 #version 450
 
+//PackedTerrainVertex half float xyz, w is unused
 layout(location = 0) in vec3 position;
 
 layout(push_constant) uniform PushConstants {